@@ -0,0 +1,157 @@
+/* Synthetic overflow scenarios through the two ringbuffer overflow
+ * policies: dropping whole packets until the fill is back at its target,
+ * as before, and draining by folding frames out of each packet.
+ *
+ * The source sends a 1 kHz stereo sine in 2048-byte packets while the sink
+ * drains at 44.1 kHz. Everything written is kept, so the played stream can
+ * be checked for clicks: a step between two samples more than twice the
+ * steepest one of the sine. Folding a frame out at most doubles a step; a
+ * packet cut out jumps anywhere in the waveform.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bt_app_drain.h"
+#include "host_test.h"
+
+#define RATE 44100
+#define CH 2
+#define FRAME_BYTES (CH * 2)
+#define PACKET_FRAMES 512
+#define SIM_SECONDS 120
+#define TARGET_FRAMES (RATE * 80 / 1000) /* fill to return to */
+#define HIGH_FRAMES (RATE * 120 / 1000)  /* fill at which to act */
+#define TONE_HZ 1000.0
+#define AMPLITUDE 16000.0
+#define MAX_OUT (SIM_SECONDS * RATE * 2)
+
+typedef struct {
+  const char *name;
+  int32_t ppm;       /* source clock ahead of the sink */
+  uint32_t stall_ms; /* one stall this long, then a catch-up burst */
+} scenario_t;
+
+typedef struct {
+  uint32_t clicks;        /* steps beyond the sine's own */
+  uint32_t gaps;          /* packets thrown away */
+  uint32_t removed_ms;    /* audio removed in total */
+  uint32_t max_fill_ms;
+  uint32_t over_ms;       /* time spent above the drop level */
+  double ns_per_packet;   /* cost of the write path */
+} result_t;
+
+static int16_t s_out[MAX_OUT * CH];
+static int16_t s_scratch[PACKET_FRAMES * CH];
+
+static void packet(int16_t *pcm, uint64_t first) {
+  for (size_t i = 0; i < PACKET_FRAMES; i++) {
+    double v = AMPLITUDE * sin(2 * M_PI * TONE_HZ * (first + i) / RATE);
+    pcm[i * CH] = pcm[i * CH + 1] = (int16_t)lrint(v);
+  }
+}
+
+static void simulate(const scenario_t *sc, bool drain, result_t *r) {
+  const double period_us = 1e6 * PACKET_FRAMES / RATE / (1 + sc->ppm * 1e-6);
+  const int64_t end_us = (int64_t)SIM_SECONDS * 1000000;
+  const int64_t stall_at = end_us / 4;
+  int16_t pcm[PACKET_FRAMES * CH];
+  size_t written = 0; /* frames ever written */
+  int64_t played = 0; /* frames the sink has taken */
+  int64_t clock = 0;  /* frames the sink has played, audio or silence */
+  uint64_t sent = 0;  /* source frames */
+  bool dropping = false;
+  uint64_t cost_ns = 0;
+  uint32_t packets = 0;
+
+  memset(r, 0, sizeof(*r));
+  for (int64_t n = 0;; n++) {
+    int64_t t = (int64_t)(n * period_us);
+    /* packets sent during the stall all arrive when it ends */
+    if (t >= stall_at && t < stall_at + sc->stall_ms * 1000) {
+      t = stall_at + sc->stall_ms * 1000;
+    }
+    if (t >= end_us) {
+      break;
+    }
+    /* the sink plays silence while empty; it doesn't take audio ahead */
+    int64_t now = t * RATE / 1000000;
+    played += now - clock;
+    clock = now;
+    if (played > (int64_t)written) {
+      played = written;
+    }
+    size_t fill = written - played;
+    uint32_t fill_ms = fill * 1000 / RATE;
+    if (fill_ms > r->max_fill_ms) {
+      r->max_fill_ms = fill_ms;
+    }
+    if (fill > HIGH_FRAMES) {
+      r->over_ms += (uint32_t)(period_us / 1000);
+    }
+
+    packet(pcm, sent);
+    sent += PACKET_FRAMES;
+    packets++;
+    uint64_t start = host_now_ns();
+    if (!dropping && fill + PACKET_FRAMES > HIGH_FRAMES) {
+      dropping = true;
+    } else if (dropping && fill <= TARGET_FRAMES) {
+      dropping = false;
+    }
+    size_t n_out = PACKET_FRAMES;
+    const int16_t *src = pcm;
+    if (dropping && !drain) {
+      n_out = 0;
+      r->gaps++;
+    } else if (dropping) {
+      size_t drop = bt_drain_budget(PACKET_FRAMES, fill - TARGET_FRAMES);
+      n_out = bt_drain_compress(s_scratch, pcm, PACKET_FRAMES, CH, drop);
+      src = s_scratch;
+    }
+    if (written + n_out <= MAX_OUT) {
+      memcpy(s_out + written * CH, src, n_out * FRAME_BYTES);
+      written += n_out;
+    }
+    cost_ns += host_now_ns() - start;
+  }
+  r->removed_ms = (uint32_t)((sent - written) * 1000 / RATE);
+  r->ns_per_packet = (double)cost_ns / packets;
+
+  /* twice the steepest step of the sine, with a margin for rounding */
+  const double limit = AMPLITUDE * 2 * sin(M_PI * TONE_HZ / RATE) * 2.2 + 2;
+  for (size_t i = 1; i < written; i++) {
+    if (fabs((double)s_out[i * CH] - s_out[(i - 1) * CH]) > limit) {
+      r->clicks++;
+    }
+  }
+}
+
+int main(void) {
+  static const scenario_t scenarios[] = {
+      {"+300ppm", 300, 0},
+      {"+2000ppm", 2000, 0},
+      {"burst", 0, 200},
+      {"burst+300", 300, 200},
+  };
+  result_t drop, drain;
+
+  printf("%-10s %-6s %7s %6s %11s %9s %8s %10s\n", "scenario", "policy",
+         "clicks", "gaps", "removed ms", "max fill", "over ms", "ns/packet");
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    const scenario_t *sc = &scenarios[i];
+    simulate(sc, false, &drop);
+    simulate(sc, true, &drain);
+    const result_t *res[] = {&drop, &drain};
+    for (int k = 0; k < 2; k++) {
+      printf("%-10s %-6s %7u %6u %11u %9u %8u %10.0f\n", sc->name,
+             k ? "drain" : "drop", res[k]->clicks, res[k]->gaps,
+             res[k]->removed_ms, res[k]->max_fill_ms, res[k]->over_ms,
+             res[k]->ns_per_packet);
+    }
+    /* draining never cuts the audio */
+    CHECK(drain.gaps == 0);
+    CHECK(drain.clicks == 0);
+  }
+  return host_test_done();
+}
@@ -0,0 +1,239 @@
+/* DSP chain checks and per-chunk cost: volume and EQ run through the chain
+ * are bit-exact with the stages called directly, a stage bypassed from
+ * another thread is skipped for whole blocks only, stats read while the
+ * chain runs are never torn nor taken halfway through an update, and the
+ * host cycles of one DMA chunk through the chain against the bare stages.
+ */
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "bt_app_dsp.h"
+#include "bt_app_eq.h"
+#include "bt_app_gain.h"
+#include "host_test.h"
+
+#define RATE 48000
+#define CHUNK_FRAMES 384 /* one I2S descriptor at the default latency */
+#define AMPLITUDE 12000.0
+
+static int16_t s_buf[CHUNK_FRAMES * 2];
+static atomic_bool s_stop;
+static uint32_t s_ticks; /* the counting clock */
+static bt_dsp_stats_t s_read;
+static atomic_bool s_read_done;
+
+static void sine(size_t first) {
+  for (size_t i = 0; i < CHUNK_FRAMES; i++) {
+    double v = AMPLITUDE * sin(2 * M_PI * 1000 * (first + i) / RATE);
+    s_buf[i * 2] = (int16_t)lrint(v);
+    s_buf[i * 2 + 1] = (int16_t)lrint(-v / 2);
+  }
+}
+
+static uint32_t clock_cycles(void) { return (uint32_t)host_cycles(); }
+
+/* each reading one tick after the last: every block costs one cycle */
+static uint32_t clock_count(void) { return s_ticks++; }
+
+static void stage_volume(void *ctx, void *buf, size_t frames, uint8_t ch) {
+  bt_gain_process(ctx, buf, frames * ch);
+}
+
+static void stage_eq(void *ctx, void *buf, size_t frames, uint8_t ch) {
+  bt_eq_process(ctx, buf, frames, ch);
+}
+
+static bool stage_eq_setup(void *ctx, uint32_t sample_rate, uint8_t ch) {
+  bt_eq_set_sample_rate(ctx, sample_rate);
+  return ch <= BT_EQ_MAX_CH;
+}
+
+static void stage_add_one(void *ctx, void *buf, size_t frames, uint8_t ch) {
+  int16_t *s = buf;
+  for (size_t i = 0; i < frames * ch; i++) {
+    s[i]++;
+  }
+}
+
+static void eq_bands(bt_eq_t *eq) {
+  const bt_eq_band_t bass = {BT_EQ_LOW_SHELF, 100.0f, 0.707f, 3.0f};
+  const bt_eq_band_t treble = {BT_EQ_HIGH_SHELF, 10000.0f, 0.707f, -2.0f};
+
+  bt_eq_init(eq, 44100);
+  bt_eq_set_band(eq, 0, &bass);
+  bt_eq_set_band(eq, 1, &treble);
+}
+
+static void test_exact(void) {
+  static bt_gain_t gain, ref_gain;
+  static bt_eq_t eq, ref_eq;
+  static bt_dsp_chain_t c;
+  int16_t ref[CHUNK_FRAMES * 2];
+  bt_dsp_stats_t st;
+
+  bt_gain_init(&gain, 80);
+  bt_gain_init(&ref_gain, 80);
+  eq_bands(&eq);
+  eq_bands(&ref_eq);
+  bt_eq_set_sample_rate(&ref_eq, RATE);
+  bt_dsp_init(&c, clock_cycles);
+  CHECK(bt_dsp_add(&c, "volume", stage_volume, NULL, &gain) == 0);
+  CHECK(bt_dsp_add(&c, "EQ", stage_eq, stage_eq_setup, &eq) == 1);
+  bt_dsp_configure(&c, RATE, 2);
+
+  bool same = true;
+  for (size_t n = 0; n < 200; n++) {
+    /* EQ off for the middle stretch: the filters keep their state */
+    bool bypass = n >= 80 && n < 120;
+    bt_dsp_bypass(&c, 1, bypass);
+    sine(n * CHUNK_FRAMES);
+    memcpy(ref, s_buf, sizeof(ref));
+    bt_gain_process(&ref_gain, ref, CHUNK_FRAMES * 2);
+    if (!bypass) {
+      bt_eq_process(&ref_eq, ref, CHUNK_FRAMES, 2);
+    }
+    bt_dsp_run(&c, s_buf, CHUNK_FRAMES, 2);
+    same = same && memcmp(ref, s_buf, sizeof(ref)) == 0;
+  }
+  CHECK(same);
+  CHECK(bt_dsp_stats(&c, 0, &st) && st.calls == 200);
+  CHECK(bt_dsp_stats(&c, 1, &st) && st.calls == 160);
+  CHECK(!bt_dsp_stats(&c, 2, &st));
+
+  /* a format the EQ cannot take drops it out, volume still runs */
+  bt_dsp_stats_reset(&c);
+  bt_dsp_configure(&c, RATE, BT_EQ_MAX_CH + 1);
+  bt_dsp_run(&c, s_buf, CHUNK_FRAMES / 3, BT_EQ_MAX_CH + 1);
+  CHECK(bt_dsp_stats(&c, 0, &st) && st.calls == 1);
+  CHECK(bt_dsp_stats(&c, 1, &st) && st.calls == 0);
+}
+
+static void *bypasser(void *arg) {
+  bt_dsp_chain_t *c = arg;
+  for (unsigned n = 0; !atomic_load(&s_stop); n++) {
+    bt_dsp_bypass(c, 0, n & 1);
+  }
+  return NULL;
+}
+
+static void test_bypass_concurrent(void) {
+  static bt_dsp_chain_t c;
+  pthread_t t;
+
+  /* the stage adds one to every sample; a block is all 0 or all 1 */
+  bt_dsp_init(&c, clock_cycles);
+  bt_dsp_add(&c, "add one", stage_add_one, NULL, NULL);
+  atomic_store(&s_stop, false);
+  pthread_create(&t, NULL, bypasser, &c);
+  bool whole = true;
+  for (size_t n = 0; n < 100000; n++) {
+    memset(s_buf, 0, sizeof(s_buf));
+    bt_dsp_run(&c, s_buf, CHUNK_FRAMES, 2);
+    for (size_t i = 1; i < CHUNK_FRAMES * 2; i++) {
+      whole = whole && s_buf[i] == s_buf[0];
+    }
+  }
+  atomic_store(&s_stop, true);
+  pthread_join(t, NULL);
+  CHECK(whole);
+}
+
+static void *reader(void *arg) {
+  bt_dsp_chain_t *c = arg;
+  bt_dsp_stats_t st;
+  unsigned torn = 0;
+
+  while (!atomic_load(&s_stop)) {
+    bt_dsp_stats(c, 0, &st);
+    torn += st.cycles != st.calls || st.peak > 1;
+  }
+  return (void *)(uintptr_t)torn;
+}
+
+static void *read_once(void *arg) {
+  bt_dsp_stats(arg, 0, &s_read);
+  atomic_store(&s_read_done, true);
+  return NULL;
+}
+
+static void test_stats_concurrent(void) {
+  static bt_dsp_chain_t c;
+  pthread_t t;
+  void *torn;
+
+  /* with the counting clock, calls and cycles move in step */
+  bt_dsp_init(&c, clock_count);
+  bt_dsp_add(&c, "add one", stage_add_one, NULL, NULL);
+  atomic_store(&s_stop, false);
+  pthread_create(&t, NULL, reader, &c);
+  for (size_t n = 0; n < 200000; n++) {
+    bt_dsp_run(&c, s_buf, 8, 2);
+  }
+  atomic_store(&s_stop, true);
+  pthread_join(t, &torn);
+  CHECK((uintptr_t)torn == 0);
+
+  /* one CPU rarely preempts the update; hold one open by hand instead */
+  bt_dsp_stage_t *s = &c.stage[0];
+  unsigned seq = atomic_load(&s->seq);
+  const struct timespec nap = {0, 20000000};
+  atomic_store(&s->seq, seq + 1);
+  s->stats.calls++;
+  atomic_store(&s_read_done, false);
+  pthread_create(&t, NULL, read_once, &c);
+  nanosleep(&nap, NULL);
+  CHECK(!atomic_load(&s_read_done));
+  s->stats.cycles++;
+  atomic_store(&s->seq, seq + 2);
+  pthread_join(t, NULL);
+  CHECK(s_read.calls == 200001 && s_read.cycles == 200001);
+}
+
+static void bench(void) {
+  static bt_gain_t gain;
+  static bt_eq_t eq;
+  static bt_dsp_chain_t c;
+  const int reps = 4000;
+  uint64_t bare = UINT64_MAX, chain = UINT64_MAX;
+
+  bt_gain_init(&gain, 80);
+  eq_bands(&eq);
+  bt_dsp_init(&c, clock_cycles);
+  bt_dsp_add(&c, "volume", stage_volume, NULL, &gain);
+  bt_dsp_add(&c, "EQ", stage_eq, stage_eq_setup, &eq);
+  bt_dsp_configure(&c, RATE, 2);
+  for (int r = 0; r < reps; r++) {
+    sine(r * CHUNK_FRAMES);
+    uint64_t t = host_cycles();
+    bt_gain_process(&gain, s_buf, CHUNK_FRAMES * 2);
+    bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+    uint64_t d = host_cycles() - t;
+    bare = d < bare ? d : bare;
+    sine(r * CHUNK_FRAMES);
+    t = host_cycles();
+    bt_dsp_run(&c, s_buf, CHUNK_FRAMES, 2);
+    d = host_cycles() - t;
+    chain = d < chain ? d : chain;
+  }
+  printf("host cycles per %d-frame stereo chunk, volume and 2-band EQ\n",
+         CHUNK_FRAMES);
+  printf("%10s %10s %10s\n", "bare", "chain", "overhead");
+  printf("%10llu %10llu %10lld\n", (unsigned long long)bare,
+         (unsigned long long)chain, (long long)chain - (long long)bare);
+  for (uint8_t i = 0; i < c.count; i++) {
+    bt_dsp_stats_t st;
+    bt_dsp_stats(&c, i, &st);
+    printf("stage %-6s %10llu cycles avg %10u peak\n", c.stage[i].name,
+           (unsigned long long)(st.cycles / st.calls), (unsigned)st.peak);
+  }
+}
+
+int main(void) {
+  test_exact();
+  test_bypass_concurrent();
+  test_stats_concurrent();
+  bench();
+  return host_test_done();
+}
@@ -0,0 +1,179 @@
+/* EQ checks and per-chunk cost: an all-off EQ is bit-exact, a +6 dB bell
+ * doubles its centre frequency, a new sample rate starts the filters from
+ * silence, coefficient updates from another thread never disturb the audio
+ * thread, and the host cycles of one DMA chunk for 0 to 8 bands in both
+ * sample formats.
+ */
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bt_app_eq.h"
+#include "host_test.h"
+
+#define RATE 44100
+#define CHUNK_FRAMES 384 /* one I2S descriptor at the default latency */
+#define AMPLITUDE 8000.0
+
+static int16_t s_buf[CHUNK_FRAMES * 2];
+static int32_t s_wide[CHUNK_FRAMES * 2];
+static atomic_bool s_stop;
+
+static void sine(double hz, size_t first) {
+  for (size_t i = 0; i < CHUNK_FRAMES; i++) {
+    double v = AMPLITUDE * sin(2 * M_PI * hz * (first + i) / RATE);
+    s_buf[i * 2] = s_buf[i * 2 + 1] = (int16_t)lrint(v);
+    s_wide[i * 2] = s_wide[i * 2 + 1] = (int32_t)lrint(v * 256);
+  }
+}
+
+static double peak(void) {
+  int m = 0;
+  for (size_t i = 0; i < CHUNK_FRAMES * 2; i++) {
+    m = abs(s_buf[i]) > m ? abs(s_buf[i]) : m;
+  }
+  return m;
+}
+
+static void test_response(void) {
+  static bt_eq_t eq;
+  int16_t ref[CHUNK_FRAMES * 2];
+
+  bt_eq_init(&eq, RATE);
+  sine(1000, 0);
+  memcpy(ref, s_buf, sizeof(ref));
+  bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+  CHECK(memcmp(ref, s_buf, sizeof(ref)) == 0);
+
+  const bt_eq_band_t bell = {BT_EQ_PEAK, 1000.0f, 1.0f, 6.0f};
+  bt_eq_set_band(&eq, 0, &bell);
+  double p = 0;
+  /* let the filter settle over a few chunks, then read the level */
+  for (size_t n = 0; n < 20; n++) {
+    sine(1000, n * CHUNK_FRAMES);
+    bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+    p = peak();
+  }
+  double db = 20 * log10(p / AMPLITUDE);
+  CHECK(db > 5.8 && db < 6.2);
+
+  /* far from the bell the level is untouched */
+  for (size_t n = 0; n < 20; n++) {
+    sine(100, n * CHUNK_FRAMES);
+    bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+  }
+  /* a 100 Hz chunk holds less than a period's peak; compare to its own */
+  int16_t dry[CHUNK_FRAMES * 2];
+  sine(100, 20 * CHUNK_FRAMES);
+  memcpy(dry, s_buf, sizeof(dry));
+  bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+  double err = 0, sig = 0;
+  for (size_t i = 0; i < CHUNK_FRAMES * 2; i++) {
+    err += (double)(s_buf[i] - dry[i]) * (s_buf[i] - dry[i]);
+    sig += (double)dry[i] * dry[i];
+  }
+  CHECK(10 * log10(err / sig) < -20);
+}
+
+static void test_rate(void) {
+  static bt_eq_t eq;
+  const bt_eq_band_t bell = {BT_EQ_PEAK, 1000.0f, 1.0f, 6.0f};
+
+  bt_eq_init(&eq, RATE);
+  bt_eq_set_band(&eq, 0, &bell);
+  for (size_t n = 0; n < 4; n++) {
+    sine(1000, n * CHUNK_FRAMES);
+    bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+  }
+  /* the history of the old rate is gone: silence in, silence out */
+  bt_eq_set_sample_rate(&eq, 48000);
+  memset(s_buf, 0, sizeof(s_buf));
+  bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+  CHECK(peak() == 0);
+
+  /* a band change at the same rate keeps it, with no click */
+  for (size_t n = 0; n < 4; n++) {
+    sine(1000, n * CHUNK_FRAMES);
+    bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+  }
+  bt_eq_set_band(&eq, 1, &bell);
+  memset(s_buf, 0, sizeof(s_buf));
+  bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+  CHECK(peak() > 0);
+}
+
+static void *controller(void *arg) {
+  bt_eq_t *eq = arg;
+  for (unsigned n = 0; !atomic_load(&s_stop); n++) {
+    const bt_eq_band_t b = {BT_EQ_PEAK, 500.0f + n % 4000, 0.7f,
+                            (float)(n % 13) - 6};
+    bt_eq_set_band(eq, n % BT_EQ_MAX_BANDS, &b);
+  }
+  return NULL;
+}
+
+static void test_concurrent(void) {
+  static bt_eq_t eq;
+  pthread_t t;
+
+  /* the audio thread keeps going at full speed while the controller
+   * publishes bank after bank; no value may run away
+   */
+  bt_eq_init(&eq, RATE);
+  atomic_store(&s_stop, false);
+  pthread_create(&t, NULL, controller, &eq);
+  double worst = 0;
+  for (size_t n = 0; n < 20000; n++) {
+    sine(1000, n * CHUNK_FRAMES);
+    bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+    double p = peak();
+    worst = p > worst ? p : worst;
+  }
+  atomic_store(&s_stop, true);
+  pthread_join(t, NULL);
+  /* eight bands of at most +6 dB on an 8000 peak can clip, never wrap */
+  CHECK(worst <= -(double)INT16_MIN);
+  CHECK(worst > AMPLITUDE / 8);
+}
+
+static void bench(void) {
+  static const uint8_t counts[] = {0, 1, 2, 4, 8};
+  static bt_eq_t eq;
+  const int reps = 4000;
+
+  printf("host cycles per %d-frame stereo chunk\n", CHUNK_FRAMES);
+  printf("%6s %10s %10s %16s\n", "bands", "16-bit", "32-bit",
+         "per sample-band");
+  for (size_t c = 0; c < sizeof(counts); c++) {
+    bt_eq_init(&eq, RATE);
+    for (uint8_t b = 0; b < counts[c]; b++) {
+      const bt_eq_band_t band = {BT_EQ_PEAK, 100.0f * (b + 1), 1.0f, 3.0f};
+      bt_eq_set_band(&eq, b, &band);
+    }
+    uint64_t best16 = UINT64_MAX, best32 = UINT64_MAX;
+    for (int r = 0; r < reps; r++) {
+      sine(1000, r * CHUNK_FRAMES);
+      uint64_t t = host_cycles();
+      bt_eq_process(&eq, s_buf, CHUNK_FRAMES, 2);
+      uint64_t d16 = host_cycles() - t;
+      t = host_cycles();
+      bt_eq_process32(&eq, s_wide, CHUNK_FRAMES, 2);
+      uint64_t d32 = host_cycles() - t;
+      best16 = d16 < best16 ? d16 : best16;
+      best32 = d32 < best32 ? d32 : best32;
+    }
+    printf("%6u %10llu %10llu %16.2f\n", counts[c],
+           (unsigned long long)best16, (unsigned long long)best32,
+           counts[c] ? (double)best16 / (CHUNK_FRAMES * 2 * counts[c]) : 0);
+  }
+}
+
+int main(void) {
+  test_response();
+  test_rate();
+  test_concurrent();
+  bench();
+  return host_test_done();
+}
@@ -0,0 +1,166 @@
+/* Producer/consumer throughput of the SPSC ring against a ring that takes a
+ * lock on every call, the way the FreeRTOS byte ringbuffer it replaced
+ * does: xRingbufferSend, xRingbufferReceiveUpTo and vRingbufferReturnItem
+ * each enter a critical section, and the old write_ringbuf also called
+ * vRingbufferGetInfo on every packet. The FreeRTOS semaphores behind the
+ * blocking calls are left out, which flatters the locked ring.
+ *
+ *   bench_ringbuf [megabytes]
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bt_app_ringbuf.h"
+#include "host_test.h"
+
+#define RING_SIZE (32 * 1024)
+#define PACKET_BYTES 512 /* written per call, about one SBC frame's PCM */
+#define CHUNK_BYTES 1440 /* read per call, as the old I2S task did */
+
+/* spinlock-protected byte ring */
+typedef struct {
+  pthread_spinlock_t lock;
+  uint8_t *buf;
+  size_t size;
+  size_t head;
+  size_t tail;
+  size_t acquired; /* bytes handed out by receive, not yet returned */
+} locked_ring_t;
+
+static uint8_t s_storage[RING_SIZE];
+static bt_ringbuf_t s_spsc;
+static locked_ring_t s_locked;
+static size_t s_total;
+
+static bool locked_send(locked_ring_t *r, const uint8_t *data, size_t len) {
+  pthread_spin_lock(&r->lock);
+  if (r->size - (r->head - r->tail) < len) {
+    pthread_spin_unlock(&r->lock);
+    return false;
+  }
+  size_t offset = r->head % r->size;
+  size_t first = r->size - offset < len ? r->size - offset : len;
+  memcpy(r->buf + offset, data, first);
+  memcpy(r->buf, data + first, len - first);
+  r->head += len;
+  pthread_spin_unlock(&r->lock);
+  return true;
+}
+
+static const uint8_t *locked_receive(locked_ring_t *r, size_t max,
+                                     size_t *len) {
+  pthread_spin_lock(&r->lock);
+  size_t fill = r->head - r->tail;
+  size_t offset = r->tail % r->size;
+  size_t n = r->size - offset;
+  n = n < fill ? n : fill;
+  n = n < max ? n : max;
+  r->acquired = n;
+  pthread_spin_unlock(&r->lock);
+  *len = n;
+  return r->buf + offset;
+}
+
+static void locked_return(locked_ring_t *r) {
+  pthread_spin_lock(&r->lock);
+  r->tail += r->acquired;
+  r->acquired = 0;
+  pthread_spin_unlock(&r->lock);
+}
+
+static size_t locked_fill(locked_ring_t *r) {
+  pthread_spin_lock(&r->lock);
+  size_t fill = r->head - r->tail;
+  pthread_spin_unlock(&r->lock);
+  return fill;
+}
+
+static void *spsc_producer(void *arg) {
+  uint8_t pkt[PACKET_BYTES];
+  memset(pkt, 0x5a, sizeof(pkt));
+  for (size_t sent = 0; sent < s_total; sent += PACKET_BYTES) {
+    while (!bt_ringbuf_write(&s_spsc, pkt, PACKET_BYTES)) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static void *spsc_consumer(void *arg) {
+  uint8_t *sum = arg;
+  for (size_t got = 0; got < s_total;) {
+    size_t len = 0;
+    const uint8_t *span = bt_ringbuf_read_acquire(&s_spsc, &len);
+    len = len < CHUNK_BYTES ? len : CHUNK_BYTES;
+    if (len == 0) {
+      sched_yield();
+      continue;
+    }
+    *sum ^= span[len - 1];
+    bt_ringbuf_read_commit(&s_spsc, len);
+    got += len;
+  }
+  return NULL;
+}
+
+static void *locked_producer(void *arg) {
+  uint8_t pkt[PACKET_BYTES];
+  memset(pkt, 0x5a, sizeof(pkt));
+  for (size_t sent = 0; sent < s_total; sent += PACKET_BYTES) {
+    (void)locked_fill(&s_locked);
+    while (!locked_send(&s_locked, pkt, PACKET_BYTES)) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static void *locked_consumer(void *arg) {
+  uint8_t *sum = arg;
+  for (size_t got = 0; got < s_total;) {
+    size_t len = 0;
+    const uint8_t *span = locked_receive(&s_locked, CHUNK_BYTES, &len);
+    if (len == 0) {
+      sched_yield();
+      continue;
+    }
+    *sum ^= span[len - 1];
+    locked_return(&s_locked);
+    got += len;
+  }
+  return NULL;
+}
+
+static double run(void *(*prod)(void *), void *(*cons)(void *)) {
+  pthread_t p, c;
+  uint8_t sum = 0;
+  uint64_t start = host_now_ns();
+
+  pthread_create(&c, NULL, cons, &sum);
+  pthread_create(&p, NULL, prod, NULL);
+  pthread_join(p, NULL);
+  pthread_join(c, NULL);
+  return (double)(host_now_ns() - start) / 1e9;
+}
+
+int main(int argc, char **argv) {
+  size_t mb = argc > 1 ? strtoul(argv[1], NULL, 0) : 64;
+
+  s_total = mb << 20;
+  bt_ringbuf_init(&s_spsc, s_storage, RING_SIZE);
+  pthread_spin_init(&s_locked.lock, PTHREAD_PROCESS_PRIVATE);
+  s_locked.buf = s_storage;
+  s_locked.size = RING_SIZE;
+
+  double spsc_s = run(spsc_producer, spsc_consumer);
+  double locked_s = run(locked_producer, locked_consumer);
+  printf("%zu MB, %d-byte writes, %d-byte reads\n", mb, PACKET_BYTES,
+         CHUNK_BYTES);
+  printf("  spsc:   %8.0f MB/s, %6.1f ns per packet\n", mb / spsc_s,
+         spsc_s * 1e9 / (s_total / PACKET_BYTES));
+  printf("  locked: %8.0f MB/s, %6.1f ns per packet\n", mb / locked_s,
+         locked_s * 1e9 / (s_total / PACKET_BYTES));
+  return 0;
+}
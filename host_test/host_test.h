@@ -0,0 +1,54 @@
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* failed checks so far */
+static int s_host_failures;
+
+/* record a failure and carry on, so that one run reports them all */
+#define CHECK(cond)                                                  \
+  do {                                                               \
+    if (!(cond)) {                                                   \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+              #cond);                                                \
+      s_host_failures++;                                             \
+    }                                                                \
+  } while (0)
+
+/* exit status of a test program */
+static inline int host_test_done(void) {
+  if (s_host_failures) {
+    fprintf(stderr, "%d check(s) failed\n", s_host_failures);
+    return 1;
+  }
+  return 0;
+}
+
+/* monotonic time for the benchmarks */
+static inline uint64_t host_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* CPU time of the calling thread */
+static inline uint64_t host_thread_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* cycle counter where the host has one, else nanoseconds */
+static inline uint64_t host_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return host_now_ns();
+#endif
+}
+
+#endif /* __HOST_TEST_H__ */
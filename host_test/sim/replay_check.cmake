@@ -0,0 +1,42 @@
+# cmake -DREPLAY=<sim_replay> -DTRACE=<file> [-DRECORD=<sim_sink_trace>
+#       -DRECORD_ARGS="<sim_sink options>"] -P replay_check.cmake
+#
+# Replays TRACE twice and fails unless both runs report the same, to the
+# hash of the audio played. With RECORD, TRACE is first recorded by a run
+# of that sim_sink in virtual time, and the replay must also refill as the
+# run did and play the same audio.
+if(RECORD)
+  separate_arguments(args UNIX_COMMAND "${RECORD_ARGS}")
+  execute_process(COMMAND ${RECORD} -V ${args} RESULT_VARIABLE rc
+                  OUTPUT_FILE ${TRACE})
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "recording failed: ${rc}")
+  endif()
+endif()
+
+foreach(run 1 2)
+  execute_process(COMMAND ${REPLAY} ${TRACE} RESULT_VARIABLE rc
+                  OUTPUT_VARIABLE out${run})
+  if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "replay ${run} failed: ${rc}")
+  endif()
+endforeach()
+message("${out1}")
+if(NOT out1 STREQUAL out2)
+  message(FATAL_ERROR "the replays differ:\n${out2}")
+endif()
+
+if(RECORD)
+  file(READ ${TRACE} recorded)
+  string(REGEX MATCH "hash [0-9a-f]+" want "${recorded}")
+  string(REGEX MATCH "hash [0-9a-f]+" got "${out1}")
+  if(NOT want OR NOT want STREQUAL got)
+    message(FATAL_ERROR "the run played ${want}, the replay ${got}")
+  endif()
+  string(REGEX MATCH "\n  device: +([^\n]*)" line "${out1}")
+  set(device "${CMAKE_MATCH_1}")
+  string(REGEX MATCH "\n  replay: +([^\n]*)" line "${out1}")
+  if(NOT device STREQUAL CMAKE_MATCH_1)
+    message(FATAL_ERROR "the run made ${device}, the replay ${CMAKE_MATCH_1}")
+  endif()
+endif()
@@ -0,0 +1,86 @@
+/* Hooks into the host stand-ins for the sink simulation: start-up, the
+ * kernel the stand-ins block in, the threads' CPU time, the audio that
+ * reached the DAC and what the stack was told.
+ */
+#ifndef __HOST_SIM_H__
+#define __HOST_SIM_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_TASKS_MAX 64
+#define SIM_TASK_NAME_LEN 16
+#define SIM_FOREVER INT64_MAX /* a wait without timeout */
+#define SIM_PRIO_ISR 30       /* above every task, as an interrupt */
+
+/* a thread of the simulation; the tasks' handles are these */
+typedef struct tskTaskControlBlock sim_thread_t;
+
+/* what threads block on until another wakes them */
+typedef struct {
+  pthread_cond_t cond;
+} sim_waitq_t;
+
+typedef struct {
+  char name[SIM_TASK_NAME_LEN];
+  uint64_t cpu_ns;  /* thread CPU time so far */
+  uint32_t wakeups; /* times it blocked and ran again */
+} sim_task_info_t;
+
+/* what the I2S stand-in played */
+typedef struct {
+  uint64_t frames;  /* frames clocked out while enabled */
+  uint32_t buffers; /* DMA buffers played */
+  uint32_t silent;  /* of them, all zero */
+  uint32_t rate;    /* format of the last buffer */
+  uint8_t ch;
+  uint8_t sample_bytes;
+  uint32_t hash; /* FNV-1a of the audio, first to last buffer not silent */
+} sim_i2s_stats_t;
+
+/* before anything else: time zero, the cycle counter's rate and whether
+ * time is virtual, so the threads take turns and a run repeats exactly
+ */
+void sim_rtos_init(bool virtual_time);
+
+/* the kernel lock, recursive; waits and wakes are made under it */
+void sim_lock(void);
+void sim_unlock(void);
+void sim_waitq_init(sim_waitq_t *q);
+/* block until woken through `q`, or until `deadline_us` with false; a NULL
+ * `q` sleeps until the deadline
+ */
+bool sim_wait(sim_waitq_t *q, int64_t deadline_us);
+void sim_wake(sim_waitq_t *q);
+int64_t sim_now_us(void);
+void sim_sleep_until(int64_t us);
+sim_thread_t *sim_thread_create(const char *name, int prio,
+                                void (*fn)(void *arg), void *arg);
+void sim_thread_exit(void);
+void sim_thread_join(sim_thread_t *t);
+
+/* CPU time and wakeups of the tasks created so far and the thread that
+ * called init
+ */
+int sim_rtos_tasks(sim_task_info_t *info, int max);
+
+/* write what the DAC plays to a WAV file, in the format of the first
+ * buffer played; false if it can't be created
+ */
+bool sim_i2s_wav_open(const char *path);
+void sim_i2s_wav_close(void);
+
+/* run the output clock off nominal by ppm, on top of any APLL trim */
+void sim_i2s_set_ppm(int32_t ppm);
+void sim_i2s_stats(sim_i2s_stats_t *stats);
+
+/* the first octet of the SBC configuration the stack reports for a
+ * stream of `rate` and `ch` channels
+ */
+uint8_t sim_bt_sbc_oct0(uint32_t rate, uint8_t ch);
+
+/* last A2DP delay report, 1/10 ms, and how many were sent */
+uint16_t sim_bt_delay_value(uint32_t *reports);
+
+#endif /* __HOST_SIM_H__ */
@@ -0,0 +1,111 @@
+/* Bluetooth, NVS and display stand-ins: commands to the stack succeed and
+ * go nowhere, apart from the delay reports, which are kept. No peer is
+ * stored, so nothing reconnects at start.
+ */
+#include <esp_a2dp_api.h>
+#include <esp_avrc_api.h>
+#include <esp_gap_bt_api.h>
+#include <stdatomic.h>
+
+#include "bt_app_bda.h"
+#include "bt_app_display.h"
+#include "sim.h"
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+
+static atomic_uint s_delay_value;
+static atomic_uint s_delay_reports;
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+uint16_t sim_bt_delay_value(uint32_t *reports) {
+  *reports = atomic_load(&s_delay_reports);
+  return (uint16_t)atomic_load(&s_delay_value);
+}
+
+uint8_t sim_bt_sbc_oct0(uint32_t rate, uint8_t ch) {
+  uint8_t oct0 = 0x01; /* joint stereo */
+
+  switch (rate) {
+    case 32000:
+      oct0 |= 1 << 6;
+      break;
+    case 44100:
+      oct0 |= 1 << 5;
+      break;
+    case 48000:
+      oct0 |= 1 << 4;
+      break;
+  }
+  if (ch == 1) {
+    oct0 = 1 << 3 | (oct0 & 0xf0);
+  }
+  return oct0;
+}
+
+esp_err_t esp_a2d_sink_connect(esp_bd_addr_t remote_bda) { return ESP_OK; }
+
+esp_err_t esp_a2d_sink_set_delay_value(uint16_t delay_value) {
+  atomic_store(&s_delay_value, delay_value);
+  atomic_fetch_add(&s_delay_reports, 1);
+  return ESP_OK;
+}
+
+bool esp_avrc_rn_evt_bit_mask_operation(esp_avrc_bit_mask_op_t op,
+                                        esp_avrc_rn_evt_cap_mask_t *events,
+                                        esp_avrc_rn_event_ids_t event_id) {
+  uint16_t bit = (uint16_t)(1u << event_id);
+
+  switch (op) {
+    case ESP_AVRC_BIT_MASK_OP_SET:
+      events->bits |= bit;
+      return true;
+    case ESP_AVRC_BIT_MASK_OP_CLEAR:
+      events->bits &= ~bit;
+      return true;
+    default:
+      return (events->bits & bit) != 0;
+  }
+}
+
+esp_err_t esp_avrc_ct_send_get_rn_capabilities_cmd(uint8_t tl) {
+  return ESP_OK;
+}
+
+esp_err_t esp_avrc_ct_send_metadata_cmd(uint8_t tl, uint8_t attr_mask) {
+  return ESP_OK;
+}
+
+esp_err_t esp_avrc_ct_send_register_notification_cmd(uint8_t tl,
+                                                     uint8_t event_id,
+                                                     uint32_t interval) {
+  return ESP_OK;
+}
+
+esp_err_t esp_avrc_ct_send_passthrough_cmd(uint8_t tl, uint8_t key_code,
+                                           uint8_t key_state) {
+  return ESP_OK;
+}
+
+esp_err_t esp_avrc_ct_send_get_play_status_cmd(uint8_t tl) { return ESP_OK; }
+
+esp_err_t esp_avrc_tg_send_rn_rsp(esp_avrc_rn_event_ids_t event_id,
+                                  esp_avrc_rn_rsp_t rsp,
+                                  esp_avrc_rn_param_t *param) {
+  return ESP_OK;
+}
+
+esp_err_t esp_bt_gap_set_scan_mode(esp_bt_connection_mode_t c_mode,
+                                   esp_bt_discovery_mode_t d_mode) {
+  return ESP_OK;
+}
+
+bool nvs_read_bda(uint8_t *bda) { return false; }
+
+void nvs_update_bda(uint8_t *bda) {}
+
+void ui_update_status(ui_status_t status) {}
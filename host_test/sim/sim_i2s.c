@@ -0,0 +1,477 @@
+/* I2S channel and APLL stand-ins.
+ *
+ * The DMA is a thread per channel, above every task as the interrupt is,
+ * that plays the descriptors in a ring, one descriptor period at a time on
+ * the simulation's clock without drifting from the start: at the start of
+ * a period the descriptor is taken as played, into the WAV file and the
+ * counts, and at its end the on_sent callback gets it back, as the end of
+ * frame interrupt does. A descriptor the engine has not refilled by the
+ * time it comes round plays what it held. The WAV file starts with the
+ * first buffer that isn't silent and keeps its format; the hash runs from
+ * there to the last such buffer, so that two runs of the same audio match
+ * however long either idled around it.
+ */
+#include <clk_ctrl_os.h>
+#include <driver/i2s_std.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+#define APLL_XTAL_HZ 40000000
+#define APLL_MIN_HZ 5303031 /* SOC_APLL_MIN_HZ and _MAX_HZ */
+#define APLL_MAX_HZ 125000000
+
+/* under the kernel lock */
+struct i2s_channel_obj_t {
+  sim_waitq_t q; /* state changes and sent descriptors */
+  sim_thread_t *dma;
+  bool quit;
+  bool enabled;
+  bool auto_clear;
+  uint8_t **desc; /* DMA buffers */
+  size_t desc_num;
+  size_t desc_frames;
+  size_t desc_bytes;
+  uint32_t rate;
+  uint8_t ch;
+  uint8_t sample_bytes;
+  i2s_isr_callback_t on_sent;
+  void *user;
+  /* sent descriptors not yet written by i2s_channel_write, oldest first */
+  size_t *sent;
+  size_t sent_head;
+  size_t sent_count;
+  size_t write_off; /* bytes written into the oldest */
+};
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *s_wav;
+static bool s_wav_started; /* header written, in the format below */
+static uint32_t s_wav_rate;
+static uint8_t s_wav_ch;
+static uint8_t s_wav_sample_bytes;
+static uint64_t s_wav_bytes;
+static sim_i2s_stats_t s_stats = {.hash = 2166136261u};
+static uint32_t s_hash = 2166136261u; /* up to the last buffer played */
+static bool s_hash_started;
+static int32_t s_ppm;           /* crystal error of the output clock */
+static uint32_t s_apll_hz;      /* APLL frequency the driver set */
+static double s_apll_ratio = 1; /* and the trimmed rate relative to it */
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* the APLL frequency nearest freq that its coefficients can make */
+static uint32_t sim_apll_real(uint32_t freq);
+/* the driver's choice of APLL frequency for a clock configuration */
+static void sim_i2s_apll(const i2s_std_clk_config_t *clk_cfg);
+static void sim_i2s_dma(void *arg);
+/* a descriptor starts playing: write it out and count it */
+static void sim_i2s_play(i2s_chan_handle_t c, const uint8_t *buf);
+static void sim_i2s_wav_header(uint32_t data_bytes);
+/* finish the WAV file, with s_lock held */
+static void sim_i2s_wav_end(void);
+static void sim_i2s_put32(uint8_t *p, uint32_t v);
+static esp_err_t sim_i2s_alloc(i2s_chan_handle_t c);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static void sim_i2s_put32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static void sim_i2s_wav_header(uint32_t data_bytes) {
+  uint32_t rate = s_wav_rate;
+  uint8_t ch = s_wav_ch;
+  uint8_t bytes = s_wav_sample_bytes;
+  uint8_t h[44];
+
+  memcpy(h, "RIFF", 4);
+  sim_i2s_put32(h + 4, 36 + data_bytes);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  sim_i2s_put32(h + 16, 16);
+  sim_i2s_put32(h + 20, 1 | ch << 16); /* PCM */
+  sim_i2s_put32(h + 24, rate);
+  sim_i2s_put32(h + 28, rate * ch * bytes);
+  sim_i2s_put32(h + 32, (ch * bytes) | (bytes * 8) << 16);
+  memcpy(h + 36, "data", 4);
+  sim_i2s_put32(h + 40, data_bytes);
+  fseek(s_wav, 0, SEEK_SET);
+  fwrite(h, 1, sizeof(h), s_wav);
+  fseek(s_wav, 0, SEEK_END);
+}
+
+static void sim_i2s_play(i2s_chan_handle_t c, const uint8_t *buf) {
+  bool silent = true;
+
+  for (size_t i = 0; i < c->desc_bytes; i++) {
+    silent &= buf[i] == 0;
+  }
+  pthread_mutex_lock(&s_lock);
+  /* silence before and after the audio doesn't count */
+  s_hash_started |= !silent;
+  for (size_t i = 0; i < c->desc_bytes && s_hash_started; i++) {
+    s_hash = (s_hash ^ buf[i]) * 16777619u;
+  }
+  if (!silent) {
+    s_stats.hash = s_hash;
+  }
+  if (s_wav && !s_wav_started && !silent) {
+    s_wav_rate = c->rate;
+    s_wav_ch = c->ch;
+    s_wav_sample_bytes = c->sample_bytes;
+    s_wav_started = true;
+    sim_i2s_wav_header(0);
+  }
+  if (s_wav_started && (c->rate != s_wav_rate || c->ch != s_wav_ch ||
+                        c->sample_bytes != s_wav_sample_bytes)) {
+    fprintf(stderr, "sim_i2s: format changed, WAV stops here\n");
+    sim_i2s_wav_end();
+  }
+  if (s_wav_started) {
+    fwrite(buf, 1, c->desc_bytes, s_wav);
+    s_wav_bytes += c->desc_bytes;
+  }
+  s_stats.frames += c->desc_frames;
+  s_stats.buffers++;
+  s_stats.silent += silent;
+  s_stats.rate = c->rate;
+  s_stats.ch = c->ch;
+  s_stats.sample_bytes = c->sample_bytes;
+  pthread_mutex_unlock(&s_lock);
+}
+
+static void sim_i2s_dma(void *arg) {
+  i2s_chan_handle_t c = arg;
+  double next_us = 0; /* end of the period playing */
+  size_t idx = 0;
+  bool running = false;
+
+  sim_lock();
+  while (!c->quit) {
+    if (!c->enabled) {
+      running = false;
+      sim_wait(&c->q, SIM_FOREVER);
+      continue;
+    }
+    if (!running) {
+      /* the ring starts over from the first descriptor */
+      next_us = sim_now_us();
+      idx = 0;
+      running = true;
+    }
+    sim_i2s_play(c, c->desc[idx]);
+
+    pthread_mutex_lock(&s_lock);
+    double hz = c->rate * s_apll_ratio * (1 + s_ppm * 1e-6);
+    pthread_mutex_unlock(&s_lock);
+    next_us += c->desc_frames * 1e6 / hz;
+    /* a state change wakes it early; the period still runs to its end */
+    while (c->enabled && sim_wait(&c->q, (int64_t)next_us)) {
+    }
+    if (!c->enabled) {
+      continue;
+    }
+
+    /* end of frame */
+    i2s_event_data_t event = {.data = &c->desc[idx], .size = c->desc_bytes};
+    if (c->on_sent) {
+      c->on_sent(c, &event, c->user);
+    }
+    if (c->auto_clear) {
+      memset(c->desc[idx], 0, c->desc_bytes);
+    }
+    if (c->sent_count == c->desc_num) {
+      /* nobody writes; the oldest goes round again */
+      c->sent_head = (c->sent_head + 1) % c->desc_num;
+      c->sent_count--;
+      c->write_off = 0;
+    }
+    c->sent[(c->sent_head + c->sent_count) % c->desc_num] = idx;
+    c->sent_count++;
+    sim_wake(&c->q);
+    idx = (idx + 1) % c->desc_num;
+  }
+  sim_unlock();
+}
+
+static void sim_i2s_wav_end(void) {
+  if (s_wav == NULL) {
+    return;
+  }
+  if (s_wav_started) {
+    sim_i2s_wav_header((uint32_t)s_wav_bytes);
+  }
+  fclose(s_wav);
+  s_wav = NULL;
+  s_wav_started = false;
+}
+
+static esp_err_t sim_i2s_alloc(i2s_chan_handle_t c) {
+  /* fresh buffers on every change, so a stale pointer shows up under ASan */
+  for (size_t i = 0; i < c->desc_num; i++) {
+    free(c->desc[i]);
+    c->desc[i] = calloc(1, c->desc_bytes);
+    if (c->desc[i] == NULL) {
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  c->sent_head = 0;
+  c->sent_count = 0;
+  c->write_off = 0;
+  return ESP_OK;
+}
+
+static uint32_t sim_apll_real(uint32_t freq) {
+  /* the output is xtal * (4 + sdm / 2^16) / (2 * (o_div + 2)), with the
+   * oscillator between 350 and 500 MHz
+   */
+  uint32_t div = 0;
+
+  while (div < 31 && (uint64_t)freq * 2 * (div + 2) < 350000000) {
+    div++;
+  }
+  uint64_t vco = (uint64_t)freq * 2 * (div + 2);
+  uint64_t sdm = (vco << 16) / APLL_XTAL_HZ - (4 << 16);
+  return (uint32_t)(((uint64_t)APLL_XTAL_HZ * ((4 << 16) + sdm) >> 16) /
+                    (2 * (div + 2)));
+}
+
+static void sim_i2s_apll(const i2s_std_clk_config_t *clk_cfg) {
+  if (clk_cfg->clk_src != I2S_CLK_SRC_APLL) {
+    return;
+  }
+  /* as the driver does: the smallest multiple of MCLK above the APLL's
+   * lowest frequency, at least twice MCLK; any trim is undone
+   */
+  uint32_t mclk = clk_cfg->sample_rate_hz * clk_cfg->mclk_multiple;
+  uint32_t div = APLL_MIN_HZ / mclk + 1;
+  if (div < 2) {
+    div = 2;
+  }
+  pthread_mutex_lock(&s_lock);
+  s_apll_hz = sim_apll_real(mclk * div);
+  s_apll_ratio = 1;
+  pthread_mutex_unlock(&s_lock);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+bool sim_i2s_wav_open(const char *path) {
+  pthread_mutex_lock(&s_lock);
+  s_wav = fopen(path, "wb");
+  s_wav_bytes = 0;
+  pthread_mutex_unlock(&s_lock);
+  return s_wav != NULL;
+}
+
+void sim_i2s_wav_close(void) {
+  pthread_mutex_lock(&s_lock);
+  sim_i2s_wav_end();
+  pthread_mutex_unlock(&s_lock);
+}
+
+void sim_i2s_set_ppm(int32_t ppm) {
+  pthread_mutex_lock(&s_lock);
+  s_ppm = ppm;
+  pthread_mutex_unlock(&s_lock);
+}
+
+void sim_i2s_stats(sim_i2s_stats_t *stats) {
+  pthread_mutex_lock(&s_lock);
+  *stats = s_stats;
+  pthread_mutex_unlock(&s_lock);
+}
+
+esp_err_t i2s_new_channel(const i2s_chan_config_t *chan_cfg,
+                          i2s_chan_handle_t *tx, i2s_chan_handle_t *rx) {
+  i2s_chan_handle_t c = calloc(1, sizeof(*c));
+
+  if (c == NULL || tx == NULL) {
+    free(c);
+    return ESP_ERR_INVALID_ARG;
+  }
+  sim_waitq_init(&c->q);
+  c->auto_clear = chan_cfg->auto_clear;
+  c->desc_num = chan_cfg->dma_desc_num;
+  c->desc_frames = chan_cfg->dma_frame_num;
+  c->desc = calloc(c->desc_num, sizeof(*c->desc));
+  c->sent = calloc(c->desc_num, sizeof(*c->sent));
+  c->dma = sim_thread_create("I2S DMA", SIM_PRIO_ISR, sim_i2s_dma, c);
+  *tx = c;
+  return ESP_OK;
+}
+
+esp_err_t i2s_del_channel(i2s_chan_handle_t c) {
+  sim_lock();
+  c->quit = true;
+  c->enabled = false;
+  sim_wake(&c->q);
+  sim_unlock();
+  sim_thread_join(c->dma);
+  for (size_t i = 0; i < c->desc_num; i++) {
+    free(c->desc[i]);
+  }
+  free(c->desc);
+  free(c->sent);
+  pthread_cond_destroy(&c->q.cond);
+  free(c);
+  return ESP_OK;
+}
+
+esp_err_t i2s_channel_init_std_mode(i2s_chan_handle_t c,
+                                    const i2s_std_config_t *std_cfg) {
+  esp_err_t err;
+
+  sim_lock();
+  c->rate = std_cfg->clk_cfg.sample_rate_hz;
+  sim_i2s_apll(&std_cfg->clk_cfg);
+  c->ch = std_cfg->slot_cfg.slot_mode == I2S_SLOT_MODE_MONO ? 1 : 2;
+  c->sample_bytes = std_cfg->slot_cfg.data_bit_width / 8;
+  c->desc_bytes = c->desc_frames * c->ch * c->sample_bytes;
+  err = sim_i2s_alloc(c);
+  sim_unlock();
+  return err;
+}
+
+esp_err_t i2s_channel_reconfig_std_clock(i2s_chan_handle_t c,
+                                         const i2s_std_clk_config_t *clk_cfg) {
+  esp_err_t err = ESP_OK;
+
+  sim_lock();
+  if (c->enabled) {
+    err = ESP_ERR_INVALID_STATE;
+  } else {
+    c->rate = clk_cfg->sample_rate_hz;
+    sim_i2s_apll(clk_cfg);
+  }
+  sim_unlock();
+  return err;
+}
+
+esp_err_t i2s_channel_reconfig_std_slot(
+    i2s_chan_handle_t c, const i2s_std_slot_config_t *slot_cfg) {
+  esp_err_t err = ESP_OK;
+
+  sim_lock();
+  if (c->enabled) {
+    err = ESP_ERR_INVALID_STATE;
+  } else {
+    uint8_t ch = slot_cfg->slot_mode == I2S_SLOT_MODE_MONO ? 1 : 2;
+    uint8_t bytes = slot_cfg->data_bit_width / 8;
+    if (ch != c->ch || bytes != c->sample_bytes) {
+      c->ch = ch;
+      c->sample_bytes = bytes;
+      c->desc_bytes = c->desc_frames * ch * bytes;
+      err = sim_i2s_alloc(c);
+    }
+  }
+  sim_unlock();
+  return err;
+}
+
+esp_err_t i2s_channel_enable(i2s_chan_handle_t c) {
+  esp_err_t err = ESP_OK;
+
+  sim_lock();
+  if (c->enabled) {
+    err = ESP_ERR_INVALID_STATE;
+  } else {
+    c->enabled = true;
+    c->sent_head = 0;
+    c->sent_count = 0;
+    c->write_off = 0;
+    sim_wake(&c->q);
+  }
+  sim_unlock();
+  return err;
+}
+
+esp_err_t i2s_channel_disable(i2s_chan_handle_t c) {
+  esp_err_t err = ESP_OK;
+
+  sim_lock();
+  if (!c->enabled) {
+    err = ESP_ERR_INVALID_STATE;
+  }
+  c->enabled = false;
+  sim_wake(&c->q);
+  sim_unlock();
+  return err;
+}
+
+esp_err_t i2s_channel_write(i2s_chan_handle_t c, const void *src, size_t size,
+                            size_t *bytes_written, uint32_t timeout_ms) {
+  const uint8_t *p = src;
+  int64_t deadline = sim_now_us() + (int64_t)timeout_ms * 1000;
+  esp_err_t err = ESP_OK;
+
+  *bytes_written = 0;
+  sim_lock();
+  while (size) {
+    if (!c->enabled) {
+      err = ESP_ERR_INVALID_STATE;
+      break;
+    }
+    if (c->sent_count == 0) {
+      if (!sim_wait(&c->q, deadline)) {
+        err = ESP_ERR_TIMEOUT;
+        break;
+      }
+      continue;
+    }
+    uint8_t *buf = c->desc[c->sent[c->sent_head]];
+    size_t n = c->desc_bytes - c->write_off;
+    if (n > size) {
+      n = size;
+    }
+    memcpy(buf + c->write_off, p, n);
+    p += n;
+    size -= n;
+    *bytes_written += n;
+    c->write_off += n;
+    if (c->write_off == c->desc_bytes) {
+      c->sent_head = (c->sent_head + 1) % c->desc_num;
+      c->sent_count--;
+      c->write_off = 0;
+    }
+  }
+  sim_unlock();
+  return err;
+}
+
+esp_err_t i2s_channel_register_event_callback(
+    i2s_chan_handle_t c, const i2s_event_callbacks_t *callbacks,
+    void *user_data) {
+  sim_lock();
+  c->on_sent = callbacks->on_sent;
+  c->user = user_data;
+  sim_unlock();
+  return ESP_OK;
+}
+
+esp_err_t periph_rtc_apll_freq_set(uint32_t expt_freq,
+                                   uint32_t *real_freq) {
+  if (expt_freq < APLL_MIN_HZ || expt_freq > APLL_MAX_HZ) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *real_freq = sim_apll_real(expt_freq);
+  pthread_mutex_lock(&s_lock);
+  s_apll_ratio = s_apll_hz ? (double)*real_freq / s_apll_hz : 1;
+  pthread_mutex_unlock(&s_lock);
+  return ESP_OK;
+}
@@ -0,0 +1,403 @@
+/* Replays a trace dumped by a sink built with CONFIG_EXAMPLE_A2DP_SINK_TRACE
+ * through the data path sim_sink runs, in virtual time, so a replay
+ * repeats exactly. The A2DP events and the audio packets go in at the
+ * offsets they were recorded at, each packet a sine of the recorded size;
+ * the engine's refills are counted as the device recorded its own, and
+ * both are reported side by side. A trace that starts mid-stream gets a
+ * connection first, at the rate of its first configuration or -r and -c.
+ *
+ *   sim_replay [-r rate] [-c channels] [-o out.wav] [-v] [trace]
+ *
+ * The trace is read from the file, or stdin, as the console printed it:
+ * lines outside "#TRACE" ... "#END" are skipped, so a whole log will do,
+ * and of several dumps the first is taken. Nothing in the report depends
+ * on the host, so two replays of one trace print the same.
+ */
+#include <esp_a2dp_api.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bt_app_av.h"
+#include "bt_app_core.h"
+#include "bt_app_i2s.h"
+#include "bt_app_trace.h"
+#include "sim.h"
+
+#define TONE_HZ 997 /* as sim_sink plays, so the same run hashes the same */
+#define TONE_AMP 16384
+#define DRAIN_MS 500 /* longer than the ringbuffer and DMA queue can hold */
+#define EVENT_MS 20  /* between the events of a made-up connection */
+
+typedef struct {
+  uint32_t rate; /* of a made-up connection without a configuration */
+  uint8_t ch;
+  const char *wav;
+  bool verbose;
+} sim_opts_t;
+
+/* refills, as BT_TRACE_RENDER records them */
+typedef struct {
+  uint32_t refills;
+  uint32_t concealed;
+  uint32_t underflows;
+} sim_refills_t;
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+
+static sim_opts_t s_opts = {
+    .rate = 44100,
+    .ch = 2,
+};
+static bt_trace_rec_t *s_recs;
+static uint32_t s_rec_count;
+static sim_refills_t s_device; /* recorded in the trace */
+static atomic_uint s_refills;  /* the engine's, in the replay */
+static atomic_uint s_concealed;
+static atomic_uint s_underflows;
+static uint32_t s_packets;
+static uint32_t s_rate; /* current stream format */
+static uint8_t s_ch;
+static bool s_connected;
+static bool s_started;
+static bt_i2s_stats_t s_end; /* as the last stream stopped */
+static volatile bool s_replay_done;
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* read the first dump in `f`; false with a message if there is none */
+static bool sim_trace_load(FILE *f);
+static void sim_a2d_event(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *p);
+static void sim_conn_event(esp_a2d_connection_state_t state);
+static void sim_audio_event(esp_a2d_audio_state_t state);
+static void sim_cfg_event(void);
+/* the stack's events up to a started stream, for a trace without them */
+static void sim_connect(void);
+static void sim_packet(uint16_t bytes);
+static void sim_replay_task(void *arg);
+static void sim_report(const bt_i2s_stats_t *end);
+static void sim_usage(void);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static bool sim_trace_load(FILE *f) {
+  char line[512];
+  uint32_t count = 0;
+  bool in_trace = false;
+
+  while (fgets(line, sizeof(line), f)) {
+    if (!in_trace) {
+      int version;
+      unsigned size;
+      if (sscanf(line, "#TRACE %d %u %" SCNu32, &version, &size, &count) !=
+          3) {
+        continue;
+      }
+      if (version != BT_TRACE_VERSION || size != sizeof(bt_trace_rec_t)) {
+        fprintf(stderr,
+                "sim_replay: trace version %d with %u-byte records, "
+                "expected %d with %u\n",
+                version, size, BT_TRACE_VERSION,
+                (unsigned)sizeof(bt_trace_rec_t));
+        return false;
+      }
+      s_recs = calloc(count ? count : 1, sizeof(*s_recs));
+      in_trace = true;
+      continue;
+    }
+    if (strncmp(line, "#END", 4) == 0) {
+      if (s_rec_count != count) {
+        fprintf(stderr, "sim_replay: %" PRIu32 " of %" PRIu32 " records\n",
+                s_rec_count, count);
+        return false;
+      }
+      return true;
+    }
+    for (char *tok = strtok(line, " \t\r\n"); tok;
+         tok = strtok(NULL, " \t\r\n")) {
+      uint32_t t_us;
+      unsigned type, arg, val;
+      if (strlen(tok) != 16 || strspn(tok, "0123456789abcdefABCDEF") != 16 ||
+          s_rec_count == count ||
+          sscanf(tok, "%8" SCNx32 "%2x%2x%4x", &t_us, &type, &arg, &val) !=
+              4) {
+        fprintf(stderr, "sim_replay: bad record \"%s\"\n", tok);
+        return false;
+      }
+      s_recs[s_rec_count++] = (bt_trace_rec_t){
+          .t_us = t_us,
+          .type = (uint8_t)type,
+          .arg = (uint8_t)arg,
+          .val = (uint16_t)val,
+      };
+    }
+  }
+  fprintf(stderr, "sim_replay: no complete trace\n");
+  return false;
+}
+
+static void sim_a2d_event(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *p) {
+  bt_app_a2d_cb(event, p);
+}
+
+static void sim_conn_event(esp_a2d_connection_state_t state) {
+  esp_a2d_cb_param_t p;
+
+  memset(&p, 0, sizeof(p));
+  p.conn_stat.state = state;
+  s_connected = state == ESP_A2D_CONNECTION_STATE_CONNECTED;
+  sim_a2d_event(ESP_A2D_CONNECTION_STATE_EVT, &p);
+}
+
+static void sim_audio_event(esp_a2d_audio_state_t state) {
+  esp_a2d_cb_param_t p;
+
+  memset(&p, 0, sizeof(p));
+  p.audio_stat.state = state;
+  if (s_started && state != ESP_A2D_AUDIO_STATE_STARTED) {
+    bt_i2s_stats(&s_end);
+  }
+  s_started = state == ESP_A2D_AUDIO_STATE_STARTED;
+  sim_a2d_event(ESP_A2D_AUDIO_STATE_EVT, &p);
+}
+
+static void sim_cfg_event(void) {
+  esp_a2d_cb_param_t p;
+
+  memset(&p, 0, sizeof(p));
+  p.audio_cfg.mcc.type = ESP_A2D_MCT_SBC;
+  p.audio_cfg.mcc.cie.sbc[0] = sim_bt_sbc_oct0(s_rate, s_ch);
+  sim_a2d_event(ESP_A2D_AUDIO_CFG_EVT, &p);
+}
+
+static void sim_connect(void) {
+  s_rate = s_opts.rate;
+  s_ch = s_opts.ch;
+  for (uint32_t i = 0; i < s_rec_count; i++) {
+    if (s_recs[i].type == BT_TRACE_A2D_CFG) {
+      s_rate = s_recs[i].val;
+      s_ch = s_recs[i].arg;
+      break;
+    }
+  }
+  sim_conn_event(ESP_A2D_CONNECTION_STATE_CONNECTING);
+  vTaskDelay(pdMS_TO_TICKS(EVENT_MS));
+  sim_cfg_event();
+  vTaskDelay(pdMS_TO_TICKS(EVENT_MS));
+  sim_conn_event(ESP_A2D_CONNECTION_STATE_CONNECTED);
+  vTaskDelay(pdMS_TO_TICKS(EVENT_MS));
+  sim_audio_event(ESP_A2D_AUDIO_STATE_STARTED);
+  vTaskDelay(pdMS_TO_TICKS(EVENT_MS));
+}
+
+static void sim_packet(uint16_t bytes) {
+  static uint64_t frame; /* the tone runs on across packets */
+  static int16_t pcm[UINT16_MAX / sizeof(int16_t) + 1];
+  uint8_t ch = s_ch ? s_ch : 2;
+  uint32_t frames = bytes / (ch * sizeof(int16_t));
+  uint32_t rate = s_rate ? s_rate : 44100;
+
+  memset(pcm, 0, bytes);
+  for (uint32_t i = 0; i < frames; i++, frame++) {
+    int16_t v =
+        (int16_t)(TONE_AMP * sin(2 * M_PI * TONE_HZ * (double)frame / rate));
+    for (uint8_t c = 0; c < ch; c++) {
+      pcm[i * ch + c] = v;
+    }
+  }
+  bt_app_a2d_data_cb((const uint8_t *)pcm, bytes);
+  s_packets++;
+}
+
+static void sim_replay_task(void *arg) {
+  bool stream_first = false; /* started before its first packet */
+
+  for (uint32_t i = 0; i < s_rec_count; i++) {
+    if (s_recs[i].type == BT_TRACE_A2D_AUDIO &&
+        s_recs[i].arg == ESP_A2D_AUDIO_STATE_STARTED) {
+      stream_first = true;
+      break;
+    }
+    if (s_recs[i].type == BT_TRACE_PACKET) {
+      break;
+    }
+  }
+  if (!stream_first) {
+    sim_connect();
+  }
+
+  /* the record times are the low 32 bits of the clock; only the
+   * differences count, and they survive a wrap
+   */
+  int64_t base_us = sim_now_us();
+  uint32_t t0 = s_recs[0].t_us;
+  for (uint32_t i = 0; i < s_rec_count; i++) {
+    const bt_trace_rec_t *rec = &s_recs[i];
+    sim_sleep_until(base_us + (uint32_t)(rec->t_us - t0));
+    switch (rec->type) {
+      case BT_TRACE_PACKET:
+        sim_packet(rec->val);
+        break;
+      case BT_TRACE_RENDER:
+        s_device.refills++;
+        s_device.concealed += (rec->arg & BT_TRACE_RENDER_CONCEALED) != 0;
+        s_device.underflows += (rec->arg & BT_TRACE_RENDER_UNDERFLOW) != 0;
+        break;
+      case BT_TRACE_A2D_CONN:
+        sim_conn_event((esp_a2d_connection_state_t)rec->arg);
+        break;
+      case BT_TRACE_A2D_AUDIO:
+        sim_audio_event((esp_a2d_audio_state_t)rec->arg);
+        break;
+      case BT_TRACE_A2D_CFG:
+        s_rate = rec->val;
+        s_ch = rec->arg;
+        sim_cfg_event();
+        break;
+      default:
+        /* AVRCP doesn't reach the data path */
+        break;
+    }
+  }
+
+  /* a trace cut off mid-stream plays out what arrived and stops */
+  if (s_started) {
+    vTaskDelay(pdMS_TO_TICKS(DRAIN_MS));
+    sim_audio_event(ESP_A2D_AUDIO_STATE_SUSPEND);
+    vTaskDelay(pdMS_TO_TICKS(EVENT_MS));
+  }
+  if (s_connected) {
+    sim_conn_event(ESP_A2D_CONNECTION_STATE_DISCONNECTED);
+    vTaskDelay(pdMS_TO_TICKS(EVENT_MS));
+  }
+  vTaskDelay(pdMS_TO_TICKS(100));
+  sim_i2s_wav_close();
+  s_replay_done = true;
+  vTaskDelete(NULL);
+}
+
+static void sim_report(const bt_i2s_stats_t *end) {
+  sim_i2s_stats_t out;
+  uint32_t span_us =
+      s_rec_count ? s_recs[s_rec_count - 1].t_us - s_recs[0].t_us : 0;
+  double elapsed_s = end->elapsed_us / 1e6;
+
+  sim_i2s_stats(&out);
+  printf("sim_replay: %" PRIu32 " events over %.3f s, %" PRIu32
+         " packets, %" PRIu32 " Hz %u ch\n",
+         s_rec_count, span_us / 1e6, s_packets, s_rate, s_ch);
+  printf("  device:  %" PRIu32 " refills, %" PRIu32 " concealed, %" PRIu32
+         " underflows\n",
+         s_device.refills, s_device.concealed, s_device.underflows);
+  printf("  replay:  %u refills, %u concealed, %u underflows\n",
+         atomic_load(&s_refills), atomic_load(&s_concealed),
+         atomic_load(&s_underflows));
+  printf("  engine:  %" PRIu32 " underruns, %" PRIu32
+         " bytes dropped, %.0f wakeups/s, %.0f buffers/s\n",
+         end->underruns, end->dropped,
+         elapsed_s > 0 ? end->wakeups / elapsed_s : 0,
+         elapsed_s > 0 ? end->chunks / elapsed_s : 0);
+  printf("  latency: %" PRIu32 " packets to the DAC, worst %.1f ms\n",
+         end->packets, end->latency_max_us / 1000.0);
+  printf("  output:  %" PRIu64 " frames in %" PRIu32 " buffers, %" PRIu32
+         " silent, hash %08" PRIx32 "\n",
+         out.frames, out.buffers, out.silent, out.hash);
+}
+
+static void sim_usage(void) {
+  fprintf(stderr,
+          "usage: sim_replay [-r rate] [-c channels] [-o out.wav] [-v] "
+          "[trace]\n");
+  exit(2);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+/* the engine's trace points, counted here rather than kept */
+void bt_trace_record(bt_trace_type_t type, uint8_t arg, uint16_t val) {
+  if (type == BT_TRACE_RENDER) {
+    atomic_fetch_add(&s_refills, 1);
+    atomic_fetch_add(&s_concealed, (arg & BT_TRACE_RENDER_CONCEALED) != 0);
+    atomic_fetch_add(&s_underflows, (arg & BT_TRACE_RENDER_UNDERFLOW) != 0);
+  }
+}
+
+void bt_trace_dump(void) {}
+
+int main(int argc, char **argv) {
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:c:o:v")) != -1) {
+    switch (opt) {
+      case 'r':
+        s_opts.rate = strtoul(optarg, NULL, 10);
+        break;
+      case 'c':
+        s_opts.ch = (uint8_t)strtoul(optarg, NULL, 10);
+        break;
+      case 'o':
+        s_opts.wav = optarg;
+        break;
+      case 'v':
+        s_opts.verbose = true;
+        break;
+      default:
+        sim_usage();
+    }
+  }
+  if (argc - optind > 1 || (s_opts.ch != 1 && s_opts.ch != 2)) {
+    sim_usage();
+  }
+
+  FILE *f = optind < argc ? fopen(argv[optind], "r") : stdin;
+  if (f == NULL) {
+    perror(argv[optind]);
+    return 1;
+  }
+  bool loaded = sim_trace_load(f);
+  if (f != stdin) {
+    fclose(f);
+  }
+  if (!loaded) {
+    return 1;
+  }
+  if (s_rec_count == 0) {
+    fprintf(stderr, "sim_replay: the trace is empty\n");
+    return 1;
+  }
+
+  sim_rtos_init(true);
+  esp_log_level_set("*", s_opts.verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+  if (s_opts.wav && !sim_i2s_wav_open(s_opts.wav)) {
+    perror(s_opts.wav);
+    return 1;
+  }
+  if (!bt_i2s_engine_init()) {
+    fprintf(stderr, "sim_replay: engine init failed\n");
+    return 1;
+  }
+  bt_app_task_start_up();
+
+  /* the packets arrive on the stack's task, as on the device */
+  xTaskCreate(sim_replay_task, "BtcTask", 4096, NULL, 19, NULL);
+  while (!s_replay_done) {
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+  sim_report(&s_end);
+  return 0;
+}
@@ -0,0 +1,726 @@
+/* FreeRTOS, esp_timer, log and cycle counter stand-ins on pthreads.
+ *
+ * Every task, the esp_timer service and each I2S DMA is a thread, and
+ * every blocking call waits on a queue of the small kernel below, under
+ * one lock. In real time the threads run concurrently, as on the two
+ * cores, and waits time out on the monotonic clock. In virtual time they
+ * take turns: one thread runs until it blocks, then the ready one of the
+ * highest priority, first come first served, and when none is ready the
+ * clock jumps to the earliest timeout. Nothing then depends on the host's
+ * scheduler or speed, so a run repeats exactly. A thread woken in virtual
+ * time waits for the running one to block rather than preempting it.
+ */
+#include <errno.h>
+#include <esp_cpu.h>
+#include <esp_log.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+
+#define SIM_PRIO_TIMER (SIM_PRIO_ISR - 1)
+
+typedef enum {
+  SIM_READY,
+  SIM_RUNNING,
+  SIM_BLOCKED,
+  SIM_EXITED,
+} sim_state_t;
+
+struct tskTaskControlBlock {
+  pthread_t thread;
+  void (*fn)(void *arg);
+  void *arg;
+  char name[SIM_TASK_NAME_LEN];
+  int prio;
+  /* virtual time: its turn to run; real time: its sleeps */
+  pthread_cond_t cond;
+  sim_state_t state;
+  const sim_waitq_t *waitq; /* blocked on, NULL for a sleep */
+  int64_t deadline_us;      /* of the wait, SIM_FOREVER for none */
+  uint64_t ready_seq;       /* order it became ready in */
+  bool woken;               /* the wait ended by a wake, not a timeout */
+  uint32_t notify;          /* task notification value, counting gives */
+  sim_waitq_t notify_q;
+  sim_waitq_t exit_q;
+  uint32_t wakeups; /* waits that blocked */
+  uint64_t cpu_ns;  /* CPU time at exit */
+};
+
+struct QueueDefinition {
+  sim_waitq_t q;
+  uint8_t *items;
+  size_t item_size;
+  UBaseType_t len;
+  UBaseType_t head; /* oldest item */
+  UBaseType_t count;
+};
+
+struct esp_timer {
+  esp_timer_cb_t cb;
+  void *arg;
+  bool armed;
+  int64_t deadline_us;
+  uint64_t period_us; /* 0 for one shot */
+  struct esp_timer *next;
+};
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+
+static pthread_mutex_t s_kernel; /* recursive; guards all of the below */
+static bool s_virtual;
+static int64_t s_vnow_us;       /* virtual time */
+static struct timespec s_start; /* real time zero */
+/* every thread ever started, in creation order */
+static sim_thread_t *s_threads[SIM_TASKS_MAX];
+static int s_thread_count;
+static sim_thread_t *s_current; /* virtual time: the one running */
+static uint64_t s_ready_seq;
+static __thread sim_thread_t *s_self;
+/* armed and stopped timers, served by one thread */
+static struct esp_timer *s_timers;
+static sim_waitq_t s_timer_q;
+static bool s_timer_running;
+static esp_log_level_t s_log_level = ESP_LOG_INFO;
+static pthread_mutex_t s_log_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t s_ticks_per_us = 1;
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+static void sim_cond_init(pthread_cond_t *cond);
+static sim_thread_t *sim_thread_new(const char *name, int prio);
+static void *sim_thread_main(void *arg);
+static void sim_make_ready(sim_thread_t *t, bool woken);
+/* virtual time: hand over to the next thread to run, moving the clock on
+ * to the earliest timeout while none is ready
+ */
+static void sim_pick_next(void);
+static uint64_t sim_thread_cpu_ns(sim_thread_t *t);
+/* the time `ticks` from now, SIM_FOREVER for portMAX_DELAY */
+static int64_t sim_tick_deadline(TickType_t ticks);
+static QueueHandle_t sim_queue_new(UBaseType_t len, size_t item_size,
+                                   UBaseType_t count);
+static void sim_timer_main(void *arg);
+static uint64_t sim_cycles(void);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static void sim_cond_init(pthread_cond_t *cond) {
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+static sim_thread_t *sim_thread_new(const char *name, int prio) {
+  sim_thread_t *t = calloc(1, sizeof(*t));
+
+  if (t == NULL || s_thread_count == SIM_TASKS_MAX) {
+    fprintf(stderr, "sim: more than %d threads\n", SIM_TASKS_MAX);
+    abort();
+  }
+  snprintf(t->name, sizeof(t->name), "%s", name);
+  t->prio = prio;
+  sim_cond_init(&t->cond);
+  sim_waitq_init(&t->notify_q);
+  sim_waitq_init(&t->exit_q);
+  s_threads[s_thread_count++] = t;
+  return t;
+}
+
+static void *sim_thread_main(void *arg) {
+  sim_thread_t *t = arg;
+
+  s_self = t;
+  sim_lock();
+  while (s_virtual && s_current != t) {
+    pthread_cond_wait(&t->cond, &s_kernel);
+  }
+  sim_unlock();
+  t->fn(t->arg);
+  sim_thread_exit();
+  return NULL;
+}
+
+static void sim_make_ready(sim_thread_t *t, bool woken) {
+  t->state = SIM_READY;
+  t->woken = woken;
+  t->waitq = NULL;
+  t->ready_seq = s_ready_seq++;
+}
+
+static void sim_pick_next(void) {
+  for (;;) {
+    sim_thread_t *best = NULL;
+    for (int i = 0; i < s_thread_count; i++) {
+      sim_thread_t *t = s_threads[i];
+      if (t->state == SIM_READY &&
+          (best == NULL || t->prio > best->prio ||
+           (t->prio == best->prio && t->ready_seq < best->ready_seq))) {
+        best = t;
+      }
+    }
+    if (best) {
+      best->state = SIM_RUNNING;
+      s_current = best;
+      pthread_cond_signal(&best->cond);
+      return;
+    }
+
+    int64_t next = SIM_FOREVER;
+    for (int i = 0; i < s_thread_count; i++) {
+      sim_thread_t *t = s_threads[i];
+      if (t->state == SIM_BLOCKED && t->deadline_us < next) {
+        next = t->deadline_us;
+      }
+    }
+    if (next == SIM_FOREVER) {
+      fprintf(stderr, "sim: every thread is blocked for good\n");
+      abort();
+    }
+    s_vnow_us = next;
+    for (int i = 0; i < s_thread_count; i++) {
+      sim_thread_t *t = s_threads[i];
+      if (t->state == SIM_BLOCKED && t->deadline_us <= s_vnow_us) {
+        sim_make_ready(t, false);
+      }
+    }
+  }
+}
+
+static uint64_t sim_thread_cpu_ns(sim_thread_t *t) {
+  clockid_t clock;
+  struct timespec ts;
+
+  if (t->state == SIM_EXITED) {
+    return t->cpu_ns;
+  }
+  if (pthread_getcpuclockid(t->thread, &clock) != 0 ||
+      clock_gettime(clock, &ts) != 0) {
+    return 0;
+  }
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int64_t sim_tick_deadline(TickType_t ticks) {
+  if (ticks == portMAX_DELAY) {
+    return SIM_FOREVER;
+  }
+  return sim_now_us() + (int64_t)ticks * 1000000 / configTICK_RATE_HZ;
+}
+
+static QueueHandle_t sim_queue_new(UBaseType_t len, size_t item_size,
+                                   UBaseType_t count) {
+  QueueHandle_t q = calloc(1, sizeof(*q));
+
+  sim_waitq_init(&q->q);
+  q->items = calloc(len, item_size ? item_size : 1);
+  q->item_size = item_size;
+  q->len = len;
+  q->count = count;
+  return q;
+}
+
+static void sim_timer_main(void *arg) {
+  sim_lock();
+  for (;;) {
+    struct esp_timer *due = NULL;
+    for (struct esp_timer *t = s_timers; t; t = t->next) {
+      if (t->armed && (!due || t->deadline_us < due->deadline_us)) {
+        due = t;
+      }
+    }
+    if (due == NULL) {
+      sim_wait(&s_timer_q, SIM_FOREVER);
+      continue;
+    }
+    if (due->deadline_us > sim_now_us()) {
+      sim_wait(&s_timer_q, due->deadline_us);
+      continue;
+    }
+    if (due->period_us) {
+      due->deadline_us += due->period_us;
+    } else {
+      due->armed = false;
+    }
+    /* the callback may start or stop timers, itself included */
+    esp_timer_cb_t cb = due->cb;
+    void *cb_arg = due->arg;
+    sim_unlock();
+    cb(cb_arg);
+    sim_lock();
+  }
+}
+
+static uint64_t sim_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+/* kernel */
+
+void sim_rtos_init(bool virtual_time) {
+  pthread_mutexattr_t attr;
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&s_kernel, &attr);
+  pthread_mutexattr_destroy(&attr);
+  clock_gettime(CLOCK_MONOTONIC, &s_start);
+  s_virtual = virtual_time;
+  sim_waitq_init(&s_timer_q);
+
+  s_self = sim_thread_new("main", 1);
+  s_self->thread = pthread_self();
+  s_self->state = SIM_RUNNING;
+  s_current = s_self;
+
+  /* the rate of the cycle counter, for the engine's CPU load figure */
+  struct timespec t0, t1, nap = {0, 20 * 1000 * 1000};
+  uint64_t c0 = sim_cycles();
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  nanosleep(&nap, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  int64_t us = (t1.tv_sec - t0.tv_sec) * 1000000 +
+               (t1.tv_nsec - t0.tv_nsec) / 1000;
+  s_ticks_per_us = (uint32_t)((sim_cycles() - c0) / (us > 0 ? us : 1));
+  if (s_ticks_per_us == 0) {
+    s_ticks_per_us = 1;
+  }
+}
+
+void sim_lock(void) { pthread_mutex_lock(&s_kernel); }
+
+void sim_unlock(void) { pthread_mutex_unlock(&s_kernel); }
+
+void sim_waitq_init(sim_waitq_t *q) { sim_cond_init(&q->cond); }
+
+bool sim_wait(sim_waitq_t *q, int64_t deadline_us) {
+  sim_thread_t *self = s_self;
+
+  if (!s_virtual) {
+    pthread_cond_t *cond = q ? &q->cond : &self->cond;
+    self->wakeups++;
+    if (deadline_us == SIM_FOREVER) {
+      pthread_cond_wait(cond, &s_kernel);
+      return true;
+    }
+    struct timespec ts = s_start;
+    ts.tv_sec += deadline_us / 1000000;
+    ts.tv_nsec += (deadline_us % 1000000) * 1000;
+    if (ts.tv_nsec >= 1000000000) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+    }
+    return pthread_cond_timedwait(cond, &s_kernel, &ts) != ETIMEDOUT;
+  }
+
+  if (deadline_us <= s_vnow_us) {
+    return false;
+  }
+  self->wakeups++;
+  self->state = SIM_BLOCKED;
+  self->waitq = q;
+  self->deadline_us = deadline_us;
+  sim_pick_next();
+  while (s_current != self) {
+    pthread_cond_wait(&self->cond, &s_kernel);
+  }
+  return self->woken;
+}
+
+void sim_wake(sim_waitq_t *q) {
+  if (!s_virtual) {
+    pthread_cond_broadcast(&q->cond);
+    return;
+  }
+  for (int i = 0; i < s_thread_count; i++) {
+    sim_thread_t *t = s_threads[i];
+    if (t->state == SIM_BLOCKED && t->waitq == q) {
+      sim_make_ready(t, true);
+    }
+  }
+}
+
+int64_t sim_now_us(void) {
+  struct timespec ts;
+
+  if (s_virtual) {
+    return s_vnow_us;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)(ts.tv_sec - s_start.tv_sec) * 1000000 +
+         (ts.tv_nsec - s_start.tv_nsec) / 1000;
+}
+
+void sim_sleep_until(int64_t us) {
+  sim_lock();
+  while (sim_wait(NULL, us)) {
+  }
+  sim_unlock();
+}
+
+sim_thread_t *sim_thread_create(const char *name, int prio,
+                                void (*fn)(void *arg), void *arg) {
+  sim_lock();
+  sim_thread_t *t = sim_thread_new(name, prio);
+  t->fn = fn;
+  t->arg = arg;
+  if (s_virtual) {
+    sim_make_ready(t, false);
+  } else {
+    t->state = SIM_RUNNING;
+  }
+  if (pthread_create(&t->thread, NULL, sim_thread_main, t) != 0) {
+    fprintf(stderr, "sim: can't start %s\n", name);
+    abort();
+  }
+  sim_unlock();
+  return t;
+}
+
+void sim_thread_exit(void) {
+  sim_thread_t *t = s_self;
+  struct timespec ts;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  sim_lock();
+  t->cpu_ns = (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+  t->state = SIM_EXITED;
+  sim_wake(&t->exit_q);
+  if (s_virtual) {
+    sim_pick_next();
+  }
+  sim_unlock();
+  pthread_exit(NULL);
+}
+
+void sim_thread_join(sim_thread_t *t) {
+  sim_lock();
+  while (t->state != SIM_EXITED) {
+    sim_wait(&t->exit_q, SIM_FOREVER);
+  }
+  sim_unlock();
+  pthread_join(t->thread, NULL);
+}
+
+int sim_rtos_tasks(sim_task_info_t *info, int max) {
+  int n = 0;
+
+  sim_lock();
+  for (int i = 0; i < s_thread_count; i++) {
+    /* threads of one name add up, as the DMA of each channel made */
+    int j = 0;
+    while (j < n && strcmp(info[j].name, s_threads[i]->name) != 0) {
+      j++;
+    }
+    if (j == n) {
+      if (n == max) {
+        continue;
+      }
+      snprintf(info[n].name, sizeof(info[n].name), "%s",
+               s_threads[i]->name);
+      info[n].cpu_ns = 0;
+      info[n++].wakeups = 0;
+    }
+    info[j].cpu_ns += sim_thread_cpu_ns(s_threads[i]);
+    info[j].wakeups += s_threads[i]->wakeups;
+  }
+  sim_unlock();
+  return n;
+}
+
+/* tasks */
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t prio, TaskHandle_t *handle) {
+  sim_thread_t *t = sim_thread_create(name, (int)prio, fn, arg);
+
+  if (handle) {
+    *handle = t;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  return xTaskCreate(fn, name, stack, arg, prio, handle);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == NULL || task == s_self) {
+    sim_thread_exit();
+  }
+  fprintf(stderr, "sim: deleting another task is not simulated\n");
+  abort();
+}
+
+void vTaskDelay(TickType_t ticks) {
+  sim_sleep_until(sim_tick_deadline(ticks));
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return (TickType_t)(sim_now_us() * configTICK_RATE_HZ / 1000000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return s_self; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  sim_lock();
+  task->notify++;
+  sim_wake(&task->notify_q);
+  sim_unlock();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+  xTaskNotifyGive(task);
+  if (woken) {
+    *woken = pdTRUE;
+  }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  sim_thread_t *t = s_self;
+  int64_t deadline = sim_tick_deadline(ticks);
+  uint32_t value;
+
+  sim_lock();
+  while (t->notify == 0 && ticks != 0 && sim_wait(&t->notify_q, deadline)) {
+  }
+  value = t->notify;
+  if (value) {
+    t->notify = clear ? 0 : value - 1;
+  }
+  sim_unlock();
+  return value;
+}
+
+/* queues and semaphores */
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size) {
+  return sim_queue_new(len, item_size, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+  return sim_queue_new(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max,
+                                           UBaseType_t initial) {
+  return sim_queue_new(max, 0, initial);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  return sim_queue_new(1, 0, 1);
+}
+
+void vQueueDelete(QueueHandle_t q) {
+  pthread_cond_destroy(&q->q.cond);
+  free(q->items);
+  free(q);
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks) {
+  int64_t deadline = sim_tick_deadline(ticks);
+  BaseType_t ok = pdFALSE;
+
+  sim_lock();
+  while (q->count == q->len && ticks != 0 && sim_wait(&q->q, deadline)) {
+  }
+  if (q->count < q->len) {
+    if (q->item_size) {
+      memcpy(q->items + ((q->head + q->count) % q->len) * q->item_size, item,
+             q->item_size);
+    }
+    q->count++;
+    sim_wake(&q->q);
+    ok = pdTRUE;
+  }
+  sim_unlock();
+  return ok;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item,
+                             BaseType_t *woken) {
+  BaseType_t ok = xQueueSend(q, item, 0);
+
+  if (woken && ok) {
+    *woken = pdTRUE;
+  }
+  return ok;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks) {
+  int64_t deadline = sim_tick_deadline(ticks);
+  BaseType_t ok = pdFALSE;
+
+  sim_lock();
+  while (q->count == 0 && ticks != 0 && sim_wait(&q->q, deadline)) {
+  }
+  if (q->count) {
+    if (q->item_size) {
+      memcpy(item, q->items + q->head * q->item_size, q->item_size);
+    }
+    q->head = (q->head + 1) % q->len;
+    q->count--;
+    sim_wake(&q->q);
+    ok = pdTRUE;
+  }
+  sim_unlock();
+  return ok;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  sim_lock();
+  UBaseType_t count = q->count;
+  sim_unlock();
+  return count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q) {
+  sim_lock();
+  q->head = 0;
+  q->count = 0;
+  sim_wake(&q->q);
+  sim_unlock();
+  return pdPASS;
+}
+
+/* esp_timer */
+
+int64_t esp_timer_get_time(void) { return sim_now_us(); }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,
+                           esp_timer_handle_t *timer) {
+  struct esp_timer *t = calloc(1, sizeof(*t));
+
+  t->cb = args->callback;
+  t->arg = args->arg;
+  sim_lock();
+  if (!s_timer_running) {
+    s_timer_running = true;
+    sim_thread_create("esp_timer", SIM_PRIO_TIMER, sim_timer_main, NULL);
+  }
+  t->next = s_timers;
+  s_timers = t;
+  sim_unlock();
+  *timer = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  esp_err_t err = ESP_OK;
+
+  sim_lock();
+  if (timer->armed) {
+    err = ESP_ERR_INVALID_STATE;
+  } else {
+    timer->armed = true;
+    timer->deadline_us = sim_now_us() + (int64_t)timeout_us;
+    timer->period_us = 0;
+    sim_wake(&s_timer_q);
+  }
+  sim_unlock();
+  return err;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer,
+                                   uint64_t period_us) {
+  esp_err_t err = ESP_OK;
+
+  sim_lock();
+  if (timer->armed) {
+    err = ESP_ERR_INVALID_STATE;
+  } else {
+    timer->armed = true;
+    timer->deadline_us = sim_now_us() + (int64_t)period_us;
+    timer->period_us = period_us;
+    sim_wake(&s_timer_q);
+  }
+  sim_unlock();
+  return err;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  esp_err_t err = ESP_OK;
+
+  sim_lock();
+  if (!timer->armed) {
+    err = ESP_ERR_INVALID_STATE;
+  }
+  timer->armed = false;
+  sim_unlock();
+  return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  sim_lock();
+  for (struct esp_timer **p = &s_timers; *p; p = &(*p)->next) {
+    if (*p == timer) {
+      *p = timer->next;
+      break;
+    }
+  }
+  sim_unlock();
+  free(timer);
+  return ESP_OK;
+}
+
+/* log and cycle counter */
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+  s_log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format,
+                   ...) {
+  static const char letter[] = "NEWIDV";
+  va_list ap;
+
+  if (level > s_log_level) {
+    return;
+  }
+  pthread_mutex_lock(&s_log_lock);
+  printf("%c (%lld) %s: ", letter[level], (long long)(sim_now_us() / 1000),
+         tag);
+  va_start(ap, format);
+  vprintf(format, ap);
+  va_end(ap);
+  putchar('\n');
+  pthread_mutex_unlock(&s_log_lock);
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+  return (esp_cpu_cycle_count_t)sim_cycles();
+}
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void) { return s_ticks_per_us; }
@@ -0,0 +1,323 @@
+/* The sink's data path on the host: bt_app_core.c, bt_app_av.c and the
+ * audio engine in bt_app_i2s.c, on the pthread stand-ins for FreeRTOS, the
+ * I2S DMA and the Bluetooth stack. A source thread plays the stack's part,
+ * connecting, starting a stream and feeding a sine in packets of the given
+ * size at the given rate, with jittered and stalled arrivals and a source
+ * clock off by the given drift. What the DAC plays can go to a WAV file.
+ * Reports underruns, drops, latency, and the CPU time and wakeups of each
+ * task.
+ *
+ *   sim_sink [-r rate] [-c channels] [-p frames per packet] [-j jitter ms]
+ *            [-s stall ms:every packets] [-d drift ppm] [-t seconds]
+ *            [-o out.wav] [-S seed] [-v] [-x] [-V]
+ *
+ * -x exits with an error if audio was lost: bytes dropped, or a packet
+ * that never reached the DAC. Underruns are concealed and, on a busy host,
+ * partly down to its scheduler, so they are only reported. -v shows the
+ * sink's info log. -V runs in virtual time, where the run repeats exactly,
+ * hash of the output included, and the CPU figures mean nothing.
+ */
+#include <esp_a2dp_api.h>
+#include <esp_log.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bt_app_av.h"
+#include "bt_app_core.h"
+#include "bt_app_i2s.h"
+#include "bt_app_trace.h"
+#include "sim.h"
+
+#define TONE_HZ 997  /* not a divisor of any rate, so every packet differs */
+#define TONE_AMP 16384
+#define DRAIN_MS 500 /* longer than the ringbuffer and DMA queue can hold */
+
+typedef struct {
+  uint32_t rate;
+  uint8_t ch;
+  uint32_t packet_frames;
+  uint32_t jitter_us;   /* arrival delay, uniform up to this */
+  uint32_t stall_us;    /* radio stall */
+  uint32_t stall_every; /* packets between stalls, 0 for none */
+  int32_t drift_ppm;    /* source clock fast by */
+  uint32_t seconds;
+  const char *wav;
+  uint32_t seed;
+  bool verbose;
+  bool strict;
+  bool virtual_time;
+} sim_opts_t;
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+
+static sim_opts_t s_opts = {
+    .rate = 44100,
+    .ch = 2,
+    .packet_frames = 512,
+    .seconds = 10,
+    .seed = 1,
+};
+static uint32_t s_rand;
+static uint32_t s_packets;          /* sent by the source */
+static volatile bool s_source_done; /* source thread finished */
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+static uint32_t sim_rand(uint32_t range);
+static void sim_a2d_event(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *p);
+static void sim_connect(void);
+static void sim_source_task(void *arg);
+/* `st` counted while streaming, `end` once the buffers have played out */
+static void sim_report(const bt_i2s_stats_t *st, const bt_i2s_stats_t *end,
+                       int64_t run_us);
+static void sim_usage(void);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static uint32_t sim_rand(uint32_t range) {
+  s_rand = s_rand * 1664525u + 1013904223u;
+  return range ? (uint32_t)(((uint64_t)(s_rand >> 8) * range) >> 24) : 0;
+}
+
+static void sim_a2d_event(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *p) {
+  bt_app_a2d_cb(event, p);
+  /* let the app task handle it before the next, as the stack paces them */
+  vTaskDelay(pdMS_TO_TICKS(20));
+}
+
+static void sim_connect(void) {
+  esp_a2d_cb_param_t p;
+
+  memset(&p, 0, sizeof(p));
+  p.conn_stat.state = ESP_A2D_CONNECTION_STATE_CONNECTING;
+  sim_a2d_event(ESP_A2D_CONNECTION_STATE_EVT, &p);
+
+  memset(&p, 0, sizeof(p));
+  p.audio_cfg.mcc.type = ESP_A2D_MCT_SBC;
+  p.audio_cfg.mcc.cie.sbc[0] = sim_bt_sbc_oct0(s_opts.rate, s_opts.ch);
+  sim_a2d_event(ESP_A2D_AUDIO_CFG_EVT, &p);
+
+  memset(&p, 0, sizeof(p));
+  p.conn_stat.state = ESP_A2D_CONNECTION_STATE_CONNECTED;
+  sim_a2d_event(ESP_A2D_CONNECTION_STATE_EVT, &p);
+
+  memset(&p, 0, sizeof(p));
+  p.a2d_psc_cfg_stat.psc_mask = ESP_A2D_PSC_DELAY_RPT;
+  sim_a2d_event(ESP_A2D_SNK_PSC_CFG_EVT, &p);
+
+  /* the stack's default delay, 150 ms */
+  memset(&p, 0, sizeof(p));
+  p.a2d_get_delay_value_stat.delay_value = 1500;
+  sim_a2d_event(ESP_A2D_SNK_GET_DELAY_VALUE_EVT, &p);
+
+  memset(&p, 0, sizeof(p));
+  p.audio_stat.state = ESP_A2D_AUDIO_STATE_STARTED;
+  sim_a2d_event(ESP_A2D_AUDIO_STATE_EVT, &p);
+}
+
+static void sim_source_task(void *arg) {
+  size_t bytes = s_opts.packet_frames * s_opts.ch * sizeof(int16_t);
+  int16_t *pcm = malloc(bytes);
+  double packet_us = s_opts.packet_frames * 1e6 / s_opts.rate;
+  double sent_us = esp_timer_get_time(); /* next packet leaves the source */
+  int64_t arrival_us = 0;                /* and arrives */
+  int64_t stall_end_us = 0;
+  int64_t end_us = (int64_t)sent_us + (int64_t)s_opts.seconds * 1000000;
+  uint64_t frame = 0;
+
+  while (sent_us < end_us) {
+    for (uint32_t i = 0; i < s_opts.packet_frames; i++, frame++) {
+      int16_t v = (int16_t)(TONE_AMP * sin(2 * M_PI * TONE_HZ *
+                                           (double)frame / s_opts.rate));
+      for (uint8_t c = 0; c < s_opts.ch; c++) {
+        pcm[i * s_opts.ch + c] = v;
+      }
+    }
+    /* packets queue behind each other on the radio */
+    int64_t next = (int64_t)sent_us + sim_rand(s_opts.jitter_us);
+    if (next < stall_end_us) {
+      next = stall_end_us;
+    }
+    if (next > arrival_us) {
+      arrival_us = next;
+    }
+    sim_sleep_until(arrival_us);
+    bt_app_a2d_data_cb((const uint8_t *)pcm, bytes);
+    s_packets++;
+    if (s_opts.stall_every && s_packets % s_opts.stall_every == 0) {
+      stall_end_us = (int64_t)sent_us + s_opts.stall_us;
+    }
+    sent_us += packet_us * (1.0 - s_opts.drift_ppm * 1e-6);
+  }
+  free(pcm);
+  s_source_done = true;
+  vTaskDelete(NULL);
+}
+
+static void sim_report(const bt_i2s_stats_t *st, const bt_i2s_stats_t *end,
+                       int64_t run_us) {
+  sim_i2s_stats_t out;
+  sim_task_info_t tasks[SIM_TASKS_MAX];
+  uint32_t reports;
+  uint16_t delay = sim_bt_delay_value(&reports);
+  int n = sim_rtos_tasks(tasks, SIM_TASKS_MAX);
+  double elapsed_s = st->elapsed_us / 1e6;
+
+  sim_i2s_stats(&out);
+  printf("sim_sink: %" PRIu32 " Hz %u ch, %" PRIu32
+         "-frame packets, jitter %" PRIu32 " ms, stalls %" PRIu32
+         " ms every %" PRIu32 ", drift %+" PRId32 " ppm, %" PRIu32 " s\n",
+         s_opts.rate, s_opts.ch, s_opts.packet_frames,
+         s_opts.jitter_us / 1000, s_opts.stall_us / 1000, s_opts.stall_every,
+         s_opts.drift_ppm, s_opts.seconds);
+  printf("  source:  %" PRIu32 " packets\n", s_packets);
+  printf("  output:  %" PRIu64 " frames in %" PRIu32 " buffers, %" PRIu32
+         " silent, hash %08" PRIx32 "\n",
+         out.frames, out.buffers, out.silent, out.hash);
+  printf("  engine:  %" PRIu32 " underruns, %" PRIu32
+         " bytes dropped, %.0f wakeups/s, %.0f buffers/s, %.0f kcycles/s, "
+         "CPU %.2f%%\n",
+         st->underruns, end->dropped, st->wakeups / elapsed_s,
+         st->chunks / elapsed_s, st->busy_cycles / elapsed_s / 1000,
+         st->busy_cycles * 100.0 /
+             ((double)st->elapsed_us * esp_rom_get_cpu_ticks_per_us()));
+  printf("  latency: %" PRIu32 " packets to the DAC, worst %.1f ms, last "
+         "delay report %.1f ms of %" PRIu32 "\n",
+         end->packets, end->latency_max_us / 1000.0, delay / 10.0, reports);
+  printf("  %-16s %8s %7s %10s\n", "task", "CPU ms", "CPU %", "wakeups/s");
+  for (int i = 0; i < n; i++) {
+    printf("  %-16s %8.1f %7.2f %10.0f\n", tasks[i].name,
+           tasks[i].cpu_ns / 1e6, tasks[i].cpu_ns / (run_us * 10.0),
+           tasks[i].wakeups * 1e6 / run_us);
+  }
+}
+
+static void sim_usage(void) {
+  fprintf(stderr,
+          "usage: sim_sink [-r rate] [-c channels] [-p frames per packet]\n"
+          "                [-j jitter ms] [-s stall ms:every packets]\n"
+          "                [-d drift ppm] [-t seconds] [-o out.wav]\n"
+          "                [-S seed] [-v] [-x] [-V]\n");
+  exit(2);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+int main(int argc, char **argv) {
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:c:p:j:s:d:t:o:S:vxV")) != -1) {
+    switch (opt) {
+      case 'r':
+        s_opts.rate = strtoul(optarg, NULL, 10);
+        break;
+      case 'c':
+        s_opts.ch = (uint8_t)strtoul(optarg, NULL, 10);
+        break;
+      case 'p':
+        s_opts.packet_frames = strtoul(optarg, NULL, 10);
+        break;
+      case 'j':
+        s_opts.jitter_us = strtoul(optarg, NULL, 10) * 1000;
+        break;
+      case 's':
+        if (sscanf(optarg, "%" SCNu32 ":%" SCNu32, &s_opts.stall_us,
+                   &s_opts.stall_every) != 2) {
+          sim_usage();
+        }
+        s_opts.stall_us *= 1000;
+        break;
+      case 'd':
+        s_opts.drift_ppm = strtol(optarg, NULL, 10);
+        break;
+      case 't':
+        s_opts.seconds = strtoul(optarg, NULL, 10);
+        break;
+      case 'o':
+        s_opts.wav = optarg;
+        break;
+      case 'S':
+        s_opts.seed = strtoul(optarg, NULL, 10);
+        break;
+      case 'v':
+        s_opts.verbose = true;
+        break;
+      case 'x':
+        s_opts.strict = true;
+        break;
+      case 'V':
+        s_opts.virtual_time = true;
+        break;
+      default:
+        sim_usage();
+    }
+  }
+  if ((s_opts.ch != 1 && s_opts.ch != 2) || s_opts.packet_frames == 0 ||
+      (s_opts.rate != 16000 && s_opts.rate != 32000 &&
+       s_opts.rate != 44100 && s_opts.rate != 48000)) {
+    sim_usage();
+  }
+  s_rand = s_opts.seed;
+
+  sim_rtos_init(s_opts.virtual_time);
+  esp_log_level_set("*", s_opts.verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+  if (s_opts.wav && !sim_i2s_wav_open(s_opts.wav)) {
+    perror(s_opts.wav);
+    return 1;
+  }
+  if (!bt_i2s_engine_init()) {
+    fprintf(stderr, "sim_sink: engine init failed\n");
+    return 1;
+  }
+  bt_app_task_start_up();
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_TRACE
+  bt_trace_init();
+#endif
+
+  int64_t start_us = esp_timer_get_time();
+  sim_connect();
+  xTaskCreate(sim_source_task, "BtcTask", 4096, NULL, 19, NULL);
+  while (!s_source_done) {
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+  /* counted before the ringbuffer runs dry, which is no underrun */
+  bt_i2s_stats_t st;
+  bt_i2s_stats(&st);
+  int64_t run_us = esp_timer_get_time() - start_us;
+  bt_i2s_stats_t end;
+  vTaskDelay(pdMS_TO_TICKS(DRAIN_MS));
+  bt_i2s_stats(&end);
+
+  esp_a2d_cb_param_t p;
+  memset(&p, 0, sizeof(p));
+  p.audio_stat.state = ESP_A2D_AUDIO_STATE_SUSPEND;
+  sim_a2d_event(ESP_A2D_AUDIO_STATE_EVT, &p);
+  memset(&p, 0, sizeof(p));
+  p.conn_stat.state = ESP_A2D_CONNECTION_STATE_DISCONNECTED;
+  sim_a2d_event(ESP_A2D_CONNECTION_STATE_EVT, &p);
+  vTaskDelay(pdMS_TO_TICKS(100));
+  sim_i2s_wav_close();
+
+  sim_report(&st, &end, run_us);
+  if (s_opts.strict && (end.dropped || end.packets != s_packets)) {
+    printf("FAIL: audio lost\n");
+    return 1;
+  }
+  return 0;
+}
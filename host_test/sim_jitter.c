@@ -0,0 +1,216 @@
+/* Replays packet arrival traces through the adaptive jitter watermarks and
+ * through the fixed 20 KB prefetch / 32 KB ceiling they replaced, and
+ * reports the underrun and latency trade-off of each.
+ *
+ *   sim_jitter              built-in near, room and wall profiles
+ *   sim_jitter trace.txt    arrival times in microseconds, one per line
+ *
+ * The model plays 44.1 kHz stereo from a byte count in 1 ms steps:
+ * prefetch up to the prefetch level, drain at the byte rate, start over
+ * from prefetching when it runs dry, and drop packets that would take the
+ * fill above the ceiling.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "bt_app_jitter.h"
+#include "host_test.h"
+
+#define RATE_BPS (44100 * 4)
+#define PACKET_BYTES 2048 /* about 11.6 ms of audio */
+#define CAPACITY_BYTES (32 * 1024)
+#define SIM_SECONDS 300
+#define MAX_PACKETS (SIM_SECONDS * RATE_BPS / PACKET_BYTES + 1)
+/* Kconfig defaults */
+#define JITTER_MIN_MS 40
+#define JITTER_MAX_MS 150
+#define FAST_START_MS 40
+/* the old fixed levels */
+#define FIXED_PREFETCH_BYTES (20 * 1024)
+#define FIXED_HIGH_BYTES CAPACITY_BYTES
+
+typedef struct {
+  const char *name;
+  uint32_t sigma_us;    /* spread of the per-packet delay */
+  uint32_t stall_every; /* mean packets between radio stalls, 0 for none */
+  uint32_t stall_us;    /* longest stall */
+} profile_t;
+
+typedef struct {
+  uint32_t underruns;
+  uint32_t gap_ms;      /* time spent prefetching after the first start */
+  uint32_t dropped;     /* packets shed at the ceiling */
+  uint64_t latency_sum; /* fill while playing, in ms, summed per ms */
+  uint32_t latency_n;
+  uint32_t latency_max;
+  uint32_t start_ms;    /* time to first audio */
+} result_t;
+
+static int64_t s_arrival[MAX_PACKETS];
+static size_t s_packets;
+static uint32_t s_seed = 1;
+
+/* uniform in [0, 1) */
+static double rnd(void) {
+  s_seed = s_seed * 1664525u + 1013904223u;
+  return (s_seed >> 8) / 16777216.0;
+}
+
+/* delay of each packet behind its nominal send time, never reordered */
+static void generate(const profile_t *p) {
+  const double period_us = 1e6 * PACKET_BYTES / RATE_BPS;
+  int64_t last = 0;
+  int64_t stall_until = 0;
+
+  s_packets = SIM_SECONDS * RATE_BPS / PACKET_BYTES;
+  for (size_t i = 0; i < s_packets; i++) {
+    int64_t nominal = (int64_t)(i * period_us);
+    /* sum of uniforms: roughly normal, never negative */
+    double d = 0;
+    for (int k = 0; k < 4; k++) {
+      d += rnd();
+    }
+    int64_t t = nominal + (int64_t)(d / 2 * p->sigma_us);
+    if (p->stall_every && rnd() * p->stall_every < 1.0) {
+      stall_until = t + (int64_t)(p->stall_us * (0.3 + 0.7 * rnd()));
+    }
+    /* packets held up by a stall all come out together after it */
+    if (t < stall_until) {
+      t = stall_until;
+    }
+    if (t < last) {
+      t = last;
+    }
+    s_arrival[i] = last = t;
+  }
+}
+
+static int load(const char *path) {
+  FILE *f = fopen(path, "r");
+  long long t;
+
+  if (f == NULL) {
+    perror(path);
+    return -1;
+  }
+  s_packets = 0;
+  while (s_packets < MAX_PACKETS && fscanf(f, "%lld", &t) == 1) {
+    s_arrival[s_packets++] = t;
+  }
+  fclose(f);
+  for (size_t i = s_packets; i-- > 0;) {
+    s_arrival[i] -= s_arrival[0];
+  }
+  return 0;
+}
+
+static void simulate(bool adaptive, result_t *r) {
+  bt_jitter_t j;
+  uint32_t prefetch = FIXED_PREFETCH_BYTES;
+  uint32_t high = FIXED_HIGH_BYTES;
+  const uint32_t capacity_ms = CAPACITY_BYTES * 1000 / RATE_BPS;
+  int64_t fill = 0;
+  bool playing = false;
+  bool started = false;
+  size_t next = 0;
+
+  memset(r, 0, sizeof(*r));
+  memset(&j, 0, sizeof(j));
+  if (adaptive) {
+    bt_jitter_reset(&j, JITTER_MIN_MS, JITTER_MAX_MS, FAST_START_MS,
+                    capacity_ms);
+  }
+  int64_t end_ms = s_arrival[s_packets - 1] / 1000 + 1;
+  for (int64_t ms = 0; ms < end_ms; ms++) {
+    for (; next < s_packets && s_arrival[next] < (ms + 1) * 1000; next++) {
+      if (adaptive) {
+        /* the estimator takes a zero time for no previous packet */
+        bt_jitter_packet(&j, s_arrival[next] + 1,
+                         bt_jitter_bytes_to_us(PACKET_BYTES, RATE_BPS),
+                         capacity_ms);
+        prefetch = bt_jitter_ms_to_bytes(j.prefetch_ms, RATE_BPS);
+        high = bt_jitter_ms_to_bytes(j.high_ms, RATE_BPS);
+      }
+      if (fill + PACKET_BYTES > high) {
+        r->dropped++;
+        continue;
+      }
+      fill += PACKET_BYTES;
+    }
+    if (!playing && fill >= prefetch) {
+      playing = true;
+      if (!started) {
+        r->start_ms = (uint32_t)ms;
+        started = true;
+      }
+      if (adaptive && bt_jitter_resumed(&j, capacity_ms)) {
+        prefetch = bt_jitter_ms_to_bytes(j.prefetch_ms, RATE_BPS);
+        high = bt_jitter_ms_to_bytes(j.high_ms, RATE_BPS);
+      }
+    }
+    if (!playing) {
+      r->gap_ms += started;
+      continue;
+    }
+    uint32_t latency = (uint32_t)(fill * 1000 / RATE_BPS);
+    r->latency_sum += latency;
+    r->latency_n++;
+    if (latency > r->latency_max) {
+      r->latency_max = latency;
+    }
+    /* whole bytes per step, but exactly the byte rate over time */
+    fill -= (ms + 1) * RATE_BPS / 1000 - ms * RATE_BPS / 1000;
+    if (fill < 0) {
+      fill = 0;
+      playing = false;
+      r->underruns++;
+      if (adaptive) {
+        bt_jitter_underrun(&j);
+      }
+    }
+  }
+}
+
+static void report(const char *name, const char *policy, const result_t *r) {
+  printf("%-8s %-8s %9u %8u %8u %9u %9u %8u\n", name, policy, r->underruns,
+         r->gap_ms, r->dropped, r->start_ms,
+         r->latency_n ? (uint32_t)(r->latency_sum / r->latency_n) : 0,
+         r->latency_max);
+}
+
+static void run(const char *name, result_t *fixed, result_t *adaptive) {
+  simulate(false, fixed);
+  simulate(true, adaptive);
+  report(name, "fixed", fixed);
+  report(name, "adaptive", adaptive);
+}
+
+int main(int argc, char **argv) {
+  static const profile_t profiles[] = {
+      {"near", 2000, 0, 0},
+      {"room", 8000, 2000, 60000},
+      {"wall", 15000, 300, 150000},
+  };
+  result_t fixed, adaptive;
+
+  printf("%-8s %-8s %9s %8s %8s %9s %9s %8s\n", "trace", "policy",
+         "underruns", "gap ms", "dropped", "start ms", "avg ms", "max ms");
+  if (argc > 1) {
+    if (load(argv[1]) || s_packets < 2) {
+      return 1;
+    }
+    run(argv[1], &fixed, &adaptive);
+    return 0;
+  }
+  for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+    generate(&profiles[i]);
+    run(profiles[i].name, &fixed, &adaptive);
+    /* a clean link plays with far less delay than the fixed levels */
+    if (profiles[i].stall_every == 0) {
+      CHECK(adaptive.underruns == 0);
+      CHECK(adaptive.latency_sum / adaptive.latency_n <
+            fixed.latency_sum / fixed.latency_n);
+    }
+  }
+  return host_test_done();
+}
@@ -0,0 +1,13 @@
+/* Host stand-in for the shared APLL: setting its frequency moves the I2S
+ * stand-in's clock by the same ratio as on the chip.
+ */
+#ifndef __HOST_CLK_CTRL_OS_H__
+#define __HOST_CLK_CTRL_OS_H__
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+esp_err_t periph_rtc_apll_freq_set(uint32_t expt_freq, uint32_t *real_freq);
+
+#endif /* __HOST_CLK_CTRL_OS_H__ */
@@ -0,0 +1,103 @@
+/* Host stand-in for the I2S channel API as of ESP-IDF 5.1. The DMA is a
+ * thread that plays the descriptors in turn at the channel's sample rate;
+ * see sim/sim_i2s.c.
+ */
+#ifndef __HOST_I2S_COMMON_H__
+#define __HOST_I2S_COMMON_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define I2S_GPIO_UNUSED -1
+
+typedef struct i2s_channel_obj_t *i2s_chan_handle_t;
+typedef int gpio_num_t;
+
+typedef enum {
+  I2S_NUM_0,
+  I2S_NUM_1,
+  I2S_NUM_AUTO,
+} i2s_port_t;
+
+typedef enum {
+  I2S_ROLE_MASTER,
+  I2S_ROLE_SLAVE,
+} i2s_role_t;
+
+typedef enum {
+  I2S_DATA_BIT_WIDTH_8BIT = 8,
+  I2S_DATA_BIT_WIDTH_16BIT = 16,
+  I2S_DATA_BIT_WIDTH_24BIT = 24,
+  I2S_DATA_BIT_WIDTH_32BIT = 32,
+} i2s_data_bit_width_t;
+
+typedef enum {
+  I2S_SLOT_BIT_WIDTH_AUTO = 0,
+  I2S_SLOT_BIT_WIDTH_16BIT = 16,
+  I2S_SLOT_BIT_WIDTH_32BIT = 32,
+} i2s_slot_bit_width_t;
+
+typedef enum {
+  I2S_SLOT_MODE_MONO = 1,
+  I2S_SLOT_MODE_STEREO = 2,
+} i2s_slot_mode_t;
+
+typedef enum {
+  I2S_CLK_SRC_DEFAULT,
+  I2S_CLK_SRC_PLL_160M,
+  I2S_CLK_SRC_APLL,
+} i2s_clock_src_t;
+
+typedef enum {
+  I2S_MCLK_MULTIPLE_128 = 128,
+  I2S_MCLK_MULTIPLE_256 = 256,
+  I2S_MCLK_MULTIPLE_384 = 384,
+} i2s_mclk_multiple_t;
+
+typedef struct {
+  i2s_port_t id;
+  i2s_role_t role;
+  uint32_t dma_desc_num;
+  uint32_t dma_frame_num;
+  bool auto_clear;
+  int intr_priority;
+} i2s_chan_config_t;
+
+#define I2S_CHANNEL_DEFAULT_CONFIG(i2s_num, i2s_role)                   \
+  {                                                                     \
+    .id = i2s_num, .role = i2s_role, .dma_desc_num = 6,                 \
+    .dma_frame_num = 240, .auto_clear = false, .intr_priority = 0,      \
+  }
+
+/* data is the address of the descriptor's buffer pointer */
+typedef struct {
+  void *data;
+  size_t size;
+} i2s_event_data_t;
+
+typedef bool (*i2s_isr_callback_t)(i2s_chan_handle_t handle,
+                                   i2s_event_data_t *event, void *user_ctx);
+
+typedef struct {
+  i2s_isr_callback_t on_recv;
+  i2s_isr_callback_t on_recv_q_ovf;
+  i2s_isr_callback_t on_sent;
+  i2s_isr_callback_t on_send_q_ovf;
+} i2s_event_callbacks_t;
+
+esp_err_t i2s_new_channel(const i2s_chan_config_t *chan_cfg,
+                          i2s_chan_handle_t *tx, i2s_chan_handle_t *rx);
+esp_err_t i2s_del_channel(i2s_chan_handle_t handle);
+esp_err_t i2s_channel_enable(i2s_chan_handle_t handle);
+esp_err_t i2s_channel_disable(i2s_chan_handle_t handle);
+esp_err_t i2s_channel_write(i2s_chan_handle_t handle, const void *src,
+                            size_t size, size_t *bytes_written,
+                            uint32_t timeout_ms);
+esp_err_t i2s_channel_register_event_callback(
+    i2s_chan_handle_t handle, const i2s_event_callbacks_t *callbacks,
+    void *user_data);
+
+#endif /* __HOST_I2S_COMMON_H__ */
@@ -0,0 +1,61 @@
+/* Host stand-in for the I2S PDM transmit API as of ESP-IDF 5.1; declared
+ * only, the simulation plays standard mode.
+ */
+#ifndef __HOST_I2S_PDM_H__
+#define __HOST_I2S_PDM_H__
+
+#include "driver/i2s_common.h"
+
+typedef struct {
+  uint32_t sample_rate_hz;
+  i2s_clock_src_t clk_src;
+  i2s_mclk_multiple_t mclk_multiple;
+  uint32_t up_sample_fp;
+  uint32_t up_sample_fs;
+} i2s_pdm_tx_clk_config_t;
+
+typedef struct {
+  i2s_data_bit_width_t data_bit_width;
+  i2s_slot_bit_width_t slot_bit_width;
+  i2s_slot_mode_t slot_mode;
+  int slot_mask;
+} i2s_pdm_tx_slot_config_t;
+
+typedef struct {
+  bool clk_inv;
+} i2s_pdm_tx_gpio_inv_t;
+
+typedef struct {
+  gpio_num_t clk;
+  gpio_num_t dout;
+  i2s_pdm_tx_gpio_inv_t invert_flags;
+} i2s_pdm_tx_gpio_config_t;
+
+typedef struct {
+  i2s_pdm_tx_clk_config_t clk_cfg;
+  i2s_pdm_tx_slot_config_t slot_cfg;
+  i2s_pdm_tx_gpio_config_t gpio_cfg;
+} i2s_pdm_tx_config_t;
+
+#define I2S_PDM_TX_CLK_DEFAULT_CONFIG(rate)                                \
+  {                                                                        \
+    .sample_rate_hz = rate, .clk_src = I2S_CLK_SRC_DEFAULT,                \
+    .mclk_multiple = I2S_MCLK_MULTIPLE_256, .up_sample_fp = 960,           \
+    .up_sample_fs = 480,                                                   \
+  }
+
+#define I2S_PDM_TX_SLOT_DEFAULT_CONFIG(bits_per_sample, mono_or_stereo)    \
+  {                                                                        \
+    .data_bit_width = bits_per_sample,                                     \
+    .slot_bit_width = I2S_SLOT_BIT_WIDTH_AUTO, .slot_mode = mono_or_stereo, \
+    .slot_mask = 3,                                                        \
+  }
+
+esp_err_t i2s_channel_init_pdm_tx_mode(i2s_chan_handle_t handle,
+                                       const i2s_pdm_tx_config_t *pdm_cfg);
+esp_err_t i2s_channel_reconfig_pdm_tx_clock(
+    i2s_chan_handle_t handle, const i2s_pdm_tx_clk_config_t *clk_cfg);
+esp_err_t i2s_channel_reconfig_pdm_tx_slot(
+    i2s_chan_handle_t handle, const i2s_pdm_tx_slot_config_t *slot_cfg);
+
+#endif /* __HOST_I2S_PDM_H__ */
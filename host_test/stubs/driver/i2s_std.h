@@ -0,0 +1,66 @@
+/* Host stand-in for the I2S standard mode API as of ESP-IDF 5.1. */
+#ifndef __HOST_I2S_STD_H__
+#define __HOST_I2S_STD_H__
+
+#include "driver/i2s_common.h"
+
+typedef struct {
+  uint32_t sample_rate_hz;
+  i2s_clock_src_t clk_src;
+  i2s_mclk_multiple_t mclk_multiple;
+} i2s_std_clk_config_t;
+
+typedef struct {
+  i2s_data_bit_width_t data_bit_width;
+  i2s_slot_bit_width_t slot_bit_width;
+  i2s_slot_mode_t slot_mode;
+  int slot_mask;
+  uint32_t ws_width;
+  bool ws_pol;
+  bool bit_shift;
+  bool msb_right;
+} i2s_std_slot_config_t;
+
+typedef struct {
+  bool mclk_inv;
+  bool bclk_inv;
+  bool ws_inv;
+} i2s_std_gpio_inv_t;
+
+typedef struct {
+  gpio_num_t mclk;
+  gpio_num_t bclk;
+  gpio_num_t ws;
+  gpio_num_t dout;
+  gpio_num_t din;
+  i2s_std_gpio_inv_t invert_flags;
+} i2s_std_gpio_config_t;
+
+typedef struct {
+  i2s_std_clk_config_t clk_cfg;
+  i2s_std_slot_config_t slot_cfg;
+  i2s_std_gpio_config_t gpio_cfg;
+} i2s_std_config_t;
+
+#define I2S_STD_CLK_DEFAULT_CONFIG(rate)                     \
+  {                                                          \
+    .sample_rate_hz = rate, .clk_src = I2S_CLK_SRC_DEFAULT,  \
+    .mclk_multiple = I2S_MCLK_MULTIPLE_256,                  \
+  }
+
+#define I2S_STD_MSB_SLOT_DEFAULT_CONFIG(bits_per_sample, mono_or_stereo)   \
+  {                                                                        \
+    .data_bit_width = bits_per_sample,                                     \
+    .slot_bit_width = I2S_SLOT_BIT_WIDTH_AUTO, .slot_mode = mono_or_stereo, \
+    .slot_mask = 3, .ws_width = bits_per_sample, .ws_pol = false,          \
+    .bit_shift = false, .msb_right = false,                                \
+  }
+
+esp_err_t i2s_channel_init_std_mode(i2s_chan_handle_t handle,
+                                    const i2s_std_config_t *std_cfg);
+esp_err_t i2s_channel_reconfig_std_clock(i2s_chan_handle_t handle,
+                                         const i2s_std_clk_config_t *clk_cfg);
+esp_err_t i2s_channel_reconfig_std_slot(
+    i2s_chan_handle_t handle, const i2s_std_slot_config_t *slot_cfg);
+
+#endif /* __HOST_I2S_STD_H__ */
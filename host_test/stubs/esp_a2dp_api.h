@@ -0,0 +1,89 @@
+/* Host stand-in for the A2DP sink API: the events and parameters the sink
+ * handles, and the calls it makes back into the stack.
+ */
+#ifndef __HOST_ESP_A2DP_API_H__
+#define __HOST_ESP_A2DP_API_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+#define ESP_A2D_MCT_SBC 0
+#define ESP_A2D_PSC_DELAY_RPT (1 << 0)
+
+typedef enum {
+  ESP_A2D_CONNECTION_STATE_DISCONNECTED,
+  ESP_A2D_CONNECTION_STATE_CONNECTING,
+  ESP_A2D_CONNECTION_STATE_CONNECTED,
+  ESP_A2D_CONNECTION_STATE_DISCONNECTING,
+} esp_a2d_connection_state_t;
+
+typedef enum {
+  ESP_A2D_AUDIO_STATE_SUSPEND,
+  ESP_A2D_AUDIO_STATE_STOPPED,
+  ESP_A2D_AUDIO_STATE_STARTED,
+} esp_a2d_audio_state_t;
+
+typedef enum {
+  ESP_A2D_INIT_SUCCESS,
+  ESP_A2D_DEINIT_SUCCESS,
+} esp_a2d_init_state_t;
+
+typedef enum {
+  ESP_A2D_SET_SUCCESS,
+  ESP_A2D_SET_INVALID_PARAMS,
+} esp_a2d_set_delay_value_state_t;
+
+typedef enum {
+  ESP_A2D_CONNECTION_STATE_EVT,
+  ESP_A2D_AUDIO_STATE_EVT,
+  ESP_A2D_AUDIO_CFG_EVT,
+  ESP_A2D_MEDIA_CTRL_ACK_EVT,
+  ESP_A2D_PROF_STATE_EVT,
+  ESP_A2D_SNK_PSC_CFG_EVT,
+  ESP_A2D_SNK_SET_DELAY_VALUE_EVT,
+  ESP_A2D_SNK_GET_DELAY_VALUE_EVT,
+} esp_a2d_cb_event_t;
+
+/* codec information element */
+typedef struct {
+  uint8_t type;
+  union {
+    uint8_t sbc[4];
+  } cie;
+} esp_a2d_mcc_t;
+
+typedef union {
+  struct {
+    esp_a2d_connection_state_t state;
+    esp_bd_addr_t remote_bda;
+  } conn_stat;
+  struct {
+    esp_a2d_audio_state_t state;
+    esp_bd_addr_t remote_bda;
+  } audio_stat;
+  struct {
+    esp_bd_addr_t remote_bda;
+    esp_a2d_mcc_t mcc;
+  } audio_cfg;
+  struct {
+    esp_a2d_init_state_t init_state;
+  } a2d_prof_stat;
+  struct {
+    uint16_t psc_mask;
+  } a2d_psc_cfg_stat;
+  struct {
+    esp_a2d_set_delay_value_state_t set_state;
+    uint16_t delay_value;
+  } a2d_set_delay_value_stat;
+  struct {
+    uint16_t delay_value;
+  } a2d_get_delay_value_stat;
+} esp_a2d_cb_param_t;
+
+esp_err_t esp_a2d_sink_connect(esp_bd_addr_t remote_bda);
+esp_err_t esp_a2d_sink_set_delay_value(uint16_t delay_value);
+
+#endif /* __HOST_ESP_A2DP_API_H__ */
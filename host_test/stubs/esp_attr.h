@@ -0,0 +1,11 @@
+/* Host stand-in for the ESP-IDF placement attributes, which the host has no
+ * use for.
+ */
+#ifndef __HOST_ESP_ATTR_H__
+#define __HOST_ESP_ATTR_H__
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define WORD_ALIGNED_ATTR __attribute__((aligned(4)))
+
+#endif /* __HOST_ESP_ATTR_H__ */
@@ -0,0 +1,178 @@
+/* Host stand-in for the AVRCP controller and target API: the events and
+ * parameters the sink handles, and the commands it sends.
+ */
+#ifndef __HOST_ESP_AVRC_API_H__
+#define __HOST_ESP_AVRC_API_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+/* metadata attributes */
+#define ESP_AVRC_MD_ATTR_TITLE 0x1
+#define ESP_AVRC_MD_ATTR_ARTIST 0x2
+#define ESP_AVRC_MD_ATTR_ALBUM 0x4
+#define ESP_AVRC_MD_ATTR_TRACK_NUM 0x8
+#define ESP_AVRC_MD_ATTR_NUM_TRACKS 0x10
+#define ESP_AVRC_MD_ATTR_GENRE 0x20
+#define ESP_AVRC_MD_ATTR_PLAYING_TIME 0x40
+
+/* passthrough commands */
+#define ESP_AVRC_PT_CMD_PLAY 0x44
+#define ESP_AVRC_PT_CMD_STATE_PRESSED 0
+#define ESP_AVRC_PT_CMD_STATE_RELEASED 1
+
+/* remote features */
+#define ESP_AVRC_FEAT_RCTG 0x0001
+#define ESP_AVRC_FEAT_RCCT 0x0002
+#define ESP_AVRC_FEAT_VENDOR 0x0008
+#define ESP_AVRC_FEAT_BROWSE 0x0010
+#define ESP_AVRC_FEAT_META_DATA 0x0040
+#define ESP_AVRC_FEAT_ADV_CTRL 0x0200
+#define ESP_AVRC_FEAT_FLAG_CAT1 0x0001
+#define ESP_AVRC_FEAT_FLAG_CAT2 0x0002
+#define ESP_AVRC_FEAT_FLAG_CAT3 0x0004
+#define ESP_AVRC_FEAT_FLAG_CAT4 0x0008
+#define ESP_AVRC_FEAT_FLAG_BROWSING 0x0040
+#define ESP_AVRC_FEAT_FLAG_COVER_ART_GET_IMAGE_PROP 0x0080
+#define ESP_AVRC_FEAT_FLAG_COVER_ART_GET_IMAGE 0x0100
+#define ESP_AVRC_FEAT_FLAG_COVER_ART_GET_LINKED_THUMBNAIL 0x0200
+
+typedef enum {
+  ESP_AVRC_CT_CONNECTION_STATE_EVT,
+  ESP_AVRC_CT_PASSTHROUGH_RSP_EVT,
+  ESP_AVRC_CT_METADATA_RSP_EVT,
+  ESP_AVRC_CT_PLAY_STATUS_RSP_EVT,
+  ESP_AVRC_CT_CHANGE_NOTIFY_EVT,
+  ESP_AVRC_CT_REMOTE_FEATURES_EVT,
+  ESP_AVRC_CT_GET_RN_CAPABILITIES_RSP_EVT,
+  ESP_AVRC_CT_SET_ABSOLUTE_VOLUME_RSP_EVT,
+} esp_avrc_ct_cb_event_t;
+
+typedef enum {
+  ESP_AVRC_TG_CONNECTION_STATE_EVT,
+  ESP_AVRC_TG_REMOTE_FEATURES_EVT,
+  ESP_AVRC_TG_PASSTHROUGH_CMD_EVT,
+  ESP_AVRC_TG_SET_ABSOLUTE_VOLUME_CMD_EVT,
+  ESP_AVRC_TG_REGISTER_NOTIFICATION_EVT,
+  ESP_AVRC_TG_SET_PLAYER_APP_VALUE_EVT,
+} esp_avrc_tg_cb_event_t;
+
+typedef enum {
+  ESP_AVRC_PLAYBACK_STOPPED,
+  ESP_AVRC_PLAYBACK_PLAYING,
+  ESP_AVRC_PLAYBACK_PAUSED,
+  ESP_AVRC_PLAYBACK_FWD_SEEK,
+  ESP_AVRC_PLAYBACK_REV_SEEK,
+  ESP_AVRC_PLAYBACK_ERROR = 0xff,
+} esp_avrc_playback_stat_t;
+
+typedef enum {
+  ESP_AVRC_RN_PLAY_STATUS_CHANGE = 0x01,
+  ESP_AVRC_RN_TRACK_CHANGE = 0x02,
+  ESP_AVRC_RN_TRACK_REACHED_END = 0x03,
+  ESP_AVRC_RN_TRACK_REACHED_START = 0x04,
+  ESP_AVRC_RN_PLAY_POS_CHANGED = 0x05,
+  ESP_AVRC_RN_VOLUME_CHANGE = 0x0d,
+  ESP_AVRC_RN_MAX_EVT,
+} esp_avrc_rn_event_ids_t;
+
+typedef enum {
+  ESP_AVRC_RN_RSP_INTERIM = 13,
+  ESP_AVRC_RN_RSP_CHANGED = 15,
+} esp_avrc_rn_rsp_t;
+
+typedef enum {
+  ESP_AVRC_BIT_MASK_OP_TEST,
+  ESP_AVRC_BIT_MASK_OP_SET,
+  ESP_AVRC_BIT_MASK_OP_CLEAR,
+} esp_avrc_bit_mask_op_t;
+
+typedef struct {
+  uint16_t bits;
+} esp_avrc_rn_evt_cap_mask_t;
+
+typedef union {
+  uint8_t volume;
+  esp_avrc_playback_stat_t playback;
+  uint8_t elm_id[8];
+  uint32_t play_pos;
+} esp_avrc_rn_param_t;
+
+typedef union {
+  struct {
+    bool connected;
+    esp_bd_addr_t remote_bda;
+  } conn_stat;
+  struct {
+    uint8_t tl;
+    uint8_t key_code : 7;
+    uint8_t key_state : 1;
+    int rsp_code;
+  } psth_rsp;
+  struct {
+    uint8_t attr_id;
+    uint8_t *attr_text;
+    int attr_length;
+  } meta_rsp;
+  struct {
+    uint32_t song_length;
+    uint32_t song_position;
+    esp_avrc_playback_stat_t play_status;
+  } play_status_rsp;
+  struct {
+    uint8_t event_id;
+    esp_avrc_rn_param_t event_parameter;
+  } change_ntf;
+  struct {
+    uint32_t feat_mask;
+    uint16_t tg_feat_flag;
+    esp_bd_addr_t remote_bda;
+  } rmt_feats;
+  struct {
+    uint8_t cap_count;
+    esp_avrc_rn_evt_cap_mask_t evt_set;
+  } get_rn_caps_rsp;
+} esp_avrc_ct_cb_param_t;
+
+typedef union {
+  struct {
+    bool connected;
+    esp_bd_addr_t remote_bda;
+  } conn_stat;
+  struct {
+    uint32_t feat_mask;
+    uint16_t ct_feat_flag;
+    esp_bd_addr_t remote_bda;
+  } rmt_feats;
+  struct {
+    uint8_t key_code;
+    uint8_t key_state;
+  } psth_cmd;
+  struct {
+    uint8_t volume;
+  } set_abs_vol;
+  struct {
+    uint8_t event_id;
+    uint32_t event_parameter;
+  } reg_ntf;
+} esp_avrc_tg_cb_param_t;
+
+bool esp_avrc_rn_evt_bit_mask_operation(esp_avrc_bit_mask_op_t op,
+                                        esp_avrc_rn_evt_cap_mask_t *events,
+                                        esp_avrc_rn_event_ids_t event_id);
+esp_err_t esp_avrc_ct_send_get_rn_capabilities_cmd(uint8_t tl);
+esp_err_t esp_avrc_ct_send_metadata_cmd(uint8_t tl, uint8_t attr_mask);
+esp_err_t esp_avrc_ct_send_register_notification_cmd(uint8_t tl,
+                                                     uint8_t event_id,
+                                                     uint32_t interval);
+esp_err_t esp_avrc_ct_send_passthrough_cmd(uint8_t tl, uint8_t key_code,
+                                           uint8_t key_state);
+esp_err_t esp_avrc_ct_send_get_play_status_cmd(uint8_t tl);
+esp_err_t esp_avrc_tg_send_rn_rsp(esp_avrc_rn_event_ids_t event_id,
+                                  esp_avrc_rn_rsp_t rsp,
+                                  esp_avrc_rn_param_t *param);
+
+#endif /* __HOST_ESP_AVRC_API_H__ */
@@ -0,0 +1,4 @@
+/* Host stand-in: nothing of the device API is used. */
+#ifndef __HOST_ESP_BT_DEVICE_H__
+#define __HOST_ESP_BT_DEVICE_H__
+#endif /* __HOST_ESP_BT_DEVICE_H__ */
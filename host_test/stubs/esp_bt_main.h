@@ -0,0 +1,4 @@
+/* Host stand-in: nothing of the Bluedroid host API is used. */
+#ifndef __HOST_ESP_BT_MAIN_H__
+#define __HOST_ESP_BT_MAIN_H__
+#endif /* __HOST_ESP_BT_MAIN_H__ */
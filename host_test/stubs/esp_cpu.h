@@ -0,0 +1,13 @@
+/* Host stand-in for the CPU cycle counter: the time stamp counter where the
+ * host has one, else nanoseconds.
+ */
+#ifndef __HOST_ESP_CPU_H__
+#define __HOST_ESP_CPU_H__
+
+#include <stdint.h>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+#endif /* __HOST_ESP_CPU_H__ */
@@ -0,0 +1,22 @@
+/* Host stand-in for the Classic Bluetooth GAP API: scan mode only. */
+#ifndef __HOST_ESP_GAP_BT_API_H__
+#define __HOST_ESP_GAP_BT_API_H__
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+typedef enum {
+  ESP_BT_NON_CONNECTABLE,
+  ESP_BT_CONNECTABLE,
+} esp_bt_connection_mode_t;
+
+typedef enum {
+  ESP_BT_NON_DISCOVERABLE,
+  ESP_BT_LIMITED_DISCOVERABLE,
+  ESP_BT_GENERAL_DISCOVERABLE,
+} esp_bt_discovery_mode_t;
+
+esp_err_t esp_bt_gap_set_scan_mode(esp_bt_connection_mode_t c_mode,
+                                   esp_bt_discovery_mode_t d_mode);
+
+#endif /* __HOST_ESP_GAP_BT_API_H__ */
@@ -0,0 +1,9 @@
+/* Host stand-in: the rate of esp_cpu_get_cycle_count(), measured at start. */
+#ifndef __HOST_ESP_ROM_SYS_H__
+#define __HOST_ESP_ROM_SYS_H__
+
+#include <stdint.h>
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void);
+
+#endif /* __HOST_ESP_ROM_SYS_H__ */
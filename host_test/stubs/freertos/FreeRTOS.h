@@ -0,0 +1,31 @@
+/* Host stand-in for the ESP-IDF FreeRTOS: the types and macros of the
+ * kernel API the sink uses. Tasks are pthreads and the tick is only a unit
+ * of timeouts; see sim/sim_rtos.c.
+ */
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+#include <sdkconfig.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOSConfig.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffu)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) \
+  ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000u))
+
+/* "ISRs" are threads too; nothing to yield to */
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+#endif /* __HOST_FREERTOS_H__ */
@@ -0,0 +1,10 @@
+/* Host stand-in for the FreeRTOS configuration; priorities are accepted but
+ * the host scheduler ignores them.
+ */
+#ifndef __HOST_FREERTOS_CONFIG_H__
+#define __HOST_FREERTOS_CONFIG_H__
+
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES 25
+
+#endif /* __HOST_FREERTOS_CONFIG_H__ */
@@ -0,0 +1,23 @@
+/* Host stand-in for FreeRTOS semaphores, which as in FreeRTOS are queues of
+ * empty items. A mutex is a binary semaphore that starts given; it has no
+ * priority inheritance and is not recursive.
+ */
+#ifndef __HOST_FREERTOS_SEMPHR_H__
+#define __HOST_FREERTOS_SEMPHR_H__
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max,
+                                           UBaseType_t initial);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+#define xSemaphoreTake(sem, ticks) xQueueReceive((sem), NULL, (ticks))
+#define xSemaphoreGive(sem) xQueueSend((sem), NULL, 0)
+#define xSemaphoreGiveFromISR(sem, woken) \
+  xQueueSendFromISR((sem), NULL, (woken))
+#define vSemaphoreDelete(sem) vQueueDelete(sem)
+
+#endif /* __HOST_FREERTOS_SEMPHR_H__ */
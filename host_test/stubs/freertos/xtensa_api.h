@@ -0,0 +1,4 @@
+/* Host stand-in: nothing of the Xtensa port is used. */
+#ifndef __HOST_XTENSA_API_H__
+#define __HOST_XTENSA_API_H__
+#endif /* __HOST_XTENSA_API_H__ */
@@ -0,0 +1,26 @@
+/* Host stand-in for newlib's <sys/lock.h> as the ESP-IDF provides it: a
+ * lock that works zero-initialised, here a spinlock. Not recursive.
+ */
+#ifndef __HOST_SYS_LOCK_H__
+#define __HOST_SYS_LOCK_H__
+
+#include <sched.h>
+#include <stdatomic.h>
+
+typedef atomic_int _lock_t;
+
+static inline void _lock_init(_lock_t *lock) { atomic_store(lock, 0); }
+
+static inline void _lock_close(_lock_t *lock) { (void)lock; }
+
+static inline void _lock_acquire(_lock_t *lock) {
+  while (atomic_exchange_explicit(lock, 1, memory_order_acquire)) {
+    sched_yield();
+  }
+}
+
+static inline void _lock_release(_lock_t *lock) {
+  atomic_store_explicit(lock, 0, memory_order_release);
+}
+
+#endif /* __HOST_SYS_LOCK_H__ */
@@ -0,0 +1,122 @@
+/* Delay report model: packets arrive with jitter into a ring that the DAC
+ * drains at the byte rate behind a fixed DMA queue, and the data callback
+ * feeds the fill after each write to the report policy, as
+ * bt_app_a2d_data_cb() does with bt_i2s_delay_us(). The value reported is
+ * checked against the delay the audio actually sees, averaged over every
+ * sample, through steady play, a step in the buffer fill and a reset.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "bt_app_delay.h"
+#include "host_test.h"
+
+#define RATE_BPS (44100 * 4)
+#define PACKET_BYTES 2048
+#define DMA_BYTES (4 * 384 * 4) /* descriptors still queued to the DAC */
+#define BASE 150                /* stack delay, 1/10 ms */
+#define START_FILL_MS 80
+#define JITTER_US 6000
+#define SIM_SECONDS 120
+#define STEP_AT_S 40  /* the fill grows by STEP_MS here */
+#define STEP_MS 60
+#define RESET_AT_S 80 /* GET_DELAY_VALUE_EVT comes again */
+
+typedef struct {
+  uint32_t reports;
+  uint32_t settled_reports; /* reports more than 5 s after a change */
+  int64_t min_gap_us;       /* closest two reports */
+  int32_t worst_err;        /* report against the true mean, 1/10 ms */
+  int64_t step_latency_us;  /* from the step to a report that has it */
+} result_t;
+
+static uint32_t s_seed = 1;
+
+static uint32_t rnd(uint32_t n) {
+  s_seed = s_seed * 1664525u + 1013904223u;
+  return (s_seed >> 8) % n;
+}
+
+static uint32_t bytes_to_us(int64_t bytes) {
+  return (uint32_t)(bytes * 1000000 / RATE_BPS);
+}
+
+static void simulate(result_t *r) {
+  const double period_us = 1e6 * PACKET_BYTES / RATE_BPS;
+  int64_t fill = (int64_t)RATE_BPS * START_FILL_MS / 1000;
+  int64_t last_t = 0, last_report = INT64_MIN / 2, changed_at = 0;
+  int64_t true_sum = 0, true_n = 0; /* mean delay since the last change */
+  bool stepped = false, reset = false;
+  uint16_t before = 0; /* value reported when the step came */
+  bt_delay_t d;
+
+  memset(r, 0, sizeof(*r));
+  r->min_gap_us = INT64_MAX;
+  r->step_latency_us = -1;
+  bt_delay_reset(&d, BASE, bytes_to_us(fill + DMA_BYTES));
+  for (int64_t n = 0;; n++) {
+    int64_t t = (int64_t)(n * period_us) + rnd(JITTER_US);
+    t = t < last_t ? last_t : t;
+    if (t >= (int64_t)SIM_SECONDS * 1000000) {
+      break;
+    }
+    fill -= t * RATE_BPS / 1000000 - last_t * RATE_BPS / 1000000;
+    last_t = t;
+    if (!stepped && t >= (int64_t)STEP_AT_S * 1000000) {
+      /* a burst the buffer keeps from now on */
+      fill += (int64_t)RATE_BPS * STEP_MS / 1000;
+      stepped = true;
+      before = d.reported;
+      changed_at = t, true_sum = true_n = 0;
+    }
+    if (!reset && t >= (int64_t)RESET_AT_S * 1000000) {
+      bt_delay_reset(&d, BASE, bytes_to_us(fill + DMA_BYTES));
+      reset = true;
+      changed_at = t, true_sum = true_n = 0;
+    }
+    CHECK(fill >= 0);
+    fill += PACKET_BYTES;
+    /* each sample of the packet waits for what is queued ahead of it */
+    true_sum += bytes_to_us(fill - PACKET_BYTES / 2 + DMA_BYTES);
+    true_n++;
+
+    if (bt_delay_update(&d, t, bytes_to_us(fill + DMA_BYTES))) {
+      r->reports++;
+      if (t - last_report < r->min_gap_us) {
+        r->min_gap_us = t - last_report;
+      }
+      last_report = t;
+      if (t - changed_at > 5000000) {
+        r->settled_reports++;
+      }
+      if (stepped && r->step_latency_us < 0 &&
+          d.reported - before >= STEP_MS * 10 - BT_DELAY_THRESHOLD) {
+        r->step_latency_us = t - (int64_t)STEP_AT_S * 1000000;
+      }
+    }
+    /* once the smoothing has caught up, the value standing reported is
+     * within the report threshold of the truth
+     */
+    if (t - changed_at > 5000000) {
+      int32_t truth = BASE + (int32_t)((true_sum / true_n + 50) / 100);
+      int32_t err = abs((int32_t)d.reported - truth);
+      r->worst_err = err > r->worst_err ? err : r->worst_err;
+    }
+  }
+}
+
+int main(void) {
+  result_t r;
+
+  simulate(&r);
+  printf("reports %u (settled %u), closest %.1f s apart\n", r.reports,
+         r.settled_reports, r.min_gap_us / 1e6);
+  printf("worst error %.1f ms, step of %d ms reported after %.2f s\n",
+         r.worst_err / 10.0, STEP_MS, r.step_latency_us / 1e6);
+  /* the packet sawtooth and the jitter alone never trigger a report */
+  CHECK(r.settled_reports == 0);
+  CHECK(r.worst_err <= BT_DELAY_THRESHOLD);
+  CHECK(r.min_gap_us >= BT_DELAY_MIN_INTERVAL_US);
+  CHECK(r.step_latency_us >= 0 && r.step_latency_us < 5000000);
+  return host_test_done();
+}
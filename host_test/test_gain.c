@@ -0,0 +1,134 @@
+/* Volume stage checks against a plain reference, ramps from and to full
+ * scale, and the cost per sample of a 1440-byte chunk.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "bt_app_gain.h"
+#include "host_test.h"
+
+#define CHUNK_SAMPLES 720 /* 1440 bytes of 16-bit PCM */
+
+static _Alignas(4) int16_t s_buf[CHUNK_SAMPLES + 1];
+static int32_t s_wide[CHUNK_SAMPLES + 1];
+
+static void fill(int16_t v, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    s_buf[i] = v;
+    s_wide[i] = (int32_t)v * 256;
+  }
+}
+
+static void test_steady(void) {
+  bt_gain_t g;
+
+  /* full scale leaves the samples alone */
+  bt_gain_init(&g, BT_GAIN_VOLUME_MAX);
+  for (size_t i = 0; i < CHUNK_SAMPLES; i++) {
+    s_buf[i] = (int16_t)(rand() - RAND_MAX / 2);
+  }
+  int16_t ref[CHUNK_SAMPLES];
+  memcpy(ref, s_buf, sizeof(ref));
+  bt_gain_process(&g, s_buf, CHUNK_SAMPLES);
+  CHECK(memcmp(ref, s_buf, sizeof(ref)) == 0);
+
+  /* a steady gain is the Q15 product, both halves of a pair and an odd
+   * sample at the end alike
+   */
+  bt_gain_init(&g, 64);
+  int32_t k = (int32_t)atomic_load(&g.target);
+  CHECK(k > 0 && k < BT_GAIN_UNITY);
+  s_buf[0] = INT16_MIN, s_buf[1] = INT16_MAX, s_buf[2] = -1;
+  memcpy(ref, s_buf, sizeof(ref));
+  bt_gain_process(&g, s_buf, CHUNK_SAMPLES - 1);
+  size_t bad = 0;
+  for (size_t i = 0; i < CHUNK_SAMPLES - 1; i++) {
+    bad += s_buf[i] != (int16_t)((ref[i] * k) >> 15);
+  }
+  CHECK(bad == 0);
+}
+
+/* every sample of a constant input, ramped, lies between the two gains and
+ * moves one way only
+ */
+static void check_ramp(uint8_t from, uint8_t to, bool wide) {
+  bt_gain_t g;
+  const int16_t in = 20000;
+
+  bt_gain_init(&g, to);
+  int32_t k_to = (int32_t)atomic_load(&g.target);
+  bt_gain_init(&g, from);
+  int32_t k_from = (int32_t)g.current;
+  bt_gain_set_volume(&g, to);
+  fill(in, CHUNK_SAMPLES);
+  if (wide) {
+    bt_gain_process32(&g, s_wide, CHUNK_SAMPLES);
+  } else {
+    bt_gain_process(&g, s_buf, CHUNK_SAMPLES);
+  }
+
+  int32_t lo = (in * (k_from < k_to ? k_from : k_to)) >> 15;
+  int32_t hi = (in * (k_from > k_to ? k_from : k_to)) >> 15;
+  int dir = k_to > k_from ? 1 : -1;
+  int32_t prev = (in * k_from) >> 15;
+  size_t bad = 0;
+  for (size_t i = 0; i < CHUNK_SAMPLES; i++) {
+    int32_t v = wide ? s_wide[i] >> 8 : s_buf[i];
+    bad += v < lo - 1 || v > hi || (v - prev) * dir < -1;
+    prev = v;
+  }
+  CHECK(bad == 0);
+  CHECK(abs(prev - ((in * k_to) >> 15)) <= 1 + in / 64);
+  CHECK(g.current == (uint32_t)k_to);
+}
+
+static void test_ramps(void) {
+  for (int wide = 0; wide < 2; wide++) {
+    check_ramp(BT_GAIN_VOLUME_MAX, 0, wide);
+    check_ramp(BT_GAIN_VOLUME_MAX, 100, wide);
+    check_ramp(0, BT_GAIN_VOLUME_MAX, wide);
+    check_ramp(100, BT_GAIN_VOLUME_MAX, wide);
+    check_ramp(30, 31, wide);
+  }
+}
+
+static void bench(void) {
+  const int reps = 20000;
+  bt_gain_t g;
+  uint64_t c16 = 0, c16r = 0, c32 = 0, c32r = 0;
+
+  bt_gain_init(&g, 100);
+  for (int r = 0; r < reps; r++) {
+    uint64_t t = host_cycles();
+    bt_gain_process(&g, s_buf, CHUNK_SAMPLES);
+    c16 += host_cycles() - t;
+    bt_gain_set_volume(&g, r & 1 ? 100 : 90);
+    t = host_cycles();
+    bt_gain_process(&g, s_buf, CHUNK_SAMPLES);
+    c16r += host_cycles() - t;
+    bt_gain_set_volume(&g, 100);
+    bt_gain_process(&g, s_buf, CHUNK_SAMPLES);
+  }
+  for (int r = 0; r < reps; r++) {
+    uint64_t t = host_cycles();
+    bt_gain_process32(&g, s_wide, CHUNK_SAMPLES);
+    c32 += host_cycles() - t;
+    bt_gain_set_volume(&g, r & 1 ? 100 : 90);
+    t = host_cycles();
+    bt_gain_process32(&g, s_wide, CHUNK_SAMPLES);
+    c32r += host_cycles() - t;
+    bt_gain_set_volume(&g, 100);
+    bt_gain_process32(&g, s_wide, CHUNK_SAMPLES);
+  }
+  const double n = (double)reps * CHUNK_SAMPLES;
+  printf("host cycles per sample, %d-sample chunks:\n", CHUNK_SAMPLES);
+  printf("  16-bit steady %.2f, ramp %.2f\n", c16 / n, c16r / n);
+  printf("  32-bit steady %.2f, ramp %.2f\n", c32 / n, c32r / n);
+}
+
+int main(void) {
+  test_steady();
+  test_ramps();
+  bench();
+  return host_test_done();
+}
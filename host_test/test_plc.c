@@ -0,0 +1,133 @@
+/* Dropout injection: a 1 kHz sine goes through the I2S task's chunking
+ * with whole chunks lost, concealed by the PLC and, for comparison, by the
+ * silence the task wrote before. For each gap length it reports how long
+ * the output was actually silent and the discontinuity energy, the part of
+ * each sample-to-sample step beyond the steepest step of the sine itself.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bt_app_plc.h"
+#include "host_test.h"
+
+#define RATE 44100
+#define CHUNK_FRAMES 256
+#define CHUNKS 400
+#define FRAMES (CHUNK_FRAMES * CHUNKS)
+#define GAP_AT 100 /* first lost chunk */
+#define TONE_HZ 1000.0
+#define AMPLITUDE 16000.0
+
+typedef struct {
+  uint32_t silent_frames; /* output below -40 dB of the tone */
+  double disc_energy;     /* excess step energy, relative to the tone's */
+  int32_t max_step;
+} result_t;
+
+static int16_t s_ref[FRAMES * BT_PLC_MAX_CH];
+static int16_t s_out[FRAMES * BT_PLC_MAX_CH];
+
+static void sine(uint8_t ch) {
+  for (size_t i = 0; i < FRAMES; i++) {
+    int16_t v = (int16_t)lrint(AMPLITUDE * sin(2 * M_PI * TONE_HZ * i / RATE));
+    for (uint8_t c = 0; c < ch; c++) {
+      s_ref[i * ch + c] = v;
+    }
+  }
+}
+
+/* run the stream through with `lost` chunks missing from GAP_AT on */
+static void run(uint8_t ch, uint32_t lost, bool plc_on, result_t *r) {
+  static bt_plc_t plc;
+  const size_t chunk = CHUNK_FRAMES * ch;
+
+  bt_plc_reset(&plc, ch, RATE);
+  memcpy(s_out, s_ref, sizeof(int16_t) * FRAMES * ch);
+  for (size_t n = 0; n < CHUNKS; n++) {
+    int16_t *p = s_out + n * chunk;
+    if (n >= GAP_AT && n < GAP_AT + lost) {
+      if (plc_on) {
+        bt_plc_conceal(&plc, p, CHUNK_FRAMES);
+      } else {
+        memset(p, 0, chunk * sizeof(int16_t));
+      }
+    } else if (plc_on) {
+      bt_plc_good(&plc, p, CHUNK_FRAMES);
+    }
+  }
+
+  const double step = AMPLITUDE * 2 * sin(M_PI * TONE_HZ / RATE) + 1;
+  const int32_t floor = (int32_t)(AMPLITUDE / 100);
+  const size_t period = (size_t)(RATE / TONE_HZ);
+  double excess = 0;
+  memset(r, 0, sizeof(*r));
+  for (size_t i = 1; i < FRAMES; i++) {
+    int32_t d = abs(s_out[i * ch] - s_out[(i - 1) * ch]);
+    r->max_step = d > r->max_step ? d : r->max_step;
+    if (d > step) {
+      excess += (d - step) * (d - step);
+    }
+  }
+  /* silent: no sample of the surrounding period above the floor */
+  for (size_t i = period; i + period < FRAMES; i++) {
+    int32_t m = 0;
+    for (size_t k = i - period / 2; k < i + period / 2; k++) {
+      int32_t v = abs(s_out[k * ch]);
+      m = v > m ? v : m;
+    }
+    r->silent_frames += m < floor;
+  }
+  r->disc_energy = excess / (AMPLITUDE * AMPLITUDE / 2);
+}
+
+/* good audio passes untouched until there has been a gap */
+static void test_transparent(void) {
+  static bt_plc_t plc;
+
+  sine(2);
+  memcpy(s_out, s_ref, sizeof(s_out));
+  bt_plc_reset(&plc, 2, RATE);
+  for (size_t n = 0; n < CHUNKS; n++) {
+    bt_plc_good(&plc, s_out + n * CHUNK_FRAMES * 2, CHUNK_FRAMES);
+  }
+  CHECK(memcmp(s_out, s_ref, sizeof(s_out)) == 0);
+  CHECK(!bt_plc_concealing(&plc));
+}
+
+static void measure(uint8_t ch) {
+  static const uint32_t lost[] = {1, 2, 4, 8, 16};
+
+  sine(ch);
+  printf("%u channel(s)\n", ch);
+  printf("%8s %-8s %10s %12s %9s\n", "gap ms", "policy", "silent ms",
+         "disc energy", "max step");
+  for (size_t i = 0; i < sizeof(lost) / sizeof(lost[0]); i++) {
+    result_t zero, plc;
+    double ms = lost[i] * CHUNK_FRAMES * 1000.0 / RATE;
+    run(ch, lost[i], false, &zero);
+    run(ch, lost[i], true, &plc);
+    const result_t *res[] = {&zero, &plc};
+    for (int k = 0; k < 2; k++) {
+      printf("%8.1f %-8s %10.1f %12.4f %9d\n", ms, k ? "plc" : "silence",
+             res[k]->silent_frames * 1000.0 / RATE, res[k]->disc_energy,
+             res[k]->max_step);
+    }
+    /* concealment keeps a short gap audible throughout and never steps
+     * harder than the silence it replaced
+     */
+    CHECK(plc.silent_frames < zero.silent_frames);
+    CHECK(plc.disc_energy < zero.disc_energy / 10);
+    CHECK(plc.max_step <= zero.max_step);
+    if (ms < 20) {
+      CHECK(plc.silent_frames == 0);
+    }
+  }
+}
+
+int main(void) {
+  test_transparent();
+  measure(2);
+  measure(1);
+  return host_test_done();
+}
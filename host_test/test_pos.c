@@ -0,0 +1,98 @@
+/* Playback clock checks: anchoring from a play status response, agreement
+ * and re-anchoring on position reports, pauses, and a wrap of the frame
+ * count.
+ */
+#include "bt_app_pos.h"
+#include "host_test.h"
+
+#define RATE 44100
+
+static void test_unknown(void) {
+  bt_pos_t p = {0};
+  int32_t err = 1;
+
+  bt_pos_reset(&p);
+  CHECK(bt_pos_now(&p, 1000) == BT_POS_UNKNOWN);
+  /* the first report has nothing to agree with */
+  CHECK(!bt_pos_check(&p, 5000, 1000, RATE, &err));
+  CHECK(err == 0);
+  CHECK(p.resyncs == 0);
+  CHECK(bt_pos_now(&p, 1000) == 5000);
+}
+
+/* the clock runs from a play status response without waiting for a
+ * notification
+ */
+static void test_play_status(void) {
+  bt_pos_t p = {0};
+  const uint32_t frame = 12345;
+
+  bt_pos_reset(&p);
+  bt_pos_anchor(&p, 30000, frame, RATE);
+  bt_pos_set_playing(&p, true, frame);
+  CHECK(bt_pos_now(&p, frame) == 30000);
+  CHECK(bt_pos_now(&p, frame + RATE) == 31000);
+  /* before the anchored audio is heard the position runs up to it */
+  CHECK(bt_pos_now(&p, frame - RATE / 2) == 29500);
+
+  /* paused: the clock stops where it was heard */
+  bt_pos_set_playing(&p, false, frame + 2 * RATE);
+  CHECK(bt_pos_now(&p, frame + 10 * RATE) == 32000);
+
+  /* a response saying paused leaves the clock still */
+  bt_pos_reset(&p);
+  bt_pos_anchor(&p, 7000, frame, RATE);
+  bt_pos_set_playing(&p, false, frame);
+  CHECK(bt_pos_now(&p, frame + 5 * RATE) == 7000);
+}
+
+static void test_check(void) {
+  bt_pos_t p = {0};
+  int32_t err;
+
+  bt_pos_reset(&p);
+  bt_pos_anchor(&p, 0, 0, RATE);
+  bt_pos_set_playing(&p, true, 0);
+
+  /* a report within the window agrees, whatever the sign of the error,
+   * and an exact match is told apart from a re-anchor
+   */
+  CHECK(bt_pos_check(&p, 1000, RATE, RATE, &err));
+  CHECK(err == 0);
+  CHECK(bt_pos_check(&p, 2050, 2 * RATE, RATE, &err));
+  CHECK(err == -50);
+  CHECK(bt_pos_check(&p, 2950, 3 * RATE, RATE, &err));
+  CHECK(err == 50);
+  CHECK(p.resyncs == 0);
+
+  /* a seek is re-anchored, with the mismatch reported */
+  CHECK(!bt_pos_check(&p, 60000, 4 * RATE, RATE, &err));
+  CHECK(err == 4000 - 60000);
+  CHECK(p.resyncs == 1);
+  CHECK(bt_pos_now(&p, 5 * RATE) == 61000);
+
+  /* a new rate re-anchors too */
+  CHECK(!bt_pos_check(&p, 61000, 5 * RATE, 48000, &err));
+  CHECK(bt_pos_now(&p, 5 * RATE + 48000) == 62000);
+}
+
+static void test_wrap(void) {
+  bt_pos_t p = {0};
+  int32_t err;
+  const uint32_t frame = UINT32_MAX - RATE / 2;
+
+  bt_pos_reset(&p);
+  bt_pos_anchor(&p, 10000, frame, RATE);
+  bt_pos_set_playing(&p, true, frame);
+  CHECK(bt_pos_now(&p, frame + RATE) == 11000);
+  CHECK(bt_pos_check(&p, 12000, frame + 2 * RATE, RATE, &err));
+  CHECK(err == 0);
+}
+
+int main(void) {
+  test_unknown();
+  test_play_status();
+  test_check();
+  test_wrap();
+  return host_test_done();
+}
@@ -0,0 +1,165 @@
+/* Unit tests of the SPSC byte ring, including a two-thread stress run that
+ * checks every byte arrives once and in order.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "bt_app_ringbuf.h"
+#include "host_test.h"
+
+#define RING_SIZE 1024
+#define STRESS_BYTES (16u << 20)
+
+static uint8_t s_storage[RING_SIZE];
+
+static void test_init(void) {
+  bt_ringbuf_t rb;
+
+  CHECK(!bt_ringbuf_init(&rb, s_storage, 1000));
+  CHECK(!bt_ringbuf_init(&rb, s_storage, 0));
+  CHECK(!bt_ringbuf_init(&rb, NULL, RING_SIZE));
+  CHECK(bt_ringbuf_init(&rb, s_storage, RING_SIZE));
+  CHECK(bt_ringbuf_fill(&rb) == 0);
+  CHECK(bt_ringbuf_space(&rb) == RING_SIZE);
+}
+
+static void test_copy(void) {
+  bt_ringbuf_t rb;
+  uint8_t in[RING_SIZE], out[RING_SIZE];
+
+  bt_ringbuf_init(&rb, s_storage, RING_SIZE);
+  for (size_t i = 0; i < sizeof(in); i++) {
+    in[i] = (uint8_t)(i * 7 + 3);
+  }
+  /* the whole capacity is usable */
+  CHECK(bt_ringbuf_write(&rb, in, RING_SIZE));
+  CHECK(bt_ringbuf_space(&rb) == 0);
+  CHECK(!bt_ringbuf_write(&rb, in, 1));
+  CHECK(bt_ringbuf_read(&rb, out, RING_SIZE) == RING_SIZE);
+  CHECK(memcmp(in, out, RING_SIZE) == 0);
+
+  /* an item that doesn't fit is refused whole */
+  CHECK(bt_ringbuf_write(&rb, in, 600));
+  CHECK(!bt_ringbuf_write(&rb, in, 600));
+  CHECK(bt_ringbuf_fill(&rb) == 600);
+
+  /* reads and writes across the end of storage */
+  CHECK(bt_ringbuf_read(&rb, out, 500) == 500);
+  CHECK(bt_ringbuf_write(&rb, in + 100, 700));
+  CHECK(bt_ringbuf_read(&rb, out, 100) == 100);
+  CHECK(memcmp(out, in + 500, 100) == 0);
+  CHECK(bt_ringbuf_read(&rb, out, RING_SIZE) == 700);
+  CHECK(memcmp(out, in + 100, 700) == 0);
+  CHECK(bt_ringbuf_read(&rb, out, 1) == 0);
+}
+
+static void test_spans(void) {
+  bt_ringbuf_t rb;
+  size_t len = 0;
+  uint8_t buf[RING_SIZE] = {0};
+
+  bt_ringbuf_init(&rb, s_storage, RING_SIZE);
+  bt_ringbuf_write(&rb, buf, 900);
+  bt_ringbuf_read(&rb, buf, 900);
+
+  /* free space wraps: the first span runs to the end of storage */
+  uint8_t *w = bt_ringbuf_write_acquire(&rb, &len);
+  CHECK(w == s_storage + 900);
+  CHECK(len == RING_SIZE - 900);
+  memset(w, 0xaa, len);
+  bt_ringbuf_write_commit(&rb, len);
+  w = bt_ringbuf_write_acquire(&rb, &len);
+  CHECK(w == s_storage);
+  CHECK(len == 900);
+  memset(w, 0xbb, 10);
+  bt_ringbuf_write_commit(&rb, 10);
+  CHECK(bt_ringbuf_fill(&rb) == RING_SIZE - 900 + 10);
+
+  const uint8_t *r = bt_ringbuf_read_acquire(&rb, &len);
+  CHECK(r == s_storage + 900 && len == RING_SIZE - 900 && r[0] == 0xaa);
+  bt_ringbuf_read_commit(&rb, len);
+  r = bt_ringbuf_read_acquire(&rb, &len);
+  CHECK(r == s_storage && len == 10 && r[9] == 0xbb);
+  bt_ringbuf_read_commit(&rb, len);
+  r = bt_ringbuf_read_acquire(&rb, &len);
+  CHECK(len == 0);
+
+  /* the running indices count every byte */
+  CHECK(bt_ringbuf_write_index(&rb) == 900 + RING_SIZE - 900 + 10);
+  CHECK(bt_ringbuf_read_index(&rb) == bt_ringbuf_write_index(&rb));
+
+  bt_ringbuf_write(&rb, buf, 5);
+  bt_ringbuf_reset(&rb);
+  CHECK(bt_ringbuf_fill(&rb) == 0);
+  CHECK(bt_ringbuf_write_index(&rb) == 0);
+}
+
+static bt_ringbuf_t s_stress;
+
+static void *stress_producer(void *arg) {
+  uint8_t pkt[300];
+  uint32_t seq = 0;
+
+  for (size_t sent = 0; sent < STRESS_BYTES;) {
+    /* odd packet sizes, so the items land everywhere in the ring */
+    size_t n = 37 + (sent / 300) % 250;
+    if (n > STRESS_BYTES - sent) {
+      n = STRESS_BYTES - sent;
+    }
+    for (size_t i = 0; i < n; i++) {
+      pkt[i] = (uint8_t)(seq + i);
+    }
+    while (!bt_ringbuf_write(&s_stress, pkt, n)) {
+      sched_yield();
+    }
+    seq += n;
+    sent += n;
+  }
+  return NULL;
+}
+
+static void *stress_consumer(void *arg) {
+  size_t *errors = arg;
+  uint32_t seq = 0;
+
+  for (size_t got = 0; got < STRESS_BYTES;) {
+    size_t len = 0;
+    const uint8_t *span = bt_ringbuf_read_acquire(&s_stress, &len);
+    if (len == 0) {
+      sched_yield();
+    } else if (len > 1440) {
+      len = 1440;
+    }
+    for (size_t i = 0; i < len; i++) {
+      if (span[i] != (uint8_t)(seq + i)) {
+        (*errors)++;
+      }
+    }
+    bt_ringbuf_read_commit(&s_stress, len);
+    seq += len;
+    got += len;
+  }
+  return NULL;
+}
+
+static void test_stress(void) {
+  pthread_t prod, cons;
+  size_t errors = 0;
+
+  bt_ringbuf_init(&s_stress, s_storage, RING_SIZE);
+  pthread_create(&cons, NULL, stress_consumer, &errors);
+  pthread_create(&prod, NULL, stress_producer, NULL);
+  pthread_join(prod, NULL);
+  pthread_join(cons, NULL);
+  CHECK(errors == 0);
+  CHECK(bt_ringbuf_fill(&s_stress) == 0);
+}
+
+int main(void) {
+  test_init();
+  test_copy();
+  test_spans();
+  test_stress();
+  return host_test_done();
+}
@@ -0,0 +1,194 @@
+/* APLL trim controller against a simulated source: the ringbuffer fill is
+ * integrated from packets sent on a drifting source clock and drained on the
+ * trimmed output clock, with the arrival times jittered and stalled as on a
+ * busy radio. Checks that the trim learns the drift, the fill settles on the
+ * target, jitter and stalls keep the trim in a band around the drift and a
+ * start below the target is grown first.
+ *
+ *   test_trim [-v]   -v prints the trim once a second
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "bt_app_trim.h"
+#include "host_test.h"
+
+#define STEP_US 1000     /* simulation step */
+#define CHUNK_US 5000    /* consumer wakes once per DMA descriptor */
+#define PACKET_US 20000  /* audio per A2DP packet */
+#define TARGET_US 100000 /* target fill */
+#define RUN_S 600        /* simulated time per profile */
+#define SETTLED_S 450    /* measured from here on */
+
+typedef struct {
+  const char *name;
+  int32_t drift_ppm;    /* source clock fast by, before the step */
+  int32_t step_ppm;     /* and from half way through */
+  uint32_t jitter_us;   /* arrival delay, uniform up to this */
+  uint32_t stall_every; /* packets between radio stalls, 0 for none */
+  uint32_t stall_us;    /* length of a stall */
+  int32_t start_us;     /* fill at the start, relative to the target */
+} profile_t;
+
+typedef struct {
+  int32_t ppm_min, ppm_max; /* trim once settled */
+  double ppm_mean;
+  int32_t err_min, err_max; /* smoothed fill error once settled, us */
+  double err_mean_us;       /* raw fill error once settled */
+  uint32_t changes;         /* trim changes once settled */
+  double filled_s;          /* when the fill first reached the target */
+  int32_t final_ppm;
+} result_t;
+
+static bool s_verbose;
+static uint32_t s_rand = 1;
+
+static uint32_t sim_rand(uint32_t range) {
+  s_rand = s_rand * 1664525u + 1013904223u;
+  return range ? (uint32_t)(((uint64_t)(s_rand >> 8) * range) >> 24) : 0;
+}
+
+static result_t sim_run(const profile_t *pr) {
+  bt_trim_t t;
+  result_t r = {
+      .ppm_min = INT32_MAX,
+      .ppm_max = INT32_MIN,
+      .err_min = INT32_MAX,
+      .err_max = INT32_MIN,
+      .filled_s = -1,
+  };
+  double fill_us = TARGET_US + pr->start_us;
+  double err_sum = 0;
+  double ppm_sum = 0;
+  uint32_t err_n = 0;
+  uint32_t packet = 0;
+  double sent_us = 0;     /* next packet leaves the source */
+  int64_t arrival_us = 0; /* and arrives */
+  int64_t stall_end_us = 0;
+
+  bt_trim_reset(&t);
+  bt_trim_fill_up(&t);
+  s_rand = 1;
+  for (int64_t now = 0; now < (int64_t)RUN_S * 1000000; now += STEP_US) {
+    int32_t drift =
+        now < (int64_t)RUN_S * 500000 ? pr->drift_ppm : pr->step_ppm;
+    bool settled = now >= (int64_t)SETTLED_S * 1000000;
+
+    /* packets leave the source every PACKET_US of its own clock and queue
+     * behind each other on the radio
+     */
+    while (arrival_us <= now) {
+      fill_us += PACKET_US;
+      packet++;
+      sent_us += PACKET_US * (1.0 - drift * 1e-6);
+      if (pr->stall_every && packet % pr->stall_every == 0) {
+        stall_end_us = (int64_t)sent_us + pr->stall_us;
+      }
+      int64_t next = (int64_t)sent_us + sim_rand(pr->jitter_us);
+      if (next < stall_end_us) {
+        next = stall_end_us;
+      }
+      if (next > arrival_us) {
+        arrival_us = next;
+      }
+    }
+    fill_us -= STEP_US * (1.0 + t.ppm * 1e-6);
+    if (fill_us < 0) {
+      fill_us = 0;
+    }
+
+    if (now % CHUNK_US == 0) {
+      int32_t err = (int32_t)(fill_us - TARGET_US);
+      bt_trim_update(&t, now, err);
+      if (r.filled_s < 0 && !t.filling) {
+        r.filled_s = now / 1e6;
+      }
+      if (settled) {
+        r.changes += t.ppm != r.final_ppm;
+        r.ppm_min = t.ppm < r.ppm_min ? t.ppm : r.ppm_min;
+        r.ppm_max = t.ppm > r.ppm_max ? t.ppm : r.ppm_max;
+        r.err_min = t.fill_err_us < r.err_min ? t.fill_err_us : r.err_min;
+        r.err_max = t.fill_err_us > r.err_max ? t.fill_err_us : r.err_max;
+        err_sum += err;
+        ppm_sum += t.ppm;
+        err_n++;
+      }
+      r.final_ppm = t.ppm;
+    }
+    if (s_verbose && now % 1000000 == 0) {
+      printf("  %s %3llds fill %+7.0f us trim %+5d ppm\n", pr->name,
+             (long long)(now / 1000000), fill_us - TARGET_US, t.ppm);
+    }
+  }
+  r.err_mean_us = err_n ? err_sum / err_n : 0;
+  r.ppm_mean = err_n ? ppm_sum / err_n : 0;
+  printf("%-7s drift %+5d/%+5d ppm: trim %+7.1f (%+5d..%+5d) ppm, smoothed "
+         "error %+6d..%+6d us, mean %+6.0f us, %u changes, filled at %.1f s\n",
+         pr->name, pr->drift_ppm, pr->step_ppm, r.ppm_mean, r.ppm_min,
+         r.ppm_max, r.err_min, r.err_max, r.err_mean_us, r.changes,
+         r.filled_s);
+  return r;
+}
+
+/* the trim follows the drift on average and the fill holds near the
+ * target. The fill is sampled once per DMA descriptor against the sawtooth
+ * of whole packets, so its measured mean is off by up to half a descriptor
+ * depending on their phase, which the drift turns slowly; the trim wanders
+ * by the proportional gain times that, around 100 ppm, far below audible
+ */
+static result_t check_tracks(const profile_t *pr, double mean_tol,
+                             int32_t err_tol_us) {
+  result_t r = sim_run(pr);
+
+  CHECK(r.ppm_mean > pr->step_ppm - mean_tol &&
+        r.ppm_mean < pr->step_ppm + mean_tol);
+  CHECK(r.ppm_min > pr->step_ppm - 400 && r.ppm_max < pr->step_ppm + 400);
+  CHECK(r.err_min >= -err_tol_us && r.err_max <= err_tol_us);
+  CHECK(r.err_mean_us > -err_tol_us / 2 && r.err_mean_us < err_tol_us / 2);
+  return r;
+}
+
+int main(int argc, char **argv) {
+  s_verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+  /* steady clocks: the integral learns the offset */
+  const profile_t steady[] = {
+      {"steady", 0, 0, 0, 0, 0, 0},
+      {"steady", 120, 120, 0, 0, 0, 0},
+      {"steady", -350, -350, 0, 0, 0, 0},
+  };
+  for (size_t i = 0; i < sizeof(steady) / sizeof(steady[0]); i++) {
+    check_tracks(&steady[i], 5, 4000);
+  }
+
+  /* a packet's worth of arrival jitter and regular radio stalls move the
+   * fill by tens of ms; the smoothing keeps the trim near the drift
+   */
+  const profile_t jittery[] = {
+      {"jitter", 80, 80, 15000, 0, 0, 0},
+      {"jitter", -200, -200, 30000, 0, 0, 0},
+      {"stalls", 150, 150, 5000, 250, 60000, 0},
+  };
+  for (size_t i = 0; i < sizeof(jittery) / sizeof(jittery[0]); i++) {
+    check_tracks(&jittery[i], 8, 8000);
+  }
+
+  /* the source's clock changes mid stream, e.g. another phone */
+  const profile_t step = {"step", -100, 250, 10000, 0, 0, 0};
+  check_tracks(&step, 8, 8000);
+
+  /* a start 60 ms short runs at the full negative trim until the target is
+   * reached, without winding up the integral
+   */
+  const profile_t short_start = {"short", 50, 50, 5000, 0, 0, -60000};
+  result_t r = check_tracks(&short_start, 8, 8000);
+  /* 60 ms at 2000 ppm takes 30 s, less the packet in flight */
+  CHECK(r.filled_s > 15 && r.filled_s < 35);
+
+  /* beyond the trim's range the output falls behind at the limit */
+  const profile_t wide = {"wide", 3000, 3000, 0, 0, 0, 0};
+  r = sim_run(&wide);
+  CHECK(r.ppm_min == BT_TRIM_LIMIT_PPM && r.ppm_max == BT_TRIM_LIMIT_PPM);
+
+  return host_test_done();
+}
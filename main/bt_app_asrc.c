@@ -0,0 +1,157 @@
+#include "bt_app_asrc.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define ASRC_ONE (1ull << 32)
+/* filter phases per input frame; a power of two, taken from the top bits
+ * of the position's fraction
+ */
+#define ASRC_PHASE_BITS 6
+#define ASRC_PHASES (1 << ASRC_PHASE_BITS)
+/* Kaiser window shape: stopband against transition width for 16 taps */
+#define ASRC_KAISER_BETA 9.0f
+/* the centre tap, x0, sits just before the read position */
+#define ASRC_CENTRE (BT_ASRC_TAPS / 2 - 1)
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+
+/* Q15 taps per phase, one more phase to interpolate towards; int32 so that
+ * the unit impulse at phase 0 is exact
+ */
+static int32_t s_kernel[ASRC_PHASES + 1][BT_ASRC_TAPS];
+static bool s_kernel_built;
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* zeroth order modified Bessel function of the first kind */
+static float bt_asrc_bessel_i0(float x);
+static void bt_asrc_build_kernel(void);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static float bt_asrc_bessel_i0(float x) {
+  float sum = 1.0f;
+  float term = 1.0f;
+
+  for (int k = 1; k < 25; k++) {
+    float f = x / (2.0f * k);
+    term *= f * f;
+    sum += term;
+  }
+  return sum;
+}
+
+static void bt_asrc_build_kernel(void) {
+  const float norm = bt_asrc_bessel_i0(ASRC_KAISER_BETA);
+
+  for (int p = 0; p <= ASRC_PHASES; p++) {
+    float h[BT_ASRC_TAPS];
+    float sum = 0;
+    for (int j = 0; j < BT_ASRC_TAPS; j++) {
+      /* distance from the read position to tap j */
+      float d = (float)(j - ASRC_CENTRE) - (float)p / ASRC_PHASES;
+      float u = d / (BT_ASRC_TAPS / 2);
+      float sinc = d == 0 ? 1.0f : sinf((float)M_PI * d) / ((float)M_PI * d);
+      float w = u <= -1.0f || u >= 1.0f
+                    ? 0.0f
+                    : bt_asrc_bessel_i0(ASRC_KAISER_BETA *
+                                        sqrtf(1.0f - u * u)) /
+                          norm;
+      h[j] = sinc * w;
+      sum += h[j];
+    }
+    /* unity gain at DC for every phase */
+    for (int j = 0; j < BT_ASRC_TAPS; j++) {
+      s_kernel[p][j] = (int32_t)lrintf(h[j] / sum * 32768.0f);
+    }
+  }
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_asrc_reset(bt_asrc_t *r, uint8_t ch) {
+  if (!s_kernel_built) {
+    bt_asrc_build_kernel();
+    s_kernel_built = true;
+  }
+  memset(r, 0, sizeof(*r));
+  r->ch = ch > BT_ASRC_MAX_CH ? BT_ASRC_MAX_CH : ch;
+  r->step = ASRC_ONE;
+  /* prime the window so the first input frame lands on the centre tap */
+  r->phase = (uint64_t)(BT_ASRC_TAPS - ASRC_CENTRE) * ASRC_ONE;
+}
+
+void bt_asrc_set_ratio_ppm(bt_asrc_t *r, int32_t ppm) {
+  /* multiply rather than shift: ppm is negative as often as not */
+  r->step = ASRC_ONE + (uint64_t)((int64_t)ppm * (int64_t)ASRC_ONE / 1000000);
+}
+
+size_t bt_asrc_process(bt_asrc_t *r, const int16_t *in, size_t in_frames,
+                       size_t *consumed, int16_t *out, size_t out_frames) {
+  const uint8_t ch = r->ch;
+  size_t used = 0;
+  size_t produced = 0;
+
+  while (produced < out_frames) {
+    /* slide the window until the read position sits just past x0 */
+    while (r->phase >= ASRC_ONE) {
+      if (used == in_frames) {
+        goto done;
+      }
+      const int16_t *f = in + used * ch;
+      for (uint8_t c = 0; c < ch; c++) {
+        r->hist[c][r->head] = f[c];
+        r->hist[c][r->head + BT_ASRC_TAPS] = f[c];
+      }
+      r->head = (r->head + 1) & (BT_ASRC_TAPS - 1);
+      used++;
+      r->phase -= ASRC_ONE;
+    }
+
+    /* taps for this position, between two neighbouring phases; adjacent
+     * phases differ by far less than 2^16, so the product fits
+     */
+    uint32_t frac = (uint32_t)r->phase;
+    const int32_t *k0 = s_kernel[frac >> (32 - ASRC_PHASE_BITS)];
+    const int32_t *k1 = k0 + BT_ASRC_TAPS;
+    int32_t t = (int32_t)((frac >> (17 - ASRC_PHASE_BITS)) & 0x7fff);
+    int32_t taps[BT_ASRC_TAPS];
+    for (int j = 0; j < BT_ASRC_TAPS; j++) {
+      taps[j] = k0[j] + (((k1[j] - k0[j]) * t) >> 15);
+    }
+    for (uint8_t c = 0; c < ch; c++) {
+      /* the taps' magnitudes sum to under 1.91, so a full-scale window
+       * stays inside 32 bits
+       */
+      const int16_t *x = &r->hist[c][r->head];
+      int32_t acc = 1 << 14;
+      for (int j = 0; j < BT_ASRC_TAPS; j++) {
+        acc += taps[j] * x[j];
+      }
+      int32_t y = acc >> 15;
+      if (y > INT16_MAX) {
+        y = INT16_MAX;
+      } else if (y < INT16_MIN) {
+        y = INT16_MIN;
+      }
+      out[c] = (int16_t)y;
+    }
+    out += ch;
+    produced++;
+    r->phase += r->step;
+  }
+
+done:
+  *consumed = used;
+  return produced;
+}
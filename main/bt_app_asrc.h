@@ -0,0 +1,60 @@
+#ifndef __BT_APP_ASRC_H__
+#define __BT_APP_ASRC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* most channels the resampler handles */
+#define BT_ASRC_MAX_CH 2
+/* input frames each output frame is computed from */
+#define BT_ASRC_TAPS 16
+
+/**
+ * Fixed-point polyphase windowed-sinc resampler for interleaved 16-bit PCM.
+ *
+ * The read position advances by `step` input frames per output frame, as
+ * a Q32 fixed-point value. Each output is a 16-tap Kaiser-windowed sinc
+ * around it, from a table of 64 phases with linear interpolation between
+ * them. A step of exactly 1.0 with zero phase reproduces the input bit for
+ * bit.
+ */
+typedef struct {
+  uint64_t phase; /*!< Q32 position past the centre tap */
+  uint64_t step;  /*!< Q32 input frames per output */
+  /* last BT_ASRC_TAPS frames per channel, stored twice so that the window
+   * starting at head is contiguous
+   */
+  int16_t hist[BT_ASRC_MAX_CH][2 * BT_ASRC_TAPS];
+  uint8_t head; /*!< oldest frame in hist */
+  uint8_t ch;   /*!< channels per frame */
+} bt_asrc_t;
+
+/**
+ * @brief  reset the resampler to unity ratio and an empty history; the
+ *         first reset also builds the shared filter table
+ */
+void bt_asrc_reset(bt_asrc_t *r, uint8_t ch);
+
+/**
+ * @brief  set the conversion ratio
+ *
+ * @param [in] ppm  how much faster the input runs than the output, in parts
+ *                  per million; positive values consume input faster
+ */
+void bt_asrc_set_ratio_ppm(bt_asrc_t *r, int32_t ppm);
+
+/**
+ * @brief  resample as much as the input and output buffers allow
+ *
+ * @param [in]  in          input frames
+ * @param [in]  in_frames   number of input frames
+ * @param [out] consumed    number of input frames used
+ * @param [out] out         output frames
+ * @param [in]  out_frames  room in out, in frames
+ *
+ * @return  number of frames written to out
+ */
+size_t bt_asrc_process(bt_asrc_t *r, const int16_t *in, size_t in_frames,
+                       size_t *consumed, int16_t *out, size_t out_frames);
+
+#endif /* __BT_APP_ASRC_H__ */
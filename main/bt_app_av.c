@@ -7,6 +7,7 @@
 #include "bt_app_av.h"
 
 #include <inttypes.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -14,25 +15,34 @@
 
 #include "bt_app_bda.h"
 #include "bt_app_core.h"
+#include "bt_app_delay.h"
 #include "bt_app_display.h"
 #include "bt_app_i2s.h"
+#include "bt_app_pos.h"
+#include "bt_app_rc_tl.h"
+#include "bt_app_trace.h"
 #include "esp_bt_device.h"
 #include "esp_bt_main.h"
 #include "esp_gap_bt_api.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "sys/lock.h"
 
-/* AVRCP used transaction labels */
-#define APP_RC_CT_TL_GET_CAPS (0)
-#define APP_RC_CT_TL_GET_META_DATA (1)
-#define APP_RC_CT_TL_RN_TRACK_CHANGE (2)
-#define APP_RC_CT_TL_RN_PLAYBACK_CHANGE (3)
-#define APP_RC_CT_TL_RN_PLAY_POS_CHANGE (4)
-
-/* Application layer causes delay value */
-#define APP_DELAY_VALUE 50  // 5ms
+/* AVRCP command response timeout and resends */
+#define APP_RC_CT_TIMEOUT_MS (1000)
+#define APP_RC_CT_RETRIES (2)
+/* wait before trying again when the timeout check could not be queued */
+#define APP_RC_CT_POLL_RETRY_MS (250)
+/* interval of play position reports; the local clock fills in between */
+#define APP_RC_CT_POS_INTERVAL_S (60)
+/* marks a stack delay handed to the data callback in s_delay_reset */
+#define DELAY_RESET_PENDING (1u << 16)
+/* requested metadata attributes */
+#define APP_RC_CT_META_ATTRS                                                 \
+  (ESP_AVRC_MD_ATTR_TITLE | ESP_AVRC_MD_ATTR_ARTIST | ESP_AVRC_MD_ATTR_ALBUM | \
+   ESP_AVRC_MD_ATTR_GENRE | ESP_AVRC_MD_ATTR_PLAYING_TIME)
 
 /*******************************
  * STATIC FUNCTION DECLARATIONS
@@ -42,12 +52,30 @@
 // static uint8_t vol_to_log(uint8_t volume);
 /* allocate new meta buffer */
 static void bt_app_alloc_meta_buffer(esp_avrc_ct_cb_param_t *param);
+/* AVRCP command senders for the label allocator */
+static void bt_av_send_get_caps(uint8_t tl, uint32_t arg);
+static void bt_av_send_metadata(uint8_t tl, uint32_t attr_mask);
+static void bt_av_send_register(uint8_t tl, uint32_t event_id);
+static void bt_av_send_passthrough(uint8_t tl, uint32_t key);
+static void bt_av_send_get_play_status(uint8_t tl, uint32_t arg);
+/* arm the poll timer for the next command deadline, or stop it */
+static void bt_av_rc_tl_rearm(void);
+/* check outstanding AVRCP commands for timeouts, in the app task */
+static void bt_av_rc_tl_poll(uint16_t event, void *param);
+/* queue a timeout check from the poll timer */
+static void bt_av_rc_tl_timer_cb(void *arg);
+/* request metadata of the current track */
+static void bt_av_request_metadata(void);
+/* register for a notification if the peer supports it */
+static void bt_av_register_notify(uint8_t event_id);
 /* handler for new track is loaded */
-static void bt_av_new_track(void);
+static void bt_av_new_track(const uint8_t *uid);
 /* handler for track status change */
 static void bt_av_playback_changed(void);
 /* handler for track playing position change */
-static void bt_av_play_pos_changed(void);
+static void bt_av_play_pos_changed(uint32_t pos_ms);
+/* frame count at which audio arriving now will be heard */
+static uint32_t bt_av_pos_frame(void);
 /* notification event handler */
 static void bt_av_notify_evt_handler(uint8_t event_id,
                                      esp_avrc_rn_param_t *event_parameter);
@@ -83,6 +111,18 @@ static _lock_t s_volume_lock;
 static uint8_t s_volume = 0; /* local volume value */
 static bool s_volume_notify; /* notify volume change or not */
 static bool s_play_notify;
+/* delay report, stack plus playback pipeline; owned by the data callback */
+static bt_delay_t s_delay;
+/* stack delay for the data callback to start over from, with
+ * DELAY_RESET_PENDING set, or 0
+ */
+static atomic_uint_least32_t s_delay_reset;
+static atomic_bool s_delay_rpt; /* peer accepts delay reports */
+static bt_rc_tl_t s_rc_tl; /* outstanding AVRCP controller commands */
+/* fires at the next AVRCP command deadline, idle while none is pending */
+static esp_timer_handle_t s_rc_tl_timer = NULL;
+static bt_meta_t s_meta; /* metadata of the current and recent tracks */
+static bt_pos_t s_pos;   /* playback position clock */
 
 /********************************
  * STATIC FUNCTION DEFINITIONS
@@ -90,8 +130,17 @@ static bool s_play_notify;
 
 static void bt_app_alloc_meta_buffer(esp_avrc_ct_cb_param_t *param) {
   esp_avrc_ct_cb_param_t *rc = (esp_avrc_ct_cb_param_t *)(param);
-  uint8_t *attr_text = (uint8_t *)malloc(rc->meta_rsp.attr_length + 1);
-
+  uint8_t *attr_text = bt_app_str_alloc(rc->meta_rsp.attr_length + 1);
+
+  if (attr_text == NULL) {
+    /* the arena is full; pass the attribute on as lost, with an empty
+     * string for the log
+     */
+    static uint8_t s_empty_text[1];
+    rc->meta_rsp.attr_length = -1;
+    rc->meta_rsp.attr_text = s_empty_text;
+    return;
+  }
   memcpy(attr_text, rc->meta_rsp.attr_text, rc->meta_rsp.attr_length);
   attr_text[rc->meta_rsp.attr_length] = 0;
   rc->meta_rsp.attr_text = attr_text;
@@ -99,44 +148,119 @@ static void bt_app_alloc_meta_buffer(esp_avrc_ct_cb_param_t *param) {
 
 ////////////////////////////////////
 //
-// AV EVENTS
+// AVRCP Commands
 //
 ////////////////////////////////////
 
-static void bt_av_new_track(void) {
-  /* request metadata */
-  uint8_t attr_mask = ESP_AVRC_MD_ATTR_TITLE | ESP_AVRC_MD_ATTR_ARTIST |
-                      ESP_AVRC_MD_ATTR_ALBUM | ESP_AVRC_MD_ATTR_GENRE |
-                      ESP_AVRC_MD_ATTR_PLAYING_TIME;
-  esp_avrc_ct_send_metadata_cmd(APP_RC_CT_TL_GET_META_DATA, attr_mask);
+static void bt_av_send_get_caps(uint8_t tl, uint32_t arg) {
+  esp_avrc_ct_send_get_rn_capabilities_cmd(tl);
+}
+
+static void bt_av_send_metadata(uint8_t tl, uint32_t attr_mask) {
+  esp_avrc_ct_send_metadata_cmd(tl, attr_mask);
+}
+
+static void bt_av_send_register(uint8_t tl, uint32_t event_id) {
+  /* the source also reports the position on seeks and track changes */
+  esp_avrc_ct_send_register_notification_cmd(
+      tl, event_id,
+      event_id == ESP_AVRC_RN_PLAY_POS_CHANGED ? APP_RC_CT_POS_INTERVAL_S
+                                               : 0);
+}
+
+static void bt_av_send_passthrough(uint8_t tl, uint32_t key) {
+  esp_avrc_ct_send_passthrough_cmd(tl, key & 0xff, key >> 8);
+}
+
+static void bt_av_send_get_play_status(uint8_t tl, uint32_t arg) {
+  esp_avrc_ct_send_get_play_status_cmd(tl);
+}
+
+static void bt_av_rc_tl_rearm(void) {
+  int64_t deadline;
+
+  if (s_rc_tl_timer == NULL) {
+    return;
+  }
+  esp_timer_stop(s_rc_tl_timer);
+  if (bt_rc_tl_next_deadline(&s_rc_tl, &deadline)) {
+    int64_t wait = deadline - esp_timer_get_time();
+    esp_timer_start_once(s_rc_tl_timer, wait > 0 ? wait : 1);
+  }
+}
+
+static void bt_av_rc_tl_poll(uint16_t event, void *param) {
+  bt_rc_tl_poll(&s_rc_tl, esp_timer_get_time());
+  bt_av_rc_tl_rearm();
+}
+
+static void bt_av_rc_tl_timer_cb(void *arg) {
+  if (!bt_app_work_dispatch(bt_av_rc_tl_poll, 0, NULL, 0, NULL,
+                            BT_APP_LANE_BULK)) {
+    /* the lane is full; nothing else would wake the check again */
+    esp_timer_start_once(s_rc_tl_timer, APP_RC_CT_POLL_RETRY_MS * 1000);
+  }
+}
+
+static void bt_av_request_metadata(void) {
+  bt_rc_tl_issue(&s_rc_tl, esp_timer_get_time(), BT_RC_CMD_METADATA,
+                 APP_RC_CT_META_ATTRS, APP_RC_CT_TIMEOUT_MS, APP_RC_CT_RETRIES,
+                 bt_av_send_metadata, NULL);
+}
 
+static void bt_av_register_notify(uint8_t event_id) {
   /* register notification if peer (controller) supports the event_id */
   if (esp_avrc_rn_evt_bit_mask_operation(ESP_AVRC_BIT_MASK_OP_TEST,
-                                         &s_avrc_peer_rn_cap,
-                                         ESP_AVRC_RN_TRACK_CHANGE)) {
-    esp_avrc_ct_send_register_notification_cmd(APP_RC_CT_TL_RN_TRACK_CHANGE,
-                                               ESP_AVRC_RN_TRACK_CHANGE, 0);
+                                         &s_avrc_peer_rn_cap, event_id)) {
+    /* a registration is answered only by the next change; never time out,
+     * and never hold two labels for the same event
+     */
+    bt_rc_tl_cancel(&s_rc_tl, BT_RC_CMD_NOTIFY, event_id);
+    bt_rc_tl_issue(&s_rc_tl, esp_timer_get_time(), BT_RC_CMD_NOTIFY, event_id,
+                   0, 0, bt_av_send_register, NULL);
   }
 }
 
-static void bt_av_playback_changed(void) {
-  /* register notification if peer (controller) support the event_id */
-  if (esp_avrc_rn_evt_bit_mask_operation(ESP_AVRC_BIT_MASK_OP_TEST,
-                                         &s_avrc_peer_rn_cap,
-                                         ESP_AVRC_RN_PLAY_STATUS_CHANGE)) {
-    esp_avrc_ct_send_register_notification_cmd(
-        APP_RC_CT_TL_RN_PLAYBACK_CHANGE, ESP_AVRC_RN_PLAY_STATUS_CHANGE, 0);
+////////////////////////////////////
+//
+// AV EVENTS
+//
+////////////////////////////////////
+
+static uint32_t bt_av_pos_frame(void) {
+  return bt_i2s_frames_played() +
+         (uint32_t)((uint64_t)bt_i2s_delay_us() * bt_i2s_sample_rate() /
+                    1000000);
+}
+
+static void bt_av_new_track(const uint8_t *uid) {
+  bt_pos_anchor(&s_pos, 0, bt_av_pos_frame(), bt_i2s_sample_rate());
+  if (bt_meta_track_changed(&s_meta, uid, APP_RC_CT_META_ATTRS)) {
+    ESP_LOGI(BT_AV_TAG, "Track metadata cached");
+  } else {
+    bt_av_request_metadata();
   }
+  bt_av_register_notify(ESP_AVRC_RN_TRACK_CHANGE);
 }
 
-static void bt_av_play_pos_changed(void) {
-  /* register notification if peer (controller) support the event_id */
-  if (esp_avrc_rn_evt_bit_mask_operation(ESP_AVRC_BIT_MASK_OP_TEST,
-                                         &s_avrc_peer_rn_cap,
-                                         ESP_AVRC_RN_PLAY_POS_CHANGED)) {
-    esp_avrc_ct_send_register_notification_cmd(
-        APP_RC_CT_TL_RN_PLAY_POS_CHANGE, ESP_AVRC_RN_PLAY_POS_CHANGED, 10);
+static void bt_av_playback_changed(void) {
+  bt_av_register_notify(ESP_AVRC_RN_PLAY_STATUS_CHANGE);
+}
+
+static void bt_av_play_pos_changed(uint32_t pos_ms) {
+  int32_t err;
+
+  if (!bt_pos_check(&s_pos, pos_ms, bt_av_pos_frame(), bt_i2s_sample_rate(),
+                    &err)) {
+    ESP_LOGI(BT_AV_TAG,
+             "Play position %" PRIu32 " ms, clock re-anchored (was %+" PRId32
+             " ms)",
+             pos_ms, err);
+  } else {
+    ESP_LOGI(BT_AV_TAG, "Play position %" PRIu32 " ms, local clock %+" PRId32
+             " ms", pos_ms, err);
   }
+  bt_av_register_notify(ESP_AVRC_RN_PLAY_POS_CHANGED);
 }
 
 ////////////////////////////////////
@@ -150,13 +274,23 @@ static void bt_av_notify_evt_handler(uint8_t event_id,
   switch (event_id) {
     /* when new track is loaded, this event comes */
     case ESP_AVRC_RN_TRACK_CHANGE:
-      bt_av_new_track();
+      BT_TRACE(BT_TRACE_RC_TRACK, 0, 0);
+      bt_av_new_track(event_parameter->elm_id);
       break;
     /* when track status changed, this event comes */
     case ESP_AVRC_RN_PLAY_STATUS_CHANGE:
       ESP_LOGI(BT_AV_TAG, "Playback status changed: 0x%x",
                event_parameter->playback);
+      BT_TRACE(BT_TRACE_RC_PLAY, event_parameter->playback, 0);
       bt_av_playback_changed();
+      /* a pause holds the clock at what is heard now; a restart only
+       * shows once the new audio is through the buffer
+       */
+      if (event_parameter->playback == ESP_AVRC_PLAYBACK_PLAYING) {
+        bt_pos_set_playing(&s_pos, true, bt_av_pos_frame());
+      } else {
+        bt_pos_set_playing(&s_pos, false, bt_i2s_frames_played());
+      }
       if (event_parameter->playback == ESP_AVRC_PLAYBACK_PAUSED) {
         ui_update_status(UI_STATUS_PAUSED);
       } else if (event_parameter->playback == ESP_AVRC_PLAYBACK_PLAYING) {
@@ -165,9 +299,7 @@ static void bt_av_notify_evt_handler(uint8_t event_id,
       break;
     /* when track playing position changed, this event comes */
     case ESP_AVRC_RN_PLAY_POS_CHANGED:
-      ESP_LOGI(BT_AV_TAG, "Play position changed: %" PRIu32 "-ms",
-               event_parameter->play_pos);
-      bt_av_play_pos_changed();
+      bt_av_play_pos_changed(event_parameter->play_pos);
       break;
     /* others */
     default:
@@ -189,15 +321,20 @@ static void volume_set_by_controller(uint8_t volume) {
   _lock_acquire(&s_volume_lock);
   s_volume = volume;
   _lock_release(&s_volume_lock);
+  /* apply it in the audio path */
+  bt_i2s_set_volume(volume);
 }
 
 static void ct_press_play() {
   // Attempt to start playing
   ESP_LOGI(BT_RC_TG_TAG, ">>>>>>>>>>> Attempting to start playing");
-  esp_avrc_ct_send_passthrough_cmd(0, ESP_AVRC_PT_CMD_PLAY,
-                                   ESP_AVRC_PT_CMD_STATE_PRESSED);
-  esp_avrc_ct_send_passthrough_cmd(1, ESP_AVRC_PT_CMD_PLAY,
-                                   ESP_AVRC_PT_CMD_STATE_RELEASED);
+  int64_t now = esp_timer_get_time();
+  bt_rc_tl_issue(&s_rc_tl, now, BT_RC_CMD_PASSTHROUGH,
+                 ESP_AVRC_PT_CMD_PLAY | ESP_AVRC_PT_CMD_STATE_PRESSED << 8,
+                 APP_RC_CT_TIMEOUT_MS, 0, bt_av_send_passthrough, NULL);
+  bt_rc_tl_issue(&s_rc_tl, now, BT_RC_CMD_PASSTHROUGH,
+                 ESP_AVRC_PT_CMD_PLAY | ESP_AVRC_PT_CMD_STATE_RELEASED << 8,
+                 APP_RC_CT_TIMEOUT_MS, 0, bt_av_send_passthrough, NULL);
 }
 
 // TODO: button press to erase pairing
@@ -210,6 +347,11 @@ static void ct_press_play() {
 static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param) {
   ESP_LOGD(BT_AV_TAG, "%s event: %d", __func__, event);
 
+  /* left over from a connection that has gone since */
+  if (bt_app_work_stale(BT_APP_CONN_A2D)) {
+    return;
+  }
+
   esp_a2d_cb_param_t *a2d = NULL;
 
   switch (event) {
@@ -225,20 +367,20 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param) {
         ui_update_status(UI_STATUS_NOT_CONNECTED);
         esp_bt_gap_set_scan_mode(ESP_BT_CONNECTABLE,
                                  ESP_BT_GENERAL_DISCOVERABLE);
-        bt_i2s_driver_uninstall();
-        bt_i2s_task_shut_down();
+        bt_i2s_engine_idle();
         // auto connect but only on first boot?
         // begin polling in attempt to connect?
       } else if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTED) {
         ui_update_status(UI_STATUS_CONNECTED);
         esp_bt_gap_set_scan_mode(ESP_BT_NON_CONNECTABLE,
                                  ESP_BT_NON_DISCOVERABLE);
-        bt_i2s_task_start_up();
+        bt_i2s_engine_arm();
         // bt_autoconnect_task_shutdown();
         nvs_update_bda(bda);
       } else if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTING) {
         ui_update_status(UI_STATUS_CONNECTING);
-        bt_i2s_driver_install();
+        /* get the output clock running while the link is set up */
+        bt_i2s_engine_arm();
       }
       break;
     }
@@ -250,6 +392,12 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param) {
       s_audio_state = a2d->audio_stat.state;
       if (ESP_A2D_AUDIO_STATE_STARTED == a2d->audio_stat.state) {
         s_pkt_cnt = 0;
+      } else {
+        bt_i2s_latency_dump();
+        bt_app_core_dump_stats();
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_TRACE
+        bt_trace_dump();
+#endif
       }
       break;
     }
@@ -274,6 +422,7 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param) {
         if (oct0 & (0x01 << 3)) {
           ch_count = 1;
         }
+        BT_TRACE(BT_TRACE_A2D_CFG, ch_count, sample_rate);
         bt_i2s_config(sample_rate, ch_count);
 
         // #endif
@@ -305,7 +454,9 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param) {
       a2d = (esp_a2d_cb_param_t *)(p_param);
       ESP_LOGI(BT_AV_TAG, "protocol service capabilities configured: 0x%x ",
                a2d->a2d_psc_cfg_stat.psc_mask);
-      if (a2d->a2d_psc_cfg_stat.psc_mask & ESP_A2D_PSC_DELAY_RPT) {
+      atomic_store(&s_delay_rpt,
+                   a2d->a2d_psc_cfg_stat.psc_mask & ESP_A2D_PSC_DELAY_RPT);
+      if (atomic_load(&s_delay_rpt)) {
         ESP_LOGI(BT_AV_TAG, "Peer device support delay reporting");
       } else {
         ESP_LOGI(BT_AV_TAG, "Peer device unsupport delay reporting");
@@ -330,9 +481,16 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param) {
       a2d = (esp_a2d_cb_param_t *)(p_param);
       ESP_LOGI(BT_AV_TAG, "Get delay report value: delay_value: %u * 1/10 ms",
                a2d->a2d_get_delay_value_stat.delay_value);
-      /* Default delay value plus delay caused by application layer */
-      esp_a2d_sink_set_delay_value(a2d->a2d_get_delay_value_stat.delay_value +
-                                   APP_DELAY_VALUE);
+      /* Default delay value plus the expected delay of the playback
+       * pipeline; refined from the actual buffer fill while streaming. The
+       * data callback owns the running state and starts over on its next
+       * packet, so only a scratch copy is worked out here.
+       */
+      bt_delay_t d;
+      bt_delay_reset(&d, a2d->a2d_get_delay_value_stat.delay_value,
+                     bt_i2s_delay_us());
+      atomic_store(&s_delay_reset, DELAY_RESET_PENDING | d.base);
+      esp_a2d_sink_set_delay_value(bt_delay_value(&d));
       break;
     }
     /* others */
@@ -352,6 +510,16 @@ static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param) {
 
   esp_avrc_ct_cb_param_t *rc = (esp_avrc_ct_cb_param_t *)(p_param);
 
+  /* left over from a connection that has gone since; the metadata text is
+   * all it owns
+   */
+  if (bt_app_work_stale(BT_APP_CONN_RC_CT)) {
+    if (event == ESP_AVRC_CT_METADATA_RSP_EVT) {
+      bt_app_str_free(rc->meta_rsp.attr_text);
+    }
+    return;
+  }
+
   switch (event) {
     /* when connection state changed, this event comes */
     case ESP_AVRC_CT_CONNECTION_STATE_EVT: {
@@ -363,11 +531,34 @@ static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param) {
           bda[5]);
 
       if (rc->conn_stat.connected) {
-        /* get remote supported event_ids of peer AVRCP Target */
-        esp_avrc_ct_send_get_rn_capabilities_cmd(APP_RC_CT_TL_GET_CAPS);
+        bt_rc_tl_reset(&s_rc_tl);
+        if (s_rc_tl_timer == NULL) {
+          const esp_timer_create_args_t args = {
+              .callback = bt_av_rc_tl_timer_cb,
+              .name = "rc_tl_poll",
+          };
+          esp_timer_create(&args, &s_rc_tl_timer);
+        }
+        /* get remote supported event_ids of peer AVRCP Target, and ask for
+         * the metadata alongside rather than after it
+         */
+        bt_rc_tl_issue(&s_rc_tl, esp_timer_get_time(), BT_RC_CMD_GET_CAPS, 0,
+                       APP_RC_CT_TIMEOUT_MS, APP_RC_CT_RETRIES,
+                       bt_av_send_get_caps, NULL);
+        bt_meta_reset(&s_meta);
+        bt_pos_reset(&s_pos);
+        /* the clock would otherwise stand still until the first play
+         * status notification, which only comes with a change
+         */
+        bt_rc_tl_issue(&s_rc_tl, esp_timer_get_time(), BT_RC_CMD_PLAY_STATUS,
+                       0, APP_RC_CT_TIMEOUT_MS, APP_RC_CT_RETRIES,
+                       bt_av_send_get_play_status, NULL);
+        bt_meta_track_changed(&s_meta, NULL, APP_RC_CT_META_ATTRS);
+        bt_av_request_metadata();
         /* start playing as soon as we've connected */
         ct_press_play();
       } else {
+        bt_rc_tl_reset(&s_rc_tl);
         /* clear peer notification capability record */
         s_avrc_peer_rn_cap.bits = 0;
       }
@@ -379,19 +570,25 @@ static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param) {
                "AVRC passthrough rsp: key_code 0x%x, key_state %d, rsp_code %d",
                rc->psth_rsp.key_code, rc->psth_rsp.key_state,
                rc->psth_rsp.rsp_code);
+      bt_rc_tl_complete_label(&s_rc_tl, rc->psth_rsp.tl);
       break;
     }
     /* when metadata responsed, this event comes */
     case ESP_AVRC_CT_METADATA_RSP_EVT: {
       ESP_LOGI(BT_RC_CT_TAG, "AVRC metadata rsp: attribute id 0x%x, %s",
                rc->meta_rsp.attr_id, rc->meta_rsp.attr_text);
-      free(rc->meta_rsp.attr_text);
+      /* attributes arrive one per event; the first frees the label */
+      bt_rc_tl_complete(&s_rc_tl, BT_RC_CMD_METADATA, BT_RC_TL_ANY_ARG);
+      bt_meta_set_attr(&s_meta, rc->meta_rsp.attr_id, rc->meta_rsp.attr_text,
+                       rc->meta_rsp.attr_length);
+      bt_app_str_free(rc->meta_rsp.attr_text);
       break;
     }
     /* when notified, this event comes */
     case ESP_AVRC_CT_CHANGE_NOTIFY_EVT: {
       ESP_LOGI(BT_RC_CT_TAG, "AVRC event notification: %d",
                rc->change_ntf.event_id);
+      bt_rc_tl_complete(&s_rc_tl, BT_RC_CMD_NOTIFY, rc->change_ntf.event_id);
       bt_av_notify_evt_handler(rc->change_ntf.event_id,
                                &rc->change_ntf.event_parameter);
       break;
@@ -456,14 +653,31 @@ static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param) {
       ESP_LOGI(BT_RC_CT_TAG, "remote rn_cap: count %d, bitmask 0x%x",
                rc->get_rn_caps_rsp.cap_count, rc->get_rn_caps_rsp.evt_set.bits);
       s_avrc_peer_rn_cap.bits = rc->get_rn_caps_rsp.evt_set.bits;
-      bt_av_new_track();
-      bt_av_playback_changed();
-      bt_av_play_pos_changed();
+      bt_rc_tl_complete(&s_rc_tl, BT_RC_CMD_GET_CAPS, BT_RC_TL_ANY_ARG);
+      /* metadata is already on its way; register all notifications at once */
+      bt_av_register_notify(ESP_AVRC_RN_TRACK_CHANGE);
+      bt_av_register_notify(ESP_AVRC_RN_PLAY_STATUS_CHANGE);
+      bt_av_register_notify(ESP_AVRC_RN_PLAY_POS_CHANGED);
       break;
     }
+    /* when the play status asked for on connection comes back */
     case ESP_AVRC_CT_PLAY_STATUS_RSP_EVT: {
-      /* attempting to see if we get this event after pressing play*/
-      ESP_LOGI(BT_RC_CT_TAG, "play status change response event");
+      bool playing =
+          rc->play_status_rsp.play_status == ESP_AVRC_PLAYBACK_PLAYING;
+      ESP_LOGI(BT_RC_CT_TAG,
+               "AVRC play status rsp: status 0x%x, position %" PRIu32
+               " of %" PRIu32 " ms",
+               rc->play_status_rsp.play_status,
+               rc->play_status_rsp.song_position,
+               rc->play_status_rsp.song_length);
+      bt_rc_tl_complete(&s_rc_tl, BT_RC_CMD_PLAY_STATUS, BT_RC_TL_ANY_ARG);
+      /* the position holds for the audio being sent now; an unknown one
+       * is the same 0xFFFFFFFF as BT_POS_UNKNOWN
+       */
+      uint32_t frame = bt_av_pos_frame();
+      bt_pos_anchor(&s_pos, rc->play_status_rsp.song_position, frame,
+                    bt_i2s_sample_rate());
+      bt_pos_set_playing(&s_pos, playing, frame);
       break;
     }
     /* others */
@@ -471,6 +685,8 @@ static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param) {
       ESP_LOGE(BT_RC_CT_TAG, "%s unhandled event: %d", __func__, event);
       break;
   }
+  /* commands issued or answered above move the next deadline */
+  bt_av_rc_tl_rearm();
 }
 
 ////////////////////////////////////
@@ -481,6 +697,11 @@ static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param) {
 static void bt_av_hdl_avrc_tg_evt(uint16_t event, void *p_param) {
   ESP_LOGD(BT_RC_TG_TAG, "%s event: %d", __func__, event);
 
+  /* left over from a connection that has gone since */
+  if (bt_app_work_stale(BT_APP_CONN_RC_TG)) {
+    return;
+  }
+
   esp_avrc_tg_cb_param_t *rc = (esp_avrc_tg_cb_param_t *)(p_param);
 
   switch (event) {
@@ -555,15 +776,34 @@ static void bt_av_hdl_avrc_tg_evt(uint16_t event, void *p_param) {
 
 void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param) {
   switch (event) {
-    case ESP_A2D_CONNECTION_STATE_EVT:
     case ESP_A2D_AUDIO_STATE_EVT:
-    case ESP_A2D_AUDIO_CFG_EVT:
+      BT_TRACE(BT_TRACE_A2D_AUDIO, param->audio_stat.state, 0);
+      if (param->audio_stat.state == ESP_A2D_AUDIO_STATE_STARTED) {
+        /* time it here, in order with the audio data that follows */
+        bt_i2s_stream_started();
+      }
+      /* fall through */
+    case ESP_A2D_CONNECTION_STATE_EVT:
+      if (event == ESP_A2D_CONNECTION_STATE_EVT) {
+        BT_TRACE(BT_TRACE_A2D_CONN, param->conn_stat.state, 0);
+        /* bulk work still queued for this connection is stale now */
+        if (param->conn_stat.state == ESP_A2D_CONNECTION_STATE_DISCONNECTED) {
+          bt_app_conn_gen_next(BT_APP_CONN_A2D);
+        }
+      }
+      /* fall through */
+    case ESP_A2D_AUDIO_CFG_EVT: {
+      /* stream set up and tear down go ahead of everything else */
+      bt_app_work_dispatch(bt_av_hdl_a2d_evt, event, param,
+                           sizeof(esp_a2d_cb_param_t), NULL, BT_APP_LANE_HIGH);
+      break;
+    }
     case ESP_A2D_PROF_STATE_EVT:
     case ESP_A2D_SNK_PSC_CFG_EVT:
     case ESP_A2D_SNK_SET_DELAY_VALUE_EVT:
     case ESP_A2D_SNK_GET_DELAY_VALUE_EVT: {
       bt_app_work_dispatch(bt_av_hdl_a2d_evt, event, param,
-                           sizeof(esp_a2d_cb_param_t), NULL);
+                           sizeof(esp_a2d_cb_param_t), NULL, BT_APP_LANE_BULK);
       break;
     }
     default:
@@ -578,8 +818,18 @@ void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param) {
 //
 ////////////////////////////////////
 void bt_app_a2d_data_cb(const uint8_t *data, uint32_t len) {
+  BT_TRACE(BT_TRACE_PACKET, 0, len);
   write_ringbuf(data, len);
 
+  uint32_t reset = atomic_exchange(&s_delay_reset, 0);
+  if (reset) {
+    bt_delay_reset(&s_delay, (uint16_t)reset, bt_i2s_delay_us());
+  }
+  if (atomic_load(&s_delay_rpt) &&
+      bt_delay_update(&s_delay, esp_timer_get_time(), bt_i2s_delay_us())) {
+    esp_a2d_sink_set_delay_value(bt_delay_value(&s_delay));
+  }
+
   /* log the number every 100 packets */
   if (++s_pkt_cnt % 100 == 0) {
     ESP_LOGI(BT_AV_TAG, "Audio packet count: %" PRIu32, s_pkt_cnt);
@@ -594,16 +844,37 @@ void bt_app_a2d_data_cb(const uint8_t *data, uint32_t len) {
 void bt_app_rc_ct_cb(esp_avrc_ct_cb_event_t event,
                      esp_avrc_ct_cb_param_t *param) {
   switch (event) {
+    case ESP_AVRC_CT_CONNECTION_STATE_EVT: {
+      if (!param->conn_stat.connected) {
+        bt_app_conn_gen_next(BT_APP_CONN_RC_CT);
+      }
+      bt_app_work_dispatch(bt_av_hdl_avrc_ct_evt, event, param,
+                           sizeof(esp_avrc_ct_cb_param_t), NULL,
+                           BT_APP_LANE_HIGH);
+      break;
+    }
+    case ESP_AVRC_CT_CHANGE_NOTIFY_EVT: {
+      /* only the newest status or position of each kind matters */
+      bt_app_work_coalesce(bt_av_hdl_avrc_ct_evt, event,
+                           param->change_ntf.event_id, param,
+                           sizeof(esp_avrc_ct_cb_param_t), BT_APP_LANE_BULK,
+                           BT_APP_CONN_RC_CT);
+      break;
+    }
     case ESP_AVRC_CT_METADATA_RSP_EVT:
       bt_app_alloc_meta_buffer(param);
       /* fall through */
-    case ESP_AVRC_CT_CONNECTION_STATE_EVT:
     case ESP_AVRC_CT_PASSTHROUGH_RSP_EVT:
-    case ESP_AVRC_CT_CHANGE_NOTIFY_EVT:
+    case ESP_AVRC_CT_PLAY_STATUS_RSP_EVT:
     case ESP_AVRC_CT_REMOTE_FEATURES_EVT:
     case ESP_AVRC_CT_GET_RN_CAPABILITIES_RSP_EVT: {
-      bt_app_work_dispatch(bt_av_hdl_avrc_ct_evt, event, param,
-                           sizeof(esp_avrc_ct_cb_param_t), NULL);
+      if (!bt_app_work_dispatch(bt_av_hdl_avrc_ct_evt, event, param,
+                                sizeof(esp_avrc_ct_cb_param_t), NULL,
+                                BT_APP_LANE_BULK) &&
+          event == ESP_AVRC_CT_METADATA_RSP_EVT) {
+        /* the handler will never see it, so release the text here */
+        bt_app_str_free(param->meta_rsp.attr_text);
+      }
       break;
     }
     default:
@@ -621,16 +892,42 @@ void bt_app_rc_tg_cb(esp_avrc_tg_cb_event_t event,
                      esp_avrc_tg_cb_param_t *param) {
   switch (event) {
     case ESP_AVRC_TG_CONNECTION_STATE_EVT:
+      if (!param->conn_stat.connected) {
+        bt_app_conn_gen_next(BT_APP_CONN_RC_TG);
+      }
+      bt_app_work_dispatch(bt_av_hdl_avrc_tg_evt, event, param,
+                           sizeof(esp_avrc_tg_cb_param_t), NULL,
+                           BT_APP_LANE_HIGH);
+      break;
     case ESP_AVRC_TG_REMOTE_FEATURES_EVT:
     case ESP_AVRC_TG_PASSTHROUGH_CMD_EVT:
     case ESP_AVRC_TG_SET_ABSOLUTE_VOLUME_CMD_EVT:
     case ESP_AVRC_TG_REGISTER_NOTIFICATION_EVT:
     case ESP_AVRC_TG_SET_PLAYER_APP_VALUE_EVT:
       bt_app_work_dispatch(bt_av_hdl_avrc_tg_evt, event, param,
-                           sizeof(esp_avrc_tg_cb_param_t), NULL);
+                           sizeof(esp_avrc_tg_cb_param_t), NULL,
+                           BT_APP_LANE_BULK);
       break;
     default:
       ESP_LOGE(BT_RC_TG_TAG, "Invalid AVRC event: %d", event);
       break;
   }
 }
+
+////////////////////////////////////
+//
+// Track Metadata
+//
+////////////////////////////////////
+void bt_av_read_track(bt_meta_read_cb_t cb, void *ctx) {
+  bt_meta_read(&s_meta, cb, ctx);
+}
+
+////////////////////////////////////
+//
+// Playback Position
+//
+////////////////////////////////////
+uint32_t bt_av_play_pos_ms(void) {
+  return bt_pos_now(&s_pos, bt_i2s_frames_played());
+}
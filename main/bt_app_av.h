@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 
+#include "bt_app_meta.h"
 #include "esp_a2dp_api.h"
 #include "esp_avrc_api.h"
 
@@ -51,4 +52,21 @@ void bt_app_rc_ct_cb(esp_avrc_ct_cb_event_t event,
 void bt_app_rc_tg_cb(esp_avrc_tg_cb_event_t event,
                      esp_avrc_tg_cb_param_t *param);
 
+/**
+ * @brief  look at the metadata of the current track without copying it
+ *
+ * @param [in] cb   called with the track while the cache is locked; keep it
+ *                  short, it holds up metadata updates
+ * @param [in] ctx  passed to `cb`
+ */
+void bt_av_read_track(bt_meta_read_cb_t cb, void *ctx);
+
+/**
+ * @brief  position in the current track as heard at the output
+ *
+ * @return  position in ms, from the rendered audio since the last AVRCP
+ *          report; UINT32_MAX if unknown
+ */
+uint32_t bt_av_play_pos_ms(void);
+
 #endif /* __BT_APP_AV_H__*/
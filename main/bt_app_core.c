@@ -6,11 +6,17 @@
 
 #include "bt_app_core.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
+#include "bt_app_latency.h"
+#include "bt_app_pool.h"
+#include "esp_a2dp_api.h"
+#include "esp_avrc_api.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/FreeRTOSConfig.h"
 #include "freertos/queue.h"
@@ -18,6 +24,26 @@
 #include "freertos/task.h"
 #include "freertos/xtensa_api.h"
 
+/* queue depth of each lane */
+#define BT_APP_HIGH_QUEUE_LEN 8
+#define BT_APP_BULK_QUEUE_LEN 16
+/* parameter blocks; as many as the lanes hold, so a full lane fails first */
+#define BT_APP_PARAM_BLOCKS (BT_APP_HIGH_QUEUE_LEN + BT_APP_BULK_QUEUE_LEN)
+/* bytes of metadata text that can be in flight */
+#define BT_APP_STR_ARENA_SIZE 2048
+/* each profile's connection generation is a byte of one word, so that a
+ * message records all of them at once
+ */
+#define CONN_GEN_ONE(conn) (1u << (8 * (conn)))
+#define CONN_GEN_MASK(conn) (0xffu << (8 * (conn)))
+
+/* every parameter type passed through `bt_app_work_dispatch` */
+typedef union {
+  esp_a2d_cb_param_t a2d;
+  esp_avrc_ct_cb_param_t avrc_ct;
+  esp_avrc_tg_cb_param_t avrc_tg;
+} bt_app_param_t;
+
 /*******************************
  * STATIC FUNCTION DECLARATIONS
  ******************************/
@@ -25,31 +51,60 @@
 /* handler for application task */
 static void bt_app_task_handler(void *arg);
 /* message sender */
-static bool bt_app_send_msg(bt_app_msg_t *msg);
+static bool bt_app_send_msg(bt_app_msg_t *msg, bt_app_lane_t lane);
 /* handle dispatched messages */
 static void bt_app_work_dispatched(bt_app_msg_t *msg);
+/* handle coalesced messages */
+static void bt_app_work_coalesced(bt_app_msg_t *msg);
 
 /*******************************
  * STATIC VARIABLE DEFINITIONS
  ******************************/
 
-static QueueHandle_t s_bt_app_task_queue = NULL; /* handle of work queue */
+/* handle of work queue per lane */
+static QueueHandle_t s_bt_app_task_queue[BT_APP_LANE_NUM] = {NULL};
+/* counts messages queued over all lanes */
+static SemaphoreHandle_t s_bt_app_task_sem = NULL;
+static atomic_uint s_lane_dropped[BT_APP_LANE_NUM]; /* full lane drops */
+static bt_hist_t s_lane_latency[BT_APP_LANE_NUM];   /* queued to handled */
+static const char *s_lane_name[BT_APP_LANE_NUM] = {"high lane", "bulk lane"};
+/* newest parameters per coalescing key, non-NULL while a message is queued */
+static _Atomic(void *) s_coalesce_slot[BT_APP_COALESCE_KEYS];
+static atomic_uint s_coalesced; /* events merged into a queued one */
+/* profile owning the values in each coalescing slot */
+static _Atomic uint8_t s_coalesce_conn[BT_APP_COALESCE_KEYS];
+/* a byte per profile, bumped when its connection goes down */
+static atomic_uint s_conn_gen;
+static atomic_uint s_stale;  /* bulk work from an earlier connection */
+static uint32_t s_work_gen;  /* generations of the message being handled */
+static bool s_work_bulk;     /* it is dispatched bulk work */
+static bool s_work_counted;  /* and has been counted stale */
 static TaskHandle_t s_bt_app_task_handle = NULL; /* handle of app task  */
+static bt_app_param_t s_param_blocks[BT_APP_PARAM_BLOCKS];
+static bt_pool_t s_param_pool; /* message parameters */
+static uint32_t s_str_storage[BT_APP_STR_ARENA_SIZE / sizeof(uint32_t)];
+static bt_arena_t s_str_arena; /* strings referenced by parameters */
 
 /*******************************
  * STATIC FUNCTION DEFINITIONS
  ******************************/
 
-static bool bt_app_send_msg(bt_app_msg_t *msg) {
-  if (msg == NULL) {
+static bool bt_app_send_msg(bt_app_msg_t *msg, bt_app_lane_t lane) {
+  if (msg == NULL || lane >= BT_APP_LANE_NUM) {
     return false;
   }
 
-  /* send the message to work queue */
-  if (xQueueSend(s_bt_app_task_queue, msg, 10 / portTICK_PERIOD_MS) != pdTRUE) {
-    ESP_LOGE(BT_APP_CORE_TAG, "%s xQueue send failed", __func__);
+  /* send the message to work queue; never wait, the caller is usually the
+   * Bluetooth stack's own task
+   */
+  msg->sent_us = (uint32_t)esp_timer_get_time();
+  msg->gen = atomic_load(&s_conn_gen);
+  if (xQueueSend(s_bt_app_task_queue[lane], msg, 0) != pdTRUE) {
+    /* only count it; logging here would hold up the stack's task */
+    atomic_fetch_add(&s_lane_dropped[lane], 1);
     return false;
   }
+  xSemaphoreGive(s_bt_app_task_sem);
   return true;
 }
 
@@ -59,20 +114,52 @@ static void bt_app_work_dispatched(bt_app_msg_t *msg) {
   }
 }
 
+static void bt_app_work_coalesced(bt_app_msg_t *msg) {
+  void *param = atomic_exchange(&s_coalesce_slot[msg->key], NULL);
+
+  if (param) {
+    if (msg->cb) {
+      msg->cb(msg->event, param);
+    }
+    bt_pool_free(&s_param_pool, param);
+  }
+}
+
 static void bt_app_task_handler(void *arg) {
   bt_app_msg_t msg;
+  int lane;
 
   for (;;) {
+    /* wait for a message on any lane, then take the highest one queued */
+    if (pdTRUE != xSemaphoreTake(s_bt_app_task_sem, portMAX_DELAY)) {
+      continue;
+    }
+    for (lane = 0; lane < BT_APP_LANE_NUM; lane++) {
+      if (pdTRUE == xQueueReceive(s_bt_app_task_queue[lane], &msg, 0)) {
+        break;
+      }
+    }
     /* receive message from work queue and handle it */
-    if (pdTRUE ==
-        xQueueReceive(s_bt_app_task_queue, &msg, (TickType_t)portMAX_DELAY)) {
+    if (lane < BT_APP_LANE_NUM) {
+      bt_latency_hist_add(&s_lane_latency[lane],
+                          (uint32_t)esp_timer_get_time() - msg.sent_us);
       ESP_LOGD(BT_APP_CORE_TAG, "%s, signal: 0x%x, event: 0x%x", __func__,
                msg.sig, msg.event);
+      /* coalesced work holds no parameters of its own; the slots are
+       * emptied when the generation moves on
+       */
+      s_work_bulk =
+          lane == BT_APP_LANE_BULK && msg.sig == BT_APP_SIG_WORK_DISPATCH;
+      s_work_gen = msg.gen;
+      s_work_counted = false;
 
       switch (msg.sig) {
         case BT_APP_SIG_WORK_DISPATCH:
           bt_app_work_dispatched(&msg);
           break;
+        case BT_APP_SIG_WORK_COALESCED:
+          bt_app_work_coalesced(&msg);
+          break;
         default:
           ESP_LOGW(BT_APP_CORE_TAG, "%s, unhandled signal: %d", __func__,
                    msg.sig);
@@ -80,7 +167,7 @@ static void bt_app_task_handler(void *arg) {
       } /* switch (msg.sig) */
 
       if (msg.param) {
-        free(msg.param);
+        bt_pool_free(&s_param_pool, msg.param);
       }
     }
   }
@@ -91,7 +178,8 @@ static void bt_app_task_handler(void *arg) {
  *******************************/
 
 bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params,
-                          int param_len, bt_app_copy_cb_t p_copy_cback) {
+                          int param_len, bt_app_copy_cb_t p_copy_cback,
+                          bt_app_lane_t lane) {
   ESP_LOGD(BT_APP_CORE_TAG, "%s event: 0x%x, param len: %d", __func__, event,
            param_len);
 
@@ -103,24 +191,146 @@ bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params,
   msg.cb = p_cback;
 
   if (param_len == 0) {
-    return bt_app_send_msg(&msg);
+    return bt_app_send_msg(&msg, lane);
   } else if (p_params && param_len > 0) {
-    if ((msg.param = malloc(param_len)) != NULL) {
+    if ((size_t)param_len > sizeof(bt_app_param_t)) {
+      ESP_LOGE(BT_APP_CORE_TAG, "%s param too large: %d", __func__,
+               param_len);
+      return false;
+    }
+    /* an exhausted pool counts the failure itself; no logging here */
+    if ((msg.param = bt_pool_alloc(&s_param_pool)) != NULL) {
       memcpy(msg.param, p_params, param_len);
       /* check if caller has provided a copy callback to do the deep copy
        */
       if (p_copy_cback) {
         p_copy_cback(msg.param, p_params, param_len);
       }
-      return bt_app_send_msg(&msg);
+      if (bt_app_send_msg(&msg, lane)) {
+        return true;
+      }
+      bt_pool_free(&s_param_pool, msg.param);
     }
   }
 
   return false;
 }
 
+bool bt_app_work_coalesce(bt_app_cb_t p_cback, uint16_t event, uint16_t key,
+                          void *p_params, int param_len, bt_app_lane_t lane,
+                          bt_app_conn_t conn) {
+  bt_app_msg_t msg;
+  void *param;
+  void *queued;
+
+  if (key >= BT_APP_COALESCE_KEYS || p_params == NULL || param_len <= 0 ||
+      (size_t)param_len > sizeof(bt_app_param_t) || conn >= BT_APP_CONN_NUM) {
+    return false;
+  }
+  if ((param = bt_pool_alloc(&s_param_pool)) == NULL) {
+    return false;
+  }
+  memcpy(param, p_params, param_len);
+  atomic_store(&s_coalesce_conn[key], conn);
+
+  /* a message for this key is already on its way; hand it the newer values
+   * and drop the ones it was carrying
+   */
+  if ((queued = atomic_exchange(&s_coalesce_slot[key], param)) != NULL) {
+    bt_pool_free(&s_param_pool, queued);
+    atomic_fetch_add(&s_coalesced, 1);
+    return true;
+  }
+
+  memset(&msg, 0, sizeof(bt_app_msg_t));
+  msg.sig = BT_APP_SIG_WORK_COALESCED;
+  msg.event = event;
+  msg.key = key;
+  msg.cb = p_cback;
+  if (bt_app_send_msg(&msg, lane)) {
+    return true;
+  }
+  /* nothing will collect the slot, so empty it again */
+  if ((queued = atomic_exchange(&s_coalesce_slot[key], NULL)) != NULL) {
+    bt_pool_free(&s_param_pool, queued);
+  }
+  return false;
+}
+
+void *bt_app_str_alloc(size_t len) {
+  return bt_arena_alloc(&s_str_arena, len);
+}
+
+void bt_app_str_free(void *p) {
+  if (p && bt_arena_owns(&s_str_arena, p)) {
+    bt_arena_free(&s_str_arena, p);
+  }
+}
+
+void bt_app_conn_gen_next(bt_app_conn_t conn) {
+  void *queued;
+
+  if (conn >= BT_APP_CONN_NUM) {
+    return;
+  }
+  unsigned mask = CONN_GEN_MASK(conn);
+  unsigned gen = atomic_load(&s_conn_gen);
+  /* wrap within the profile's byte; a carry would age the next profile */
+  while (!atomic_compare_exchange_weak(
+      &s_conn_gen, &gen, (gen & ~mask) | ((gen + CONN_GEN_ONE(conn)) & mask))) {
+  }
+  /* a queued message finds its slot empty, or filled again by the next
+   * connection
+   */
+  for (int key = 0; key < BT_APP_COALESCE_KEYS; key++) {
+    if (atomic_load(&s_coalesce_conn[key]) == conn &&
+        (queued = atomic_exchange(&s_coalesce_slot[key], NULL)) != NULL) {
+      bt_pool_free(&s_param_pool, queued);
+      atomic_fetch_add(&s_stale, 1);
+    }
+  }
+}
+
+bool bt_app_work_stale(bt_app_conn_t conn) {
+  if (!s_work_bulk || conn >= BT_APP_CONN_NUM ||
+      ((s_work_gen ^ atomic_load(&s_conn_gen)) & CONN_GEN_MASK(conn)) == 0) {
+    return false;
+  }
+  if (!s_work_counted) {
+    s_work_counted = true;
+    atomic_fetch_add(&s_stale, 1);
+  }
+  return true;
+}
+
+void bt_app_core_dump_stats(void) {
+  for (int lane = 0; lane < BT_APP_LANE_NUM; lane++) {
+    bt_latency_hist_dump(s_lane_name[lane], &s_lane_latency[lane]);
+    ESP_LOGI(BT_APP_CORE_TAG, "%s: %u dropped", s_lane_name[lane],
+             atomic_load(&s_lane_dropped[lane]));
+  }
+  ESP_LOGI(BT_APP_CORE_TAG, "coalesced events: %u, stale bulk work: %u",
+           atomic_load(&s_coalesced), atomic_load(&s_stale));
+  ESP_LOGI(BT_APP_CORE_TAG,
+           "param pool: %u of %u blocks at peak, %u exhausted",
+           atomic_load(&s_param_pool.high_water), BT_APP_PARAM_BLOCKS,
+           atomic_load(&s_param_pool.exhausted));
+  ESP_LOGI(BT_APP_CORE_TAG,
+           "string arena: %u of %u bytes at peak, %u exhausted",
+           atomic_load(&s_str_arena.high_water), BT_APP_STR_ARENA_SIZE,
+           atomic_load(&s_str_arena.exhausted));
+}
+
 void bt_app_task_start_up(void) {
-  s_bt_app_task_queue = xQueueCreate(10, sizeof(bt_app_msg_t));
+  bt_pool_init(&s_param_pool, s_param_blocks, sizeof(bt_app_param_t),
+               BT_APP_PARAM_BLOCKS);
+  bt_arena_init(&s_str_arena, s_str_storage, BT_APP_STR_ARENA_SIZE);
+  s_bt_app_task_queue[BT_APP_LANE_HIGH] =
+      xQueueCreate(BT_APP_HIGH_QUEUE_LEN, sizeof(bt_app_msg_t));
+  s_bt_app_task_queue[BT_APP_LANE_BULK] =
+      xQueueCreate(BT_APP_BULK_QUEUE_LEN, sizeof(bt_app_msg_t));
+  s_bt_app_task_sem = xSemaphoreCreateCounting(
+      BT_APP_HIGH_QUEUE_LEN + BT_APP_BULK_QUEUE_LEN, 0);
   xTaskCreate(bt_app_task_handler, "BtAppTask", 3072, NULL, 10,
               &s_bt_app_task_handle);
 }
@@ -130,8 +340,14 @@ void bt_app_task_shut_down(void) {
     vTaskDelete(s_bt_app_task_handle);
     s_bt_app_task_handle = NULL;
   }
-  if (s_bt_app_task_queue) {
-    vQueueDelete(s_bt_app_task_queue);
-    s_bt_app_task_queue = NULL;
+  for (int lane = 0; lane < BT_APP_LANE_NUM; lane++) {
+    if (s_bt_app_task_queue[lane]) {
+      vQueueDelete(s_bt_app_task_queue[lane]);
+      s_bt_app_task_queue[lane] = NULL;
+    }
+  }
+  if (s_bt_app_task_sem) {
+    vSemaphoreDelete(s_bt_app_task_sem);
+    s_bt_app_task_sem = NULL;
   }
 }
@@ -16,6 +16,26 @@
 
 /* signal for `bt_app_work_dispatch` */
 #define BT_APP_SIG_WORK_DISPATCH (0x01)
+/* signal for `bt_app_work_coalesce` */
+#define BT_APP_SIG_WORK_COALESCED (0x02)
+
+/* number of coalescing keys */
+#define BT_APP_COALESCE_KEYS 16
+
+/* dispatch lanes; the high lane is always drained first */
+typedef enum {
+  BT_APP_LANE_HIGH = 0, /* connection and stream configuration */
+  BT_APP_LANE_BULK,     /* metadata, notifications and the rest */
+  BT_APP_LANE_NUM,
+} bt_app_lane_t;
+
+/* profiles that connect and disconnect on their own */
+typedef enum {
+  BT_APP_CONN_A2D = 0, /*!< A2DP sink */
+  BT_APP_CONN_RC_CT,   /*!< AVRCP controller */
+  BT_APP_CONN_RC_TG,   /*!< AVRCP target */
+  BT_APP_CONN_NUM,
+} bt_app_conn_t;
 
 /**
  * @brief  handler for the dispatched work
@@ -27,10 +47,13 @@ typedef void (*bt_app_cb_t)(uint16_t event, void *param);
 
 /* message to be sent */
 typedef struct {
-  uint16_t sig;   /*!< signal to bt_app_task */
-  uint16_t event; /*!< message event id */
-  bt_app_cb_t cb; /*!< context switch callback */
-  void *param;    /*!< parameter area needs to be last */
+  uint16_t sig;     /*!< signal to bt_app_task */
+  uint16_t event;   /*!< message event id */
+  uint16_t key;     /*!< coalescing key, BT_APP_SIG_WORK_COALESCED only */
+  bt_app_cb_t cb;   /*!< context switch callback */
+  uint32_t sent_us; /*!< time the message was queued */
+  uint32_t gen;     /*!< connection generations it was queued in */
+  void *param;      /*!< parameter area needs to be last */
 } bt_app_msg_t;
 
 /**
@@ -50,11 +73,83 @@ typedef void (*bt_app_copy_cb_t)(void *p_dest, void *p_src, int len);
  * @param [in] p_params      callback paramters
  * @param [in] param_len     parameter length in byte
  * @param [in] p_copy_cback  parameter deep-copy function
+ * @param [in] lane          queue to dispatch on
+ *
+ * Never blocks, so it is safe to call from stack callbacks; if the lane is
+ * full the work is dropped and counted.
  *
  * @return  true if work dispatch successfully, false otherwise
  */
 bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params,
-                          int param_len, bt_app_copy_cb_t p_copy_cback);
+                          int param_len, bt_app_copy_cb_t p_copy_cback,
+                          bt_app_lane_t lane);
+
+/**
+ * @brief  work dispatcher that keeps only the newest queued event per key
+ *
+ * If work with the same key is still waiting in the queue, its parameters
+ * are replaced by these and no new message is queued, so the handler runs
+ * once with the latest values. Parameters must not need a deep copy.
+ *
+ * @param [in] p_cback    callback function
+ * @param [in] event      event id
+ * @param [in] key        coalescing key, 0..BT_APP_COALESCE_KEYS-1
+ * @param [in] p_params   callback paramters
+ * @param [in] param_len  parameter length in byte
+ * @param [in] lane       queue to dispatch on
+ * @param [in] conn       profile whose disconnect drops the queued values
+ *
+ * @return  true if the work was queued or merged, false otherwise
+ */
+bool bt_app_work_coalesce(bt_app_cb_t p_cback, uint16_t event, uint16_t key,
+                          void *p_params, int param_len, bt_app_lane_t lane,
+                          bt_app_conn_t conn);
+
+/**
+ * @brief  allocate a string referenced by a dispatched parameter
+ *
+ * Strings come from a fixed arena and are reclaimed in allocation order,
+ * so they should be freed soon after the work that uses them has run.
+ *
+ * @param [in] len  length in byte, including any terminator
+ *
+ * @return  the allocation, or NULL if the arena is full
+ */
+void *bt_app_str_alloc(size_t len);
+
+/**
+ * @brief  free a string from `bt_app_str_alloc`; other pointers are ignored
+ */
+void bt_app_str_free(void *p);
+
+/**
+ * @brief  start a new connection generation of one profile
+ *
+ * Call from the stack callback when the profile's connection goes down,
+ * before dispatching the event itself. Bulk work queued until then belongs
+ * to the old connection and is reported stale by `bt_app_work_stale` for
+ * this profile, while the high lane may already have handled the
+ * disconnect. The other profiles' work is not affected.
+ *
+ * @param [in] conn  profile that disconnected
+ */
+void bt_app_conn_gen_next(bt_app_conn_t conn);
+
+/**
+ * @brief  true while handling bulk work queued before the profile's last
+ *         disconnect
+ *
+ * Handlers should then only release what the parameters own and return.
+ * Application task only.
+ *
+ * @param [in] conn  profile the handler serves
+ */
+bool bt_app_work_stale(bt_app_conn_t conn);
+
+/**
+ * @brief  log lane latency and drops, parameter pool and string arena usage
+ */
+void bt_app_core_dump_stats(void);
 
 /**
  * @brief  start up the application task
@@ -0,0 +1,34 @@
+#include "bt_app_delay.h"
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_delay_reset(bt_delay_t *d, uint16_t base, uint32_t pipeline_us) {
+  d->base = base;
+  d->smooth_us = pipeline_us;
+  d->last_report_us = 0;
+  d->reported = bt_delay_value(d);
+}
+
+uint16_t bt_delay_value(const bt_delay_t *d) {
+  uint32_t value = d->base + (d->smooth_us + 50) / 100;
+  return value > UINT16_MAX ? UINT16_MAX : (uint16_t)value;
+}
+
+bool bt_delay_update(bt_delay_t *d, int64_t now_us, uint32_t pipeline_us) {
+  d->smooth_us += ((int32_t)(pipeline_us - d->smooth_us)) / 32;
+
+  uint16_t value = bt_delay_value(d);
+  int32_t moved = (int32_t)value - (int32_t)d->reported;
+
+  if (moved <= BT_DELAY_THRESHOLD && moved >= -BT_DELAY_THRESHOLD) {
+    return false;
+  }
+  if (now_us - d->last_report_us < BT_DELAY_MIN_INTERVAL_US) {
+    return false;
+  }
+  d->reported = value;
+  d->last_report_us = now_us;
+  return true;
+}
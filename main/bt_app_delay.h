@@ -0,0 +1,51 @@
+#ifndef __BT_APP_DELAY_H__
+#define __BT_APP_DELAY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* report again once the delay has moved this far, in 1/10 ms */
+#define BT_DELAY_THRESHOLD 100
+/* never report more often than this */
+#define BT_DELAY_MIN_INTERVAL_US (2 * 1000 * 1000)
+
+/**
+ * A2DP delay report policy.
+ *
+ * The pipeline delay is smoothed over a few dozen packets so that the
+ * sawtooth of packet arrivals does not count as movement, and a new value is
+ * only reported when it differs from the last by more than the threshold
+ * and the last report is old enough.
+ */
+typedef struct {
+  uint16_t base;          /*!< delay of the stack itself, 1/10 ms */
+  uint16_t reported;      /*!< last value reported, 1/10 ms */
+  uint32_t smooth_us;     /*!< smoothed pipeline delay */
+  int64_t last_report_us; /*!< time of the last report */
+} bt_delay_t;
+
+/**
+ * @brief  start over from the stack's delay and an expected pipeline delay
+ *
+ * @param [in] base         delay of the stack itself, 1/10 ms
+ * @param [in] pipeline_us  expected delay of the playback pipeline
+ */
+void bt_delay_reset(bt_delay_t *d, uint16_t base, uint32_t pipeline_us);
+
+/**
+ * @brief  value to report now, 1/10 ms
+ */
+uint16_t bt_delay_value(const bt_delay_t *d);
+
+/**
+ * @brief  feed a pipeline delay measurement
+ *
+ * @param [in] now_us       time of the measurement
+ * @param [in] pipeline_us  delay from ingress to the DAC
+ *
+ * @return  true if bt_delay_value() should be reported; it is then taken as
+ *          reported
+ */
+bool bt_delay_update(bt_delay_t *d, int64_t now_us, uint32_t pipeline_us);
+
+#endif /* __BT_APP_DELAY_H__ */
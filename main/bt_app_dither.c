@@ -0,0 +1,55 @@
+#include "bt_app_dither.h"
+
+/* bits dropped going from 16 to 8 */
+#define DITHER_SHIFT_U8 8
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* triangular noise of +-1 LSB after a shift by `shift` bits */
+static inline int32_t bt_dither_tpdf(bt_dither_t *d, int shift);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static inline int32_t bt_dither_tpdf(bt_dither_t *d, int shift) {
+  /* one step of a 32-bit LCG gives two uniform values in its top bits */
+  d->seed = d->seed * 1664525u + 1013904223u;
+  int32_t a = (int32_t)(d->seed >> (32 - shift));
+  int32_t b = (int32_t)(d->seed >> (16 - shift) & ((1u << shift) - 1));
+  return a - b;
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_dither_reset(bt_dither_t *d) {
+  d->seed = 0x12345678;
+  d->err[0] = 0;
+  d->err[1] = 0;
+}
+
+void bt_dither_to_u8(bt_dither_t *d, const int16_t *in, uint8_t *out,
+                     size_t frames, uint8_t ch) {
+  const int32_t half = 1 << (DITHER_SHIFT_U8 - 1);
+
+  /* out[i] never lies above in[i], so a forward pass converts in place */
+  for (size_t i = 0; i < frames * ch; i++) {
+    int32_t *err = &d->err[ch == 2 ? i & 1 : 0];
+    int32_t want = in[i] - *err;
+    int32_t q = (want + bt_dither_tpdf(d, DITHER_SHIFT_U8) + half) >>
+                DITHER_SHIFT_U8;
+    if (q > 127) {
+      q = 127;
+    } else if (q < -128) {
+      q = -128;
+    }
+    /* clamp the feedback too, so a clipped peak can't wind it up */
+    int32_t e = q * (1 << DITHER_SHIFT_U8) - want;
+    *err = e > 2 * half ? 2 * half : e < -2 * half ? -2 * half : e;
+    out[i] = (uint8_t)(q + 128);
+  }
+}
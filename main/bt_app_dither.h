@@ -0,0 +1,38 @@
+#ifndef __BT_APP_DITHER_H__
+#define __BT_APP_DITHER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Word length reduction with noise-shaped dither.
+ *
+ * Each sample gets triangular dither of one output LSB before it is
+ * rounded, and the rounding error of the previous sample of the same
+ * channel is subtracted first. That first-order error feedback pushes the
+ * requantisation noise towards high frequencies, where it is least
+ * audible, instead of leaving it as distortion that follows the signal.
+ */
+typedef struct {
+  uint32_t seed;   /*!< dither noise generator state */
+  int32_t err[2];  /*!< last rounding error, per channel */
+} bt_dither_t;
+
+/**
+ * @brief  start over with no error history
+ */
+void bt_dither_reset(bt_dither_t *d);
+
+/**
+ * @brief  reduce interleaved 16-bit PCM to unsigned 8-bit, as taken by the
+ *         internal DAC
+ *
+ * @param [in]  in      samples
+ * @param [out] out     one byte per sample; may be the same memory as `in`
+ * @param [in]  frames  frames to convert
+ * @param [in]  ch      channels, 1 or 2
+ */
+void bt_dither_to_u8(bt_dither_t *d, const int16_t *in, uint8_t *out,
+                     size_t frames, uint8_t ch);
+
+#endif /* __BT_APP_DITHER_H__ */
@@ -0,0 +1,43 @@
+#include "bt_app_drain.h"
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+size_t bt_drain_compress(int16_t *dst, const int16_t *src, size_t frames,
+                         size_t ch, size_t drop) {
+  size_t out = 0;
+  size_t done = 0;
+  size_t step;
+  size_t next;
+
+  if (drop == 0 || frames < 2) {
+    drop = 0;
+  } else if (drop > frames / 2) {
+    drop = frames / 2;
+  }
+  step = drop ? frames / drop : frames;
+  next = step / 2;
+
+  for (size_t i = 0; i < frames; i++) {
+    const int16_t *f = src + i * ch;
+    int16_t *o = dst + out * ch;
+
+    if (done < drop && i == next && i + 1 < frames) {
+      /* fold this frame and the next one into their average */
+      for (size_t c = 0; c < ch; c++) {
+        o[c] = (int16_t)(((int32_t)f[c] + f[c + ch]) >> 1);
+      }
+      i++;
+      done++;
+      next = step / 2 + done * step;
+    } else {
+      for (size_t c = 0; c < ch; c++) {
+        o[c] = f[c];
+      }
+    }
+    out++;
+  }
+
+  return out;
+}
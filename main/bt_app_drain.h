@@ -0,0 +1,38 @@
+#ifndef __BT_APP_DRAIN_H__
+#define __BT_APP_DRAIN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* at most one frame in this many is removed while draining */
+#define BT_DRAIN_RATIO 100
+
+/**
+ * @brief  number of frames that may be removed from a packet
+ *
+ * @param [in] frames         frames in the packet
+ * @param [in] excess_frames  frames buffered above the target level
+ */
+static inline size_t bt_drain_budget(size_t frames, size_t excess_frames) {
+  size_t budget = frames / BT_DRAIN_RATIO;
+  return budget < excess_frames ? budget : excess_frames;
+}
+
+/**
+ * @brief  copy interleaved 16-bit PCM while removing frames evenly
+ *
+ * Each removed frame is blended into its neighbour instead of being cut
+ * out, so the compression is spread over the packet and leaves no step.
+ *
+ * @param [out] dst     destination, room for `frames` frames
+ * @param [in]  src     source frames
+ * @param [in]  frames  number of source frames
+ * @param [in]  ch      channels per frame
+ * @param [in]  drop    number of frames to remove
+ *
+ * @return  number of frames written to dst
+ */
+size_t bt_drain_compress(int16_t *dst, const int16_t *src, size_t frames,
+                         size_t ch, size_t drop);
+
+#endif /* __BT_APP_DRAIN_H__ */
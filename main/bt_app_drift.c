@@ -0,0 +1,73 @@
+#include "bt_app_drift.h"
+
+#include <string.h>
+
+/* snapshot period */
+#define DRIFT_PERIOD_US (1000 * 1000)
+/* ppm of correction per millisecond of fill error */
+#define DRIFT_FILL_GAIN_PPM_PER_MS 50
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_drift_reset(bt_drift_t *d) { memset(d, 0, sizeof(*d)); }
+
+void bt_drift_fill_up(bt_drift_t *d) { d->filling = true; }
+
+bool bt_drift_update(bt_drift_t *d, int64_t now_us, uint32_t in_total,
+                     uint32_t out_total, int32_t fill_err_us) {
+  /* fill level saws up and down with every packet, so smooth it heavily */
+  d->fill_err_us += (fill_err_us - d->fill_err_us) / 64;
+
+  if (d->next_snap_us == 0) {
+    d->next_snap_us = now_us;
+  }
+  if (now_us < d->next_snap_us) {
+    return false;
+  }
+  d->next_snap_us += DRIFT_PERIOD_US;
+
+  /* compare against the oldest snapshot still in the window */
+  uint8_t oldest = d->snap_count < BT_DRIFT_WINDOWS ? 0 : d->snap_idx;
+  if (d->snap_count >= 2) {
+    uint32_t in = in_total - d->snap_in[oldest];
+    uint32_t out = out_total - d->snap_out[oldest];
+    if (out > 0) {
+      int64_t ppm = ((int64_t)in - out) * 1000000 / out;
+      if (ppm > BT_DRIFT_LIMIT_PPM) {
+        ppm = BT_DRIFT_LIMIT_PPM;
+      } else if (ppm < -BT_DRIFT_LIMIT_PPM) {
+        ppm = -BT_DRIFT_LIMIT_PPM;
+      }
+      d->drift_ppm += ((int32_t)ppm - d->drift_ppm) / 4;
+    }
+  }
+  d->snap_in[d->snap_idx] = in_total;
+  d->snap_out[d->snap_idx] = out_total;
+  d->snap_idx = (d->snap_idx + 1) % BT_DRIFT_WINDOWS;
+  if (d->snap_count < BT_DRIFT_WINDOWS) {
+    d->snap_count++;
+  }
+
+  int32_t ratio =
+      d->drift_ppm + d->fill_err_us * DRIFT_FILL_GAIN_PPM_PER_MS / 1000;
+  if (d->filling) {
+    if (fill_err_us >= 0) {
+      /* the proportional term takes it from here */
+      d->filling = false;
+    } else {
+      ratio = d->drift_ppm - BT_DRIFT_LIMIT_PPM;
+    }
+  }
+  if (ratio > BT_DRIFT_LIMIT_PPM) {
+    ratio = BT_DRIFT_LIMIT_PPM;
+  } else if (ratio < -BT_DRIFT_LIMIT_PPM) {
+    ratio = -BT_DRIFT_LIMIT_PPM;
+  }
+  if (ratio == d->ratio_ppm) {
+    return false;
+  }
+  d->ratio_ppm = ratio;
+  return true;
+}
@@ -0,0 +1,58 @@
+#ifndef __BT_APP_DRIFT_H__
+#define __BT_APP_DRIFT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* number of one-second snapshots the rate estimate spans */
+#define BT_DRIFT_WINDOWS 32
+/* largest correction ever applied, in ppm */
+#define BT_DRIFT_LIMIT_PPM 2000
+
+/**
+ * Source/sink clock drift estimator.
+ *
+ * Once a second the totals of bytes arriving from the source and bytes
+ * rendered at the I2S clock are snapshotted. Their ratio over the last
+ * BT_DRIFT_WINDOWS seconds gives the rate offset between the two clocks.
+ * A proportional term on the filtered fill error is added on top, so that
+ * the fill returns to its target instead of holding wherever it was left.
+ * After a start below the target the full correction is applied until the
+ * fill first reaches it, growing the buffer by playing slightly slow.
+ */
+typedef struct {
+  uint32_t snap_in[BT_DRIFT_WINDOWS];  /*!< bytes in at each snapshot */
+  uint32_t snap_out[BT_DRIFT_WINDOWS]; /*!< bytes out at each snapshot */
+  uint8_t snap_idx;                    /*!< next snapshot slot */
+  uint8_t snap_count;                  /*!< valid snapshots */
+  int64_t next_snap_us;                /*!< time of the next snapshot */
+  int32_t drift_ppm;                   /*!< smoothed rate offset */
+  int32_t fill_err_us;                 /*!< smoothed fill error */
+  int32_t ratio_ppm;                   /*!< correction to apply */
+  bool filling;                        /*!< growing towards the target */
+} bt_drift_t;
+
+/**
+ * @brief  forget all history, e.g. at the start of a stream
+ */
+void bt_drift_reset(bt_drift_t *d);
+
+/**
+ * @brief  playback (re)started, possibly below the target fill
+ */
+void bt_drift_fill_up(bt_drift_t *d);
+
+/**
+ * @brief  feed the current totals and fill error (consumer only)
+ *
+ * @param [in] now_us       current time
+ * @param [in] in_total     running total of bytes accepted from the source
+ * @param [in] out_total    running total of bytes rendered to I2S
+ * @param [in] fill_err_us  fill level minus target, in microseconds
+ *
+ * @return  true if ratio_ppm changed
+ */
+bool bt_drift_update(bt_drift_t *d, int64_t now_us, uint32_t in_total,
+                     uint32_t out_total, int32_t fill_err_us);
+
+#endif /* __BT_APP_DRIFT_H__ */
@@ -0,0 +1,91 @@
+#include "bt_app_dsp.h"
+
+#include <string.h>
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_dsp_init(bt_dsp_chain_t *c, bt_dsp_clock_t clock) {
+  memset(c, 0, sizeof(*c));
+  c->clock = clock;
+}
+
+int bt_dsp_add(bt_dsp_chain_t *c, const char *name, bt_dsp_process_t process,
+               bt_dsp_setup_t setup, void *ctx) {
+  if (c->count >= BT_DSP_MAX_STAGES) {
+    return -1;
+  }
+  bt_dsp_stage_t *s = &c->stage[c->count];
+  s->name = name;
+  s->process = process;
+  s->setup = setup;
+  s->ctx = ctx;
+  atomic_init(&s->active, true);
+  atomic_init(&s->bypass, false);
+  memset(&s->stats, 0, sizeof(s->stats));
+  atomic_init(&s->seq, 0);
+  return c->count++;
+}
+
+void bt_dsp_configure(bt_dsp_chain_t *c, uint32_t sample_rate, uint8_t ch) {
+  for (uint8_t i = 0; i < c->count; i++) {
+    bt_dsp_stage_t *s = &c->stage[i];
+    atomic_store(&s->active,
+                 s->setup == NULL || s->setup(s->ctx, sample_rate, ch));
+  }
+}
+
+bool bt_dsp_bypass(bt_dsp_chain_t *c, uint8_t idx, bool bypass) {
+  if (idx >= c->count) {
+    return false;
+  }
+  atomic_store(&c->stage[idx].bypass, bypass);
+  return true;
+}
+
+void bt_dsp_run(bt_dsp_chain_t *c, void *buf, size_t frames, uint8_t ch) {
+  for (uint8_t i = 0; i < c->count; i++) {
+    bt_dsp_stage_t *s = &c->stage[i];
+    /* the flags only gate whole blocks; nothing else hangs off them */
+    if (!atomic_load_explicit(&s->active, memory_order_relaxed) ||
+        atomic_load_explicit(&s->bypass, memory_order_relaxed)) {
+      continue;
+    }
+    uint32_t start = c->clock();
+    s->process(s->ctx, buf, frames, ch);
+    uint32_t cycles = c->clock() - start;
+    /* only this task writes, so the count can be bumped without a RMW */
+    unsigned seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    s->stats.calls++;
+    s->stats.cycles += cycles;
+    if (cycles > s->stats.peak) {
+      s->stats.peak = cycles;
+    }
+    atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+  }
+}
+
+bool bt_dsp_stats(bt_dsp_chain_t *c, uint8_t idx, bt_dsp_stats_t *stats) {
+  if (idx >= c->count) {
+    return false;
+  }
+  bt_dsp_stage_t *s = &c->stage[idx];
+  unsigned seq;
+  do {
+    /* retry while a block is being counted, or if one was meanwhile */
+    seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+    *stats = s->stats;
+    atomic_thread_fence(memory_order_acquire);
+  } while ((seq & 1) ||
+           seq != atomic_load_explicit(&s->seq, memory_order_relaxed));
+  return true;
+}
+
+void bt_dsp_stats_reset(bt_dsp_chain_t *c) {
+  for (uint8_t i = 0; i < c->count; i++) {
+    memset(&c->stage[i].stats, 0, sizeof(c->stage[i].stats));
+  }
+}
@@ -0,0 +1,116 @@
+#ifndef __BT_APP_DSP_H__
+#define __BT_APP_DSP_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* most stages a chain holds */
+#define BT_DSP_MAX_STAGES 6
+
+/**
+ * @brief  process interleaved frames in place
+ *
+ * @param [in] ctx     the stage's own state
+ * @param [in] buf     samples, in the format the chain was built for
+ * @param [in] frames  frames in the block
+ * @param [in] ch      channels, 1 or 2
+ */
+typedef void (*bt_dsp_process_t)(void *ctx, void *buf, size_t frames,
+                                 uint8_t ch);
+
+/**
+ * @brief  prepare for a new stream format
+ *
+ * @return  false if the stage has nothing to do at this format
+ */
+typedef bool (*bt_dsp_setup_t)(void *ctx, uint32_t sample_rate, uint8_t ch);
+
+/* free-running cycle counter */
+typedef uint32_t (*bt_dsp_clock_t)(void);
+
+/* cost of a stage since the stats were reset */
+typedef struct {
+  uint32_t calls;  /*!< blocks processed */
+  uint64_t cycles; /*!< cycles spent in them */
+  uint32_t peak;   /*!< worst block */
+} bt_dsp_stats_t;
+
+typedef struct {
+  const char *name;
+  bt_dsp_process_t process;
+  bt_dsp_setup_t setup; /*!< NULL if any format will do */
+  void *ctx;
+  atomic_bool active;   /*!< the stage applies to the stream format */
+  atomic_bool bypass;   /*!< skipped on request */
+  bt_dsp_stats_t stats; /*!< written by the task running the chain */
+  atomic_uint seq;      /*!< odd while the stats are being written */
+} bt_dsp_stage_t;
+
+/**
+ * Chain of in-place DSP stages.
+ *
+ * Every stage works on the same block of interleaved frames, one after the
+ * other, so a block is processed without copies wherever it lives, the DMA
+ * buffer included. The stages are added once; each new stream format only
+ * sets them up again, and those that have nothing to do at it drop out.
+ * Any task may bypass a stage while another runs the chain: a stage is
+ * skipped or not as a whole block. The clock times each stage, for a
+ * per-stage budget; the stats are published under a sequence count, so
+ * that any task can read them whole.
+ */
+typedef struct {
+  bt_dsp_stage_t stage[BT_DSP_MAX_STAGES];
+  uint8_t count;
+  bt_dsp_clock_t clock;
+} bt_dsp_chain_t;
+
+/**
+ * @brief  start an empty chain
+ *
+ * @param [in] clock  cycle counter to time the stages with
+ */
+void bt_dsp_init(bt_dsp_chain_t *c, bt_dsp_clock_t clock);
+
+/**
+ * @brief  append a stage; before the chain first runs
+ *
+ * @param [in] setup  may be NULL
+ *
+ * @return  index of the stage, -1 if the chain is full
+ */
+int bt_dsp_add(bt_dsp_chain_t *c, const char *name, bt_dsp_process_t process,
+               bt_dsp_setup_t setup, void *ctx);
+
+/**
+ * @brief  set up every stage for a new stream format; may run alongside the
+ *         chain
+ */
+void bt_dsp_configure(bt_dsp_chain_t *c, uint32_t sample_rate, uint8_t ch);
+
+/**
+ * @brief  skip a stage, or stop skipping it; from any task
+ *
+ * @return  false if there is no such stage
+ */
+bool bt_dsp_bypass(bt_dsp_chain_t *c, uint8_t idx, bool bypass);
+
+/**
+ * @brief  run a block through the active stages
+ */
+void bt_dsp_run(bt_dsp_chain_t *c, void *buf, size_t frames, uint8_t ch);
+
+/**
+ * @brief  copy the stats of a stage; from any task, while the chain runs
+ *
+ * @return  false if there is no such stage
+ */
+bool bt_dsp_stats(bt_dsp_chain_t *c, uint8_t idx, bt_dsp_stats_t *stats);
+
+/**
+ * @brief  clear the stage stats; not while the chain runs
+ */
+void bt_dsp_stats_reset(bt_dsp_chain_t *c);
+
+#endif /* __BT_APP_DSP_H__ */
@@ -0,0 +1,216 @@
+#include "bt_app_eq.h"
+
+#include <math.h>
+#include <string.h>
+
+/* coefficient fraction bits */
+#define EQ_COEF_SHIFT 29
+/* marks the middle bank as not yet seen by the audio task */
+#define EQ_FRESH 0x4
+/* clip level of 32-bit samples; keeps the accumulator sums within 64 bits */
+#define EQ_WIDE_MAX ((1 << 30) - 1)
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* RBJ cookbook design of one band */
+static bool bt_eq_design(const bt_eq_band_t *band, uint32_t sample_rate,
+                         bt_eq_coef_t *coef);
+/* recompute the back bank and hand it to the audio task */
+static void bt_eq_publish(bt_eq_t *eq);
+/* take up freshly published coefficients (audio task) */
+static const bt_eq_bank_t *bt_eq_front(bt_eq_t *eq, uint8_t *ch);
+/* one sample through one band, clipped to +-max */
+static inline int32_t bt_eq_biquad(const bt_eq_coef_t *k, bt_eq_state_t *st,
+                                   int32_t x0, int32_t max);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static bool bt_eq_design(const bt_eq_band_t *band, uint32_t sample_rate,
+                         bt_eq_coef_t *coef) {
+  if (band->type == BT_EQ_OFF || sample_rate == 0 || band->q <= 0.0f ||
+      band->freq_hz <= 0.0f || band->freq_hz >= sample_rate / 2.0f) {
+    return false;
+  }
+
+  float w0 = 2.0f * (float)M_PI * band->freq_hz / sample_rate;
+  float cw = cosf(w0);
+  float alpha = sinf(w0) / (2.0f * band->q);
+  float a = powf(10.0f, band->gain_db / 40.0f);
+  float sa = 2.0f * sqrtf(a) * alpha;
+  float b0, b1, b2, a0, a1, a2;
+
+  switch (band->type) {
+    case BT_EQ_PEAK:
+      b0 = 1.0f + alpha * a;
+      b1 = -2.0f * cw;
+      b2 = 1.0f - alpha * a;
+      a0 = 1.0f + alpha / a;
+      a1 = -2.0f * cw;
+      a2 = 1.0f - alpha / a;
+      break;
+    case BT_EQ_LOW_SHELF:
+      b0 = a * ((a + 1.0f) - (a - 1.0f) * cw + sa);
+      b1 = 2.0f * a * ((a - 1.0f) - (a + 1.0f) * cw);
+      b2 = a * ((a + 1.0f) - (a - 1.0f) * cw - sa);
+      a0 = (a + 1.0f) + (a - 1.0f) * cw + sa;
+      a1 = -2.0f * ((a - 1.0f) + (a + 1.0f) * cw);
+      a2 = (a + 1.0f) + (a - 1.0f) * cw - sa;
+      break;
+    case BT_EQ_HIGH_SHELF:
+      b0 = a * ((a + 1.0f) + (a - 1.0f) * cw + sa);
+      b1 = -2.0f * a * ((a - 1.0f) + (a + 1.0f) * cw);
+      b2 = a * ((a + 1.0f) + (a - 1.0f) * cw - sa);
+      a0 = (a + 1.0f) - (a - 1.0f) * cw + sa;
+      a1 = 2.0f * ((a - 1.0f) - (a + 1.0f) * cw);
+      a2 = (a + 1.0f) - (a - 1.0f) * cw - sa;
+      break;
+    case BT_EQ_LOW_PASS:
+      b0 = (1.0f - cw) / 2.0f;
+      b1 = 1.0f - cw;
+      b2 = (1.0f - cw) / 2.0f;
+      a0 = 1.0f + alpha;
+      a1 = -2.0f * cw;
+      a2 = 1.0f - alpha;
+      break;
+    case BT_EQ_HIGH_PASS:
+      b0 = (1.0f + cw) / 2.0f;
+      b1 = -(1.0f + cw);
+      b2 = (1.0f + cw) / 2.0f;
+      a0 = 1.0f + alpha;
+      a1 = -2.0f * cw;
+      a2 = 1.0f - alpha;
+      break;
+    default:
+      return false;
+  }
+
+  /* |coefficient| < 4 for any sane band, which Q2.29 holds */
+  const float scale = (float)(1 << EQ_COEF_SHIFT) / a0;
+  coef->b0 = (int32_t)lrintf(b0 * scale);
+  coef->b1 = (int32_t)lrintf(b1 * scale);
+  coef->b2 = (int32_t)lrintf(b2 * scale);
+  coef->a1 = (int32_t)lrintf(a1 * scale);
+  coef->a2 = (int32_t)lrintf(a2 * scale);
+  return true;
+}
+
+static void bt_eq_publish(bt_eq_t *eq) {
+  bt_eq_bank_t *bank = &eq->banks[eq->back];
+
+  bank->count = 0;
+  bank->sample_rate = eq->sample_rate;
+  for (uint8_t i = 0; i < BT_EQ_MAX_BANDS; i++) {
+    if (bt_eq_design(&eq->bands[i], eq->sample_rate, &bank->coef[i])) {
+      bank->map[bank->count++] = i;
+    }
+  }
+
+  /* swap the finished bank in; whatever was in the middle becomes ours */
+  eq->back = atomic_exchange(&eq->middle, eq->back | EQ_FRESH) & ~EQ_FRESH;
+}
+
+static const bt_eq_bank_t *bt_eq_front(bt_eq_t *eq, uint8_t *ch) {
+  if (atomic_load(&eq->middle) & EQ_FRESH) {
+    uint32_t rate = eq->banks[eq->front].sample_rate;
+    eq->front = atomic_exchange(&eq->middle, eq->front) & ~EQ_FRESH;
+    if (eq->banks[eq->front].sample_rate != rate) {
+      memset(eq->state, 0, sizeof(eq->state));
+    }
+  }
+  if (*ch > BT_EQ_MAX_CH) {
+    *ch = BT_EQ_MAX_CH;
+  }
+  return &eq->banks[eq->front];
+}
+
+static inline int32_t bt_eq_biquad(const bt_eq_coef_t *k, bt_eq_state_t *st,
+                                   int32_t x0, int32_t max) {
+  /* error feedback keeps the truncation noise out of the low end */
+  int64_t acc = (int64_t)st->err + (int64_t)k->b0 * x0 +
+                (int64_t)k->b1 * st->x1 + (int64_t)k->b2 * st->x2 -
+                (int64_t)k->a1 * st->y1 - (int64_t)k->a2 * st->y2;
+  int64_t y0 = acc >> EQ_COEF_SHIFT;
+
+  st->err = (int32_t)(acc & ((1 << EQ_COEF_SHIFT) - 1));
+  if (y0 > max) {
+    y0 = max;
+  } else if (y0 < -max - 1) {
+    y0 = -max - 1;
+  }
+  st->x2 = st->x1;
+  st->x1 = x0;
+  st->y2 = st->y1;
+  st->y1 = (int32_t)y0;
+  return (int32_t)y0;
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_eq_init(bt_eq_t *eq, uint32_t sample_rate) {
+  memset(eq, 0, sizeof(*eq));
+  eq->sample_rate = sample_rate;
+  eq->front = 0;
+  atomic_store(&eq->middle, 1);
+  eq->back = 2;
+}
+
+bool bt_eq_set_band(bt_eq_t *eq, uint8_t idx, const bt_eq_band_t *band) {
+  if (idx >= BT_EQ_MAX_BANDS || band == NULL) {
+    return false;
+  }
+  eq->bands[idx] = *band;
+  bt_eq_publish(eq);
+  return true;
+}
+
+void bt_eq_set_sample_rate(bt_eq_t *eq, uint32_t sample_rate) {
+  if (sample_rate == eq->sample_rate) {
+    return;
+  }
+  eq->sample_rate = sample_rate;
+  bt_eq_publish(eq);
+}
+
+void bt_eq_process(bt_eq_t *eq, int16_t *buf, size_t frames, uint8_t ch) {
+  const bt_eq_bank_t *bank = bt_eq_front(eq, &ch);
+
+  for (uint8_t s = 0; s < bank->count; s++) {
+    const uint8_t band = bank->map[s];
+    const bt_eq_coef_t *k = &bank->coef[band];
+
+    for (uint8_t c = 0; c < ch; c++) {
+      bt_eq_state_t st = eq->state[c][band];
+      int16_t *p = buf + c;
+
+      for (size_t i = 0; i < frames; i++, p += ch) {
+        *p = (int16_t)bt_eq_biquad(k, &st, *p, INT16_MAX);
+      }
+      eq->state[c][band] = st;
+    }
+  }
+}
+
+void bt_eq_process32(bt_eq_t *eq, int32_t *buf, size_t frames, uint8_t ch) {
+  const bt_eq_bank_t *bank = bt_eq_front(eq, &ch);
+
+  for (uint8_t s = 0; s < bank->count; s++) {
+    const uint8_t band = bank->map[s];
+    const bt_eq_coef_t *k = &bank->coef[band];
+
+    for (uint8_t c = 0; c < ch; c++) {
+      bt_eq_state_t st = eq->state[c][band];
+      int32_t *p = buf + c;
+
+      for (size_t i = 0; i < frames; i++, p += ch) {
+        *p = bt_eq_biquad(k, &st, *p, EQ_WIDE_MAX);
+      }
+      eq->state[c][band] = st;
+    }
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef __BT_APP_EQ_H__
+#define __BT_APP_EQ_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* biquad sections per channel */
+#define BT_EQ_MAX_BANDS 8
+/* channels with their own filter state */
+#define BT_EQ_MAX_CH 2
+
+/* band filter shapes */
+typedef enum {
+  BT_EQ_OFF = 0,    /* band bypassed */
+  BT_EQ_PEAK,       /* peaking bell */
+  BT_EQ_LOW_SHELF,  /* low shelf */
+  BT_EQ_HIGH_SHELF, /* high shelf */
+  BT_EQ_LOW_PASS,   /* 2nd order low pass, gain ignored */
+  BT_EQ_HIGH_PASS,  /* 2nd order high pass, gain ignored */
+} bt_eq_type_t;
+
+/* one band as set by the user */
+typedef struct {
+  bt_eq_type_t type; /*!< filter shape */
+  float freq_hz;     /*!< centre or corner frequency */
+  float q;           /*!< quality factor, or shelf slope */
+  float gain_db;     /*!< boost or cut */
+} bt_eq_band_t;
+
+/* Q2.29 direct form I coefficients, a0 normalised to 1 */
+typedef struct {
+  int32_t b0, b1, b2, a1, a2;
+} bt_eq_coef_t;
+
+/* coefficients for all bands, and which ones run */
+typedef struct {
+  bt_eq_coef_t coef[BT_EQ_MAX_BANDS];
+  uint8_t map[BT_EQ_MAX_BANDS]; /*!< indices of active bands */
+  uint8_t count;                /*!< number of active bands */
+  uint32_t sample_rate;         /*!< rate the coefficients are for */
+} bt_eq_bank_t;
+
+/* per channel, per band history */
+typedef struct {
+  int32_t x1, x2, y1, y2;
+  int32_t err; /*!< truncation error fed back into the next sample */
+} bt_eq_state_t;
+
+/**
+ * Parametric EQ of cascaded biquads.
+ *
+ * Coefficient banks are triple-buffered: the control side fills a private
+ * back bank and swaps it into the shared middle slot, and the audio task
+ * swaps middle into its front bank at the start of a block when it is
+ * marked fresh. Neither side ever waits for the other. The control side
+ * has the one back bank, so its calls must not overlap; a caller on more
+ * than one task serialises them. A bank for a new sample rate also clears
+ * the filter history, which would ring at the wrong frequencies.
+ */
+typedef struct {
+  /* control side */
+  bt_eq_band_t bands[BT_EQ_MAX_BANDS];
+  uint32_t sample_rate;
+  uint8_t back;
+  /* shared */
+  atomic_uint middle; /*!< bank index, BT_EQ_FRESH set when newly written */
+  /* audio side */
+  uint8_t front;
+  bt_eq_state_t state[BT_EQ_MAX_CH][BT_EQ_MAX_BANDS];
+  bt_eq_bank_t banks[3];
+} bt_eq_t;
+
+/**
+ * @brief  initialise with all bands off
+ */
+void bt_eq_init(bt_eq_t *eq, uint32_t sample_rate);
+
+/**
+ * @brief  change one band and publish new coefficients (control side)
+ *
+ * @return  false if the band index is out of range
+ */
+bool bt_eq_set_band(bt_eq_t *eq, uint8_t idx, const bt_eq_band_t *band);
+
+/**
+ * @brief  recompute all coefficients for a new sample rate (control side)
+ */
+void bt_eq_set_sample_rate(bt_eq_t *eq, uint32_t sample_rate);
+
+/**
+ * @brief  filter interleaved 16-bit PCM in place (audio task)
+ *
+ * @param [in,out] buf     samples
+ * @param [in]     frames  number of frames
+ * @param [in]     ch      channels per frame
+ */
+void bt_eq_process(bt_eq_t *eq, int16_t *buf, size_t frames, uint8_t ch);
+
+/**
+ * @brief  filter interleaved 32-bit samples with headroom in place, keeping
+ *         the bits below the 16-bit LSB (audio task)
+ *
+ * @param [in,out] buf     samples in the bt_app_pcm processing format
+ * @param [in]     frames  number of frames
+ * @param [in]     ch      channels per frame
+ */
+void bt_eq_process32(bt_eq_t *eq, int32_t *buf, size_t frames, uint8_t ch);
+
+#endif /* __BT_APP_EQ_H__ */
@@ -0,0 +1,132 @@
+#include "bt_app_gain.h"
+
+/**
+ * Q15 gain for each AVRCP volume step. This is the taper of a linear
+ * potentiometer loaded by 5% of its track resistance (see
+ * LogPotentiometer.ods): about -43 dB at the first step, -22 dB at half
+ * travel and unity at full scale.
+ */
+static const uint16_t s_vol_taper[BT_GAIN_VOLUME_MAX + 1] = {
+        0,   223,   394,   530,   641,   735,   815,   885,
+      947,  1002,  1053,  1099,  1142,  1182,  1220,  1255,
+     1289,  1322,  1353,  1383,  1412,  1441,  1469,  1496,
+     1523,  1550,  1576,  1602,  1628,  1654,  1680,  1705,
+     1731,  1757,  1783,  1809,  1835,  1861,  1888,  1915,
+     1942,  1969,  1997,  2025,  2053,  2082,  2112,  2142,
+     2172,  2203,  2234,  2266,  2299,  2332,  2366,  2401,
+     2436,  2473,  2510,  2548,  2587,  2627,  2667,  2709,
+     2752,  2796,  2842,  2888,  2936,  2986,  3037,  3089,
+     3143,  3199,  3256,  3316,  3377,  3441,  3507,  3575,
+     3645,  3719,  3795,  3874,  3956,  4041,  4130,  4223,
+     4320,  4421,  4527,  4638,  4754,  4876,  5004,  5139,
+     5281,  5431,  5589,  5757,  5934,  6123,  6323,  6537,
+     6766,  7011,  7273,  7556,  7862,  8192,  8552,  8944,
+     9373,  9844, 10365, 10944, 11591, 12318, 13141, 14081,
+    15165, 16429, 17922, 19711, 21894, 24620, 28117, 32768,
+};
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* scale both halves of a packed pair of samples */
+static inline uint32_t bt_gain_pair(uint32_t pair, int32_t gain);
+/* scale one wide sample */
+static inline int32_t bt_gain_wide(int32_t sample, int32_t gain);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static inline uint32_t bt_gain_pair(uint32_t pair, int32_t gain) {
+  /* gain never exceeds unity, so neither half can overflow */
+  int32_t lo = ((int32_t)(int16_t)pair * gain) >> 15;
+  int32_t hi = (((int32_t)pair >> 16) * gain) >> 15;
+  return ((uint32_t)lo & 0xffff) | ((uint32_t)hi << 16);
+}
+
+static inline int32_t bt_gain_wide(int32_t sample, int32_t gain) {
+  return (int32_t)(((int64_t)sample * gain) >> 15);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_gain_init(bt_gain_t *g, uint8_t volume) {
+  if (volume > BT_GAIN_VOLUME_MAX) {
+    volume = BT_GAIN_VOLUME_MAX;
+  }
+  atomic_store(&g->target, s_vol_taper[volume]);
+  g->current = s_vol_taper[volume];
+}
+
+void bt_gain_set_volume(bt_gain_t *g, uint8_t volume) {
+  if (volume > BT_GAIN_VOLUME_MAX) {
+    volume = BT_GAIN_VOLUME_MAX;
+  }
+  atomic_store(&g->target, s_vol_taper[volume]);
+}
+
+void bt_gain_process(bt_gain_t *g, int16_t *buf, size_t samples) {
+  uint32_t *pairs = (uint32_t *)buf;
+  size_t n = samples / 2;
+  int32_t target = (int32_t)atomic_load(&g->target);
+  int32_t gain = (int32_t)g->current;
+
+  if (target == gain) {
+    if (gain == BT_GAIN_UNITY) {
+      return;
+    }
+    for (size_t i = 0; i < n; i++) {
+      pairs[i] = bt_gain_pair(pairs[i], gain);
+    }
+  } else if (n > 0) {
+    /* ramp in Q15.16 so that small changes still move every pair; unity is
+     * 2^31 there, hence the 64-bit accumulator
+     */
+    int64_t acc = (int64_t)gain * 65536;
+    int64_t step = (int64_t)(target - gain) * 65536 / (int64_t)n;
+    for (size_t i = 0; i < n; i++) {
+      acc += step;
+      pairs[i] = bt_gain_pair(pairs[i], (int32_t)(acc >> 16));
+    }
+    gain = target;
+  }
+
+  if (samples & 1) {
+    buf[samples - 1] = (int16_t)((buf[samples - 1] * gain) >> 15);
+  }
+  g->current = (uint32_t)gain;
+}
+
+void bt_gain_process32(bt_gain_t *g, int32_t *buf, size_t samples) {
+  size_t n = samples / 2;
+  int32_t target = (int32_t)atomic_load(&g->target);
+  int32_t gain = (int32_t)g->current;
+
+  if (target == gain) {
+    if (gain == BT_GAIN_UNITY) {
+      return;
+    }
+    for (size_t i = 0; i < n * 2; i++) {
+      buf[i] = bt_gain_wide(buf[i], gain);
+    }
+  } else if (n > 0) {
+    /* same ramp as the 16-bit stage, one step per pair of samples */
+    int64_t acc = (int64_t)gain * 65536;
+    int64_t step = (int64_t)(target - gain) * 65536 / (int64_t)n;
+    for (size_t i = 0; i < n; i++) {
+      acc += step;
+      int32_t k = (int32_t)(acc >> 16);
+      buf[2 * i] = bt_gain_wide(buf[2 * i], k);
+      buf[2 * i + 1] = bt_gain_wide(buf[2 * i + 1], k);
+    }
+    gain = target;
+  }
+
+  if (samples & 1) {
+    buf[samples - 1] = bt_gain_wide(buf[samples - 1], gain);
+  }
+  g->current = (uint32_t)gain;
+}
@@ -0,0 +1,54 @@
+#ifndef __BT_APP_GAIN_H__
+#define __BT_APP_GAIN_H__
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* AVRCP absolute volume range is 0..0x7f */
+#define BT_GAIN_VOLUME_MAX 0x7f
+/* Q15 unity gain */
+#define BT_GAIN_UNITY 32768
+
+/**
+ * Digital volume stage.
+ *
+ * The control side sets a target gain from an AVRCP volume; the audio task
+ * ramps linearly from the gain it used last to that target over the next
+ * block so a change never steps mid-waveform.
+ */
+typedef struct {
+  atomic_uint target; /*!< Q15 gain requested by the controller */
+  uint32_t current;   /*!< Q15 gain at the end of the last block */
+} bt_gain_t;
+
+/**
+ * @brief  initialise the stage at the given volume with no ramp
+ */
+void bt_gain_init(bt_gain_t *g, uint8_t volume);
+
+/**
+ * @brief  request a new volume (any task)
+ *
+ * @param [in] volume  AVRCP absolute volume, 0..BT_GAIN_VOLUME_MAX
+ */
+void bt_gain_set_volume(bt_gain_t *g, uint8_t volume);
+
+/**
+ * @brief  apply the gain in place to interleaved 16-bit PCM (audio task)
+ *
+ * @param [in,out] buf      samples, 32-bit aligned
+ * @param [in]     samples  number of samples (frames times channels)
+ */
+void bt_gain_process(bt_gain_t *g, int16_t *buf, size_t samples);
+
+/**
+ * @brief  apply the gain in place to interleaved 32-bit samples with
+ *         headroom, keeping the bits shifted down (audio task)
+ *
+ * @param [in,out] buf      samples in the bt_app_pcm processing format
+ * @param [in]     samples  number of samples (frames times channels)
+ */
+void bt_gain_process32(bt_gain_t *g, int32_t *buf, size_t samples);
+
+#endif /* __BT_APP_GAIN_H__ */
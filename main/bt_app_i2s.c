@@ -1,71 +1,550 @@
 #include "bt_app_i2s.h"
 
-#include <driver/i2s_std.h>
+#include <esp_attr.h>
+#include <esp_cpu.h>
 #include <esp_log.h>
-#include <freertos/ringbuf.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "bt_app_asrc.h"
+#include "bt_app_drain.h"
+#include "bt_app_drift.h"
+#include "bt_app_dsp.h"
+#include "bt_app_eq.h"
+#include "bt_app_gain.h"
+#include "bt_app_jitter.h"
+#include "bt_app_latency.h"
+#include "bt_app_out.h"
+#include "bt_app_pcm.h"
+#include "bt_app_plc.h"
+#include "bt_app_ringbuf.h"
+#include "bt_app_session.h"
+#include "bt_app_trace.h"
+#include "bt_app_trim.h"
+
+/* ringbuffer capacity; prefetch and drop levels adapt below this */
 #define RINGBUF_HIGHEST_WATER_LEVEL (32 * 1024)
-#define RINGBUF_PREFETCH_WATER_LEVEL (20 * 1024)
+/* longest the I2S task sleeps; only reached once the output is stopped */
+#define I2S_WRITE_TIMEOUT_MS 100
+/* longest to wait for the I2S task to park, past a write that times out */
+#define I2S_PARK_TIMEOUT_MS (4 * I2S_WRITE_TIMEOUT_MS)
+/* frames compressed per pass while draining */
+#define DRAIN_CHUNK_FRAMES 512
+/* size of an output sample; 32-bit slots carry the 24-bit processing */
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_32BIT
+#define I2S_SAMPLE_BYTES sizeof(int32_t)
+#else
+#define I2S_SAMPLE_BYTES sizeof(int16_t)
+#endif
+/**
+ * DMA geometry. The output latency target is split over I2S_DMA_DESC_NUM
+ * descriptors: one plays, one is refilled when the previous one has been
+ * sent, and the rest is the margin for a late wakeup or packet. Fewer,
+ * larger descriptors mean fewer wakeups; a descriptor holds at most 4092
+ * bytes, which caps the latency at 32-bit.
+ */
+#define I2S_DMA_DESC_NUM 4
+#define I2S_DMA_DESC_FRAMES_MAX ((int)(4092 / (2 * I2S_SAMPLE_BYTES)))
+#define I2S_DMA_FRAMES_WANTED(rate) \
+  ((rate) * CONFIG_EXAMPLE_A2DP_SINK_DMA_LATENCY_MS / 1000 / I2S_DMA_DESC_NUM)
+#define I2S_DMA_FRAMES(rate)                                  \
+  (I2S_DMA_FRAMES_WANTED(rate) < I2S_DMA_DESC_FRAMES_MAX      \
+       ? I2S_DMA_FRAMES_WANTED(rate)                          \
+       : I2S_DMA_DESC_FRAMES_MAX)
+/* the largest descriptor, at the highest SBC sample rate */
+#define I2S_DMA_FRAMES_MAX I2S_DMA_FRAMES(48000)
+/* slot of the n-th sent descriptor; I2S_DMA_DESC_NUM is a power of two */
+#define I2S_DMA_SLOT(n) ((n) & (I2S_DMA_DESC_NUM - 1))
+/* prefetch of a new stream; needs the clock tracking to grow the buffer */
+#if defined(CONFIG_EXAMPLE_A2DP_SINK_ASRC) || \
+    defined(CONFIG_EXAMPLE_A2DP_SINK_APLL)
+#define FAST_START_MS CONFIG_EXAMPLE_A2DP_SINK_FAST_START_MS
+#else
+#define FAST_START_MS 0
+#endif
+/* room for the DSP stages on top of the driver calls */
+#define I2S_TASK_STACK_SIZE 3072
 
 /*******************************
  * STATIC VARIABLE DEFINITIONS
  ******************************/
-static RingbufHandle_t s_ringbuf_i2s = NULL; /* handle of ringbuffer for I2S */
+static bt_ringbuf_t s_ringbuf_i2s;              /* ringbuffer for I2S */
+static uint8_t *s_ringbuf_storage = NULL;        /* ringbuffer memory */
 static TaskHandle_t s_bt_i2s_task_handle = NULL; /* handle of I2S task */
 static SemaphoreHandle_t s_i2s_write_semaphore = NULL;
-static uint16_t ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
-i2s_chan_handle_t tx_chan = NULL;
+static _Atomic uint8_t s_state = BT_I2S_IDLE; /* audio engine state */
+static atomic_bool s_parked = false; /* I2S task is waiting for a stream */
+static SemaphoreHandle_t s_i2s_parked_semaphore = NULL; /* given on parking */
+/* set on arming; the producer starts its side over on its next packet */
+static atomic_bool s_producer_reset = false;
+static int s_sample_rate = 44100;     /* clock the channel is set up for */
+static _Atomic uint16_t ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
+static bt_jitter_t s_jitter; /* adaptive watermarks, owned by the producer */
+static _Atomic uint32_t s_bytes_per_sec = 44100 * 2 * sizeof(int16_t);
+static _Atomic uint8_t s_ch_count = 2;
+static uint32_t s_watermark_bps = 0;  /* byte rate the levels were set for */
+static uint32_t s_capacity_ms = 0;    /* ringbuffer capacity in time */
+static _Atomic uint32_t s_target_bytes = 0; /* fill level to return to */
+static uint32_t s_prefetch_bytes = 0; /* fill needed to start playback */
+static uint32_t s_high_bytes = 0;     /* fill above which data is dropped */
+static _Atomic uint32_t s_bytes_in = 0;  /* bytes accepted from the source */
+static uint32_t s_bytes_out = 0;         /* bytes rendered to I2S */
+/* source frames taken out of the ringbuffer, for the playback clock */
+static _Atomic uint32_t s_frames_played = 0;
+#ifndef CONFIG_EXAMPLE_A2DP_SINK_ZERO_COPY
+/* rendered descriptor; word aligned so that DSP stages can work on sample
+ * pairs
+ */
+static WORD_ALIGNED_ATTR int16_t
+    s_i2s_out[I2S_DMA_FRAMES_MAX * 2 * I2S_SAMPLE_BYTES / sizeof(int16_t)];
+#endif
+/* digital volume, full until the controller sets an absolute volume */
+static bt_gain_t s_gain;
+static bt_latency_t s_latency;   /* per-stage latency histograms */
+static bt_session_t s_session;   /* time to first audio */
+/* frames queued in the I2S DMA buffers, and per descriptor */
+static uint32_t s_dma_frames = I2S_DMA_DESC_NUM * I2S_DMA_FRAMES(44100);
+static uint32_t s_dma_desc_frames = I2S_DMA_FRAMES(44100);
+/* buffers of the descriptors the DMA has sent, by slot, and their count;
+ * written by on_sent
+ */
+static uint8_t *s_dma_sent[I2S_DMA_DESC_NUM];
+static _Atomic uint32_t s_dma_sent_seq = 0;
+static uint32_t s_dma_fill_seq = 0; /* next sent descriptor to refill */
+/* the consumer is blocked until more data arrives; the producer only wakes
+ * it then, the DMA wakes it otherwise
+ */
+static atomic_bool s_data_wait;
+/* consumer cost since the engine was armed */
+static uint32_t s_wakeups;     /* sleeps ended, by DMA or data */
+static uint32_t s_chunks;      /* descriptors refilled */
+static uint64_t s_busy_cycles; /* CPU cycles spent refilling */
+static int64_t s_stats_us;     /* time the counts started */
+static uint32_t s_underruns;   /* times the ringbuffer ran dry */
+static uint32_t s_dropped;     /* source bytes discarded on overflow */
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+static bt_asrc_t s_asrc;   /* drift-correcting resampler */
+static bt_drift_t s_drift; /* source/sink clock drift estimate */
+#endif
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+static bt_trim_t s_trim; /* output clock trim controller */
+#endif
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_PLC
+static bt_plc_t s_plc; /* underflow concealment */
+#endif
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_EQ
+static bt_eq_t s_eq; /* parametric output EQ */
+/* the EQ's control side: band changes from any task, rate from the app's */
+static SemaphoreHandle_t s_eq_lock = NULL;
+#endif
+static bt_dsp_chain_t s_dsp; /* output processing, in place on each chunk */
+static const bt_out_t *s_out = &BT_OUT_BACKEND; /* output backend */
 
 /*******************************
  * STATIC FUNCTION DECLARATIONS
  ******************************/
 static void bt_i2s_task_handler(void *arg);
+/* output format and DMA geometry of the current stream */
+static void bt_i2s_out_cfg(bt_out_cfg_t *cfg);
+/* pull up to `frames` frames of output from the ringbuffer */
+static size_t bt_i2s_render(int16_t *out, size_t frames, uint8_t ch);
+/* DMA buffer played out, in ISR context */
+static bool bt_i2s_on_sent(void *buf);
+/* convert the jitter watermarks to bytes at the current format */
+static void bt_i2s_update_watermarks(void);
+/* start the producer's side of the data path over, on the producer */
+static void bt_i2s_producer_reset(void);
+/* wait for the I2S task to leave the render loop; false if it didn't */
+static bool bt_i2s_wait_parked(void);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OVERFLOW_DRAIN
+/* write a packet with some of its frames folded out */
+static size_t bt_i2s_write_drained(const uint8_t *data, size_t size,
+                                   size_t excess);
+#endif
+/* cycle counter for the DSP stage timings */
+static uint32_t bt_i2s_dsp_clock(void);
+/* DSP stages over a rendered chunk */
+static void bt_i2s_dsp_volume(void *ctx, void *buf, size_t frames,
+                              uint8_t ch);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_EQ
+static void bt_i2s_dsp_eq(void *ctx, void *buf, size_t frames, uint8_t ch);
+static bool bt_i2s_dsp_eq_setup(void *ctx, uint32_t sample_rate, uint8_t ch);
+#endif
 
 /*******************************
  * FUNCTION DEFINITIONS
  ******************************/
 
+/**
+ * update watermarks
+ */
+static void bt_i2s_update_watermarks(void) {
+  uint32_t bps = atomic_load(&s_bytes_per_sec);
+
+  s_watermark_bps = bps;
+  s_capacity_ms =
+      bt_jitter_bytes_to_us(RINGBUF_HIGHEST_WATER_LEVEL, bps) / 1000;
+  s_target_bytes = bt_jitter_ms_to_bytes(s_jitter.target_ms, bps);
+  s_prefetch_bytes = bt_jitter_ms_to_bytes(s_jitter.prefetch_ms, bps);
+  s_high_bytes = bt_jitter_ms_to_bytes(s_jitter.high_ms, bps);
+}
+
+/**
+ * wait parked
+ */
+static bool bt_i2s_wait_parked(void) {
+  /* a give from an earlier parking may be pending; the flag has the say */
+  while (!atomic_load(&s_parked)) {
+    if (pdTRUE != xSemaphoreTake(s_i2s_parked_semaphore,
+                                 pdMS_TO_TICKS(I2S_PARK_TIMEOUT_MS))) {
+      ESP_LOGE(I2S_TAG, "%s, I2S task still rendering", __func__);
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * producer reset
+ */
+static void bt_i2s_producer_reset(void) {
+  /* the consumer stays parked until this call has prefetched again */
+  bt_ringbuf_reset(&s_ringbuf_i2s);
+  bt_latency_reset(&s_latency);
+  s_bytes_in = 0;
+  s_dropped = 0;
+  bt_i2s_update_watermarks();
+  bt_jitter_reset(&s_jitter, CONFIG_EXAMPLE_A2DP_SINK_JITTER_MIN_MS,
+                  CONFIG_EXAMPLE_A2DP_SINK_JITTER_MAX_MS, FAST_START_MS,
+                  s_capacity_ms);
+  bt_i2s_update_watermarks();
+}
+
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OVERFLOW_DRAIN
+/**
+ * write drained
+ */
+static size_t bt_i2s_write_drained(const uint8_t *data, size_t size,
+                                   size_t excess) {
+  static int16_t s_drain_buf[DRAIN_CHUNK_FRAMES * 2];
+  const int16_t *src = (const int16_t *)data;
+  size_t ch = atomic_load(&s_ch_count);
+  size_t frame_bytes = ch * sizeof(int16_t);
+  size_t frames = size / frame_bytes;
+  size_t drop = bt_drain_budget(frames, excess / frame_bytes);
+  size_t chunk = DRAIN_CHUNK_FRAMES * 2 / ch;
+  size_t written = 0;
+
+  if (bt_ringbuf_space(&s_ringbuf_i2s) < size) {
+    return 0;
+  }
+
+  /* spread the removed frames evenly over the chunks of the packet */
+  for (size_t start = 0; start < frames; start += chunk) {
+    size_t n = frames - start < chunk ? frames - start : chunk;
+    size_t chunk_drop = drop * (start + n) / frames - drop * start / frames;
+    size_t out = bt_drain_compress(s_drain_buf, src + start * ch, n, ch,
+                                   chunk_drop);
+    bt_ringbuf_write(&s_ringbuf_i2s, s_drain_buf, out * frame_bytes);
+    written += out * frame_bytes;
+  }
+  return written;
+}
+#endif
+
+/**
+ * DSP clock
+ */
+static uint32_t bt_i2s_dsp_clock(void) { return esp_cpu_get_cycle_count(); }
+
+/**
+ * DSP volume
+ */
+static void bt_i2s_dsp_volume(void *ctx, void *buf, size_t frames,
+                              uint8_t ch) {
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_32BIT
+  bt_gain_process32(ctx, buf, frames * ch);
+#else
+  bt_gain_process(ctx, buf, frames * ch);
+#endif
+}
+
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_EQ
+/**
+ * DSP EQ
+ */
+static void bt_i2s_dsp_eq(void *ctx, void *buf, size_t frames, uint8_t ch) {
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_32BIT
+  bt_eq_process32(ctx, buf, frames, ch);
+#else
+  bt_eq_process(ctx, buf, frames, ch);
+#endif
+}
+
+/**
+ * DSP EQ setup
+ */
+static bool bt_i2s_dsp_eq_setup(void *ctx, uint32_t sample_rate, uint8_t ch) {
+  /* the coefficients follow the rate; the filters keep state per channel */
+  xSemaphoreTake(s_eq_lock, portMAX_DELAY);
+  bt_eq_set_sample_rate(ctx, sample_rate);
+  xSemaphoreGive(s_eq_lock);
+  return ch <= BT_EQ_MAX_CH;
+}
+#endif
+
+/**
+ * output config
+ */
+static void bt_i2s_out_cfg(bt_out_cfg_t *cfg) {
+  cfg->sample_rate = s_sample_rate;
+  cfg->ch = atomic_load(&s_ch_count);
+  cfg->sample_bytes = I2S_SAMPLE_BYTES;
+  cfg->desc_num = I2S_DMA_DESC_NUM;
+  cfg->desc_frames = s_dma_desc_frames;
+  cfg->on_sent = bt_i2s_on_sent;
+}
+
+/**
+ * DMA sent
+ */
+static bool IRAM_ATTR bt_i2s_on_sent(void *buf) {
+  BaseType_t woken = pdFALSE;
+  uint32_t seq = atomic_load(&s_dma_sent_seq);
+
+  s_dma_sent[I2S_DMA_SLOT(seq)] = buf;
+  atomic_store(&s_dma_sent_seq, seq + 1);
+  if (atomic_load(&s_state) == BT_I2S_STREAMING) {
+    vTaskNotifyGiveFromISR(s_bt_i2s_task_handle, &woken);
+  }
+  return woken == pdTRUE;
+}
+
+/**
+ * render
+ */
+static size_t bt_i2s_render(int16_t *out, size_t frames, uint8_t ch) {
+  const size_t frame_bytes = ch * sizeof(int16_t);
+  const uint8_t *data = NULL;
+  size_t item_size = 0;
+  size_t rendered = 0;
+
+  while (rendered < frames) {
+    data = bt_ringbuf_read_acquire(&s_ringbuf_i2s, &item_size);
+    if (item_size < frame_bytes) {
+      /* the caller fills in the rest rather than starve the DMA */
+      break;
+    }
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+    size_t used = 0;
+    rendered += bt_asrc_process(&s_asrc, (const int16_t *)data,
+                                item_size / frame_bytes, &used,
+                                out + rendered * ch, frames - rendered);
+    bt_ringbuf_read_commit(&s_ringbuf_i2s, used * frame_bytes);
+    atomic_fetch_add(&s_frames_played, used);
+#else
+    size_t n = item_size / frame_bytes;
+    if (n > frames - rendered) {
+      n = frames - rendered;
+    }
+    memcpy(out + rendered * ch, data, n * frame_bytes);
+    bt_ringbuf_read_commit(&s_ringbuf_i2s, n * frame_bytes);
+    atomic_fetch_add(&s_frames_played, n);
+    rendered += n;
+#endif
+  }
+  return rendered;
+}
+
 /**
  * I2S task handler
  */
 static void bt_i2s_task_handler(void *arg) {
-  uint8_t *data = NULL;
-  size_t item_size = 0;
-  /**
-   * The total length of DMA buffer of I2S is:
-   * `dma_frame_num * dma_desc_num * i2s_channel_num * i2s_data_bit_width / 8`.
-   * Transmit `dma_frame_num * dma_desc_num` bytes to DMA is trade-off.
-   */
-  const size_t item_size_upto = 240 * 6;
-  size_t bytes_written = 0;
+  size_t frames = 0;
+  uint8_t ch = 2;
 
   for (;;) {
+    atomic_store(&s_parked, true);
+    xSemaphoreGive(s_i2s_parked_semaphore);
     if (pdTRUE == xSemaphoreTake(s_i2s_write_semaphore, portMAX_DELAY)) {
+      atomic_store(&s_parked, false);
+      if (atomic_load(&s_state) == BT_I2S_IDLE) {
+        /* prefetching finished just as the connection went away */
+        continue;
+      }
+      ch = atomic_load(&s_ch_count);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+      /* prefetching skews the in/out totals, so restart the estimate but
+       * keep the drift already learned; the clocks themselves haven't moved
+       */
+      int32_t drift_ppm = s_drift.drift_ppm;
+      bt_drift_reset(&s_drift);
+      s_drift.drift_ppm = drift_ppm;
+      bt_asrc_reset(&s_asrc, ch);
+      bt_asrc_set_ratio_ppm(&s_asrc, drift_ppm);
+      /* playback may start well short of the target; play slow to grow it */
+      bt_drift_fill_up(&s_drift);
+#endif
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+      bt_trim_fill_up(&s_trim);
+#endif
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_PLC
+      uint32_t rate = atomic_load(&s_bytes_per_sec) / ch / sizeof(int16_t);
+      if (s_plc.ch != ch || s_plc.sample_rate != rate) {
+        bt_plc_reset(&s_plc, ch, rate);
+      }
+#endif
+      frames = s_dma_desc_frames;
+      /* the DMA has been playing silence; all its sent buffers are free */
+      uint32_t sent = atomic_load(&s_dma_sent_seq);
+      s_dma_fill_seq =
+          sent - (sent < I2S_DMA_DESC_NUM - 1 ? sent : I2S_DMA_DESC_NUM - 1);
       for (;;) {
-        item_size = 0;
-        /* receive data from ringbuffer and write it to I2S DMA transmit
-         * buffer
+        if (atomic_load(&s_state) == BT_I2S_IDLE) {
+          break;
+        }
+        /* refill one DMA descriptor each time the DMA has sent one */
+        uint32_t dma_free = atomic_load(&s_dma_sent_seq) - s_dma_fill_seq;
+        if (dma_free > I2S_DMA_DESC_NUM - 1) {
+          /* the DMA went round on silence; older buffers are playing again */
+          s_dma_fill_seq += dma_free - (I2S_DMA_DESC_NUM - 1);
+          dma_free = I2S_DMA_DESC_NUM - 1;
+        }
+        if (dma_free == 0) {
+          ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(I2S_WRITE_TIMEOUT_MS));
+          s_wakeups++;
+          continue;
+        }
+        /* while the DMA still holds our audio, a late packet can be waited
+         * for; once it is down to its last descriptor, act now
          */
-        data = (uint8_t *)xRingbufferReceiveUpTo(s_ringbuf_i2s, &item_size,
-                                                 (TickType_t)pdMS_TO_TICKS(20),
-                                                 item_size_upto);
-        if (item_size == 0) {
+        bool dma_dry = dma_free >= I2S_DMA_DESC_NUM - 1;
+        size_t need = (frames + 2) * ch * sizeof(int16_t);
+        if (!dma_dry && bt_ringbuf_fill(&s_ringbuf_i2s) < need) {
+          /* look again once the flag is up, or a packet written just
+           * before it would go unnoticed until the DMA wakes us
+           */
+          atomic_store(&s_data_wait, true);
+          atomic_thread_fence(memory_order_seq_cst);
+          if (bt_ringbuf_fill(&s_ringbuf_i2s) < need) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(I2S_WRITE_TIMEOUT_MS));
+            s_wakeups++;
+          }
+          atomic_store(&s_data_wait, false);
+          continue;
+        }
+
+        uint32_t start = esp_cpu_get_cycle_count();
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ZERO_COPY
+        /* render straight into the buffer the DMA plays soonest */
+        int16_t *out = (int16_t *)s_dma_sent[I2S_DMA_SLOT(s_dma_fill_seq)];
+#else
+        int16_t *out = s_i2s_out;
+#endif
+        /* pull audio out of the ringbuffer, through the clock drift
+         * correction, and write it to I2S DMA transmit buffer
+         */
+        size_t got = bt_i2s_render(out, frames, ch);
+        size_t real = got;
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_PLC
+        if (got) {
+          bt_plc_good(&s_plc, out, got);
+        }
+        if (got < frames && !bt_plc_faded(&s_plc)) {
+          /* the DMA is about to run out; extend the audio and fade out */
+          if (!bt_plc_concealing(&s_plc)) {
+            ESP_LOGD(I2S_TAG, "ringbuffer ran dry, concealing");
+            bt_jitter_underrun(&s_jitter);
+            s_underruns++;
+          }
+          bt_plc_conceal(&s_plc, out + got * ch, frames - got);
+          got = frames;
+        }
+#endif
+        BT_TRACE(BT_TRACE_RENDER,
+                 (real < got ? BT_TRACE_RENDER_CONCEALED : 0) |
+                     (got == 0 ? BT_TRACE_RENDER_UNDERFLOW : 0),
+                 real);
+        if (got == 0) {
           ESP_LOGI(I2S_TAG,
                    "ringbuffer underflowed! mode changed: "
                    "RINGBUFFER_MODE_PREFETCHING");
-          ringbuffer_mode = RINGBUFFER_MODE_PREFETCHING;
+          atomic_store(&ringbuffer_mode, RINGBUFFER_MODE_PREFETCHING);
+          uint8_t streaming = BT_I2S_STREAMING;
+          atomic_compare_exchange_strong(&s_state, &streaming, BT_I2S_ARMED);
+#ifndef CONFIG_EXAMPLE_A2DP_SINK_PLC
+          bt_jitter_underrun(&s_jitter);
+          s_underruns++;
+#endif
           break;
         }
-
-#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-        dac_continuous_write(tx_chan, data, item_size, &bytes_written, -1);
+        if (got < frames) {
+          /* keep whole descriptors so that each write fills exactly one */
+          memset(out + got * ch, 0,
+                 (frames - got) * ch * sizeof(int16_t));
+        }
+        uint32_t read_us = (uint32_t)esp_timer_get_time();
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_32BIT
+        /* the span has room for it; widen once, process, then fill the
+         * slots
+         */
+        int32_t *wide = (int32_t *)out;
+        bt_pcm_widen(wide, frames * ch);
+        bt_dsp_run(&s_dsp, wide, frames, ch);
+        bt_pcm_to_slot32(wide, frames * ch);
 #else
-        i2s_channel_write(tx_chan, data, item_size, &bytes_written,
-                          portMAX_DELAY);
+        bt_dsp_run(&s_dsp, out, frames, ch);
+#endif
+        s_out->write(out, frames, ch);
+        s_dma_fill_seq++;
+        if (real) {
+          s_bytes_out += real * ch * sizeof(int16_t);
+          if (bt_session_mark(&s_session, BT_SESSION_FIRST_AUDIO,
+                              (uint32_t)esp_timer_get_time())) {
+            bt_session_report(&s_session);
+          }
+        }
+        /* the chunk plays once the descriptors queued ahead of it are out */
+        bt_latency_egress(
+            &s_latency, bt_ringbuf_read_index(&s_ringbuf_i2s), read_us,
+            (uint32_t)esp_timer_get_time() +
+                bt_jitter_bytes_to_us(
+                    (I2S_DMA_DESC_NUM - dma_free) * frames * ch *
+                        sizeof(int16_t),
+                    atomic_load(&s_bytes_per_sec)));
+
+#if defined(CONFIG_EXAMPLE_A2DP_SINK_ASRC) || \
+    defined(CONFIG_EXAMPLE_A2DP_SINK_APLL)
+        uint32_t bps = atomic_load(&s_bytes_per_sec);
+        int32_t fill_err_us =
+            (int32_t)bt_jitter_bytes_to_us(bt_ringbuf_fill(&s_ringbuf_i2s),
+                                           bps) -
+            (int32_t)bt_jitter_bytes_to_us(s_target_bytes, bps);
 #endif
-        vRingbufferReturnItem(s_ringbuf_i2s, (void *)data);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+        if (bt_drift_update(&s_drift, esp_timer_get_time(), s_bytes_in,
+                            s_bytes_out, fill_err_us)) {
+          bt_asrc_set_ratio_ppm(&s_asrc, s_drift.ratio_ppm);
+          ESP_LOGD(I2S_TAG,
+                   "clock drift %" PRId32 " ppm, correction %" PRId32 " ppm",
+                   s_drift.drift_ppm, s_drift.ratio_ppm);
+        }
+#endif
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+        if (bt_trim_update(&s_trim, esp_timer_get_time(), fill_err_us)) {
+          s_out->trim(s_trim.ppm);
+          ESP_LOGD(I2S_TAG, "APLL trim %" PRId32 " ppm", s_trim.ppm);
+        }
+#endif
+        s_chunks++;
+        s_busy_cycles += esp_cpu_get_cycle_count() - start;
       }
     }
   }
@@ -79,140 +558,409 @@ static void bt_i2s_task_handler(void *arg) {
  * i2s config
  */
 void bt_i2s_config(int sample_rate, int ch_count) {
-  i2s_channel_disable(tx_chan);
-  i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate);
-  i2s_std_slot_config_t slot_cfg =
-      I2S_STD_MSB_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, ch_count);
-  slot_cfg.bit_shift = true;  // required for PCM5102 I2S format
-  i2s_channel_reconfig_std_clock(tx_chan, &clk_cfg);
-  i2s_channel_reconfig_std_slot(tx_chan, &slot_cfg);
-  i2s_channel_enable(tx_chan);
-}
-
-/**
- * enable I2S driver
- */
-void bt_i2s_driver_install(void) {
-  i2s_chan_config_t chan_cfg =
-      I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
-  chan_cfg.auto_clear = true;
-  i2s_std_config_t std_cfg = {
-      .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(44100),
-      .slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT,
-                                                  I2S_SLOT_MODE_STEREO),
-      .gpio_cfg =
-          {
-              .mclk = I2S_GPIO_UNUSED,
-              .bclk = CONFIG_EXAMPLE_I2S_BCK_PIN,
-              .ws = CONFIG_EXAMPLE_I2S_LRCK_PIN,
-              .dout = CONFIG_EXAMPLE_I2S_DATA_PIN,
-              .din = I2S_GPIO_UNUSED,
-              .invert_flags =
-                  {
-                      .mclk_inv = false,
-                      .bclk_inv = false,
-                      .ws_inv = false,
-                  },
-          },
-  };
-  /* enable I2S */
-  ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &tx_chan, NULL));
-  ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_chan, &std_cfg));
-  ESP_ERROR_CHECK(i2s_channel_enable(tx_chan));
-}
-
-/**
- * disable I2S driver
- */
-void bt_i2s_driver_uninstall(void) {
-#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-  ESP_ERROR_CHECK(dac_continuous_disable(tx_chan));
-  ESP_ERROR_CHECK(dac_continuous_del_channels(tx_chan));
+  bt_session_begin(&s_session, BT_SESSION_CONFIGURED,
+                   (uint32_t)esp_timer_get_time());
+  /* the channel keeps its clocks across connections; most sources use the
+   * same format every time
+   */
+  if (sample_rate == s_sample_rate && ch_count == atomic_load(&s_ch_count)) {
+    return;
+  }
+  /* the backend may reallocate its DMA buffers, so the task must not be
+   * rendering into one; park it for the change and prefetch again after.
+   * Even when idle it may still be finishing a chunk.
+   */
+  bool live = atomic_load(&s_state) != BT_I2S_IDLE;
+  bt_i2s_engine_idle();
+  if (!bt_i2s_wait_parked()) {
+    /* the old buffers stay, and with them the old format */
+    return;
+  }
+  s_sample_rate = sample_rate;
+  atomic_store(&s_bytes_per_sec, sample_rate * ch_count * sizeof(int16_t));
+  atomic_store(&s_ch_count, ch_count);
+  /* descriptors are sized in frames for the latency target, so a new rate
+   * takes new DMA buffers; it only happens when the source switches rates
+   */
+  s_dma_desc_frames = I2S_DMA_FRAMES(sample_rate);
+  s_dma_frames = I2S_DMA_DESC_NUM * s_dma_desc_frames;
+  bt_out_cfg_t cfg;
+  bt_i2s_out_cfg(&cfg);
+  s_out->configure(&cfg);
+  /* with the output stopped nothing is sent; forget the buffers sent before,
+   * which may have been freed with the old ones
+   */
+  memset(s_dma_sent, 0, sizeof(s_dma_sent));
+  atomic_store(&s_dma_sent_seq, 0);
+  bt_dsp_configure(&s_dsp, sample_rate, ch_count);
+  if (live) {
+    /* audio queued at the old format is dropped and the watermarks follow
+     * the new one
+     */
+    atomic_store(&s_producer_reset, true);
+    s_out->enable(true);
+    atomic_store(&s_state, BT_I2S_ARMED);
+  }
+}
+
+/**
+ * stream started
+ */
+void bt_i2s_stream_started(void) {
+  bt_session_begin(&s_session, BT_SESSION_STARTED,
+                   (uint32_t)esp_timer_get_time());
+}
+
+/**
+ * set volume
+ */
+void bt_i2s_set_volume(uint8_t volume) { bt_gain_set_volume(&s_gain, volume); }
+
+/**
+ * delay
+ */
+uint32_t bt_i2s_delay_us(void) {
+  uint32_t bps = atomic_load(&s_bytes_per_sec);
+  size_t queued = s_dma_frames * atomic_load(&s_ch_count) * sizeof(int16_t);
+
+  /* before playback starts, the fill it will start from */
+  if (atomic_load(&s_state) == BT_I2S_IDLE) {
+    queued +=
+        bt_jitter_ms_to_bytes(CONFIG_EXAMPLE_A2DP_SINK_JITTER_MIN_MS, bps);
+  } else if (atomic_load(&ringbuffer_mode) == RINGBUFFER_MODE_PREFETCHING) {
+    queued += atomic_load(&s_target_bytes);
+  } else {
+    queued += bt_ringbuf_fill(&s_ringbuf_i2s);
+  }
+  return bt_jitter_bytes_to_us(queued, bps);
+}
+
+/**
+ * frames played
+ */
+uint32_t bt_i2s_frames_played(void) {
+  /* the last DMA queue's worth is still on its way to the DAC */
+  return atomic_load(&s_frames_played) - s_dma_frames;
+}
+
+/**
+ * sample rate
+ */
+uint32_t bt_i2s_sample_rate(void) {
+  return atomic_load(&s_bytes_per_sec) / atomic_load(&s_ch_count) /
+         sizeof(int16_t);
+}
+
+/**
+ * dump latency
+ */
+void bt_i2s_latency_dump(void) {
+  int64_t elapsed_us = esp_timer_get_time() - s_stats_us;
+
+  bt_latency_dump(&s_latency);
+  if (elapsed_us > 0) {
+    /* per mille of one core */
+    uint32_t load = (uint32_t)(s_busy_cycles * 1000 /
+                               ((uint64_t)elapsed_us *
+                                esp_rom_get_cpu_ticks_per_us()));
+    ESP_LOGI(I2S_TAG,
+             "consumer: %" PRIu32 " wakeups/s, %" PRIu32
+             " descriptors/s of %" PRIu32 " frames, %" PRIu32
+             " kcycles/s, CPU %" PRIu32 ".%" PRIu32 "%%",
+             (uint32_t)(s_wakeups * 1000000LL / elapsed_us),
+             (uint32_t)(s_chunks * 1000000LL / elapsed_us), s_dma_desc_frames,
+             (uint32_t)(s_busy_cycles * 1000 / elapsed_us), load / 10,
+             load % 10);
+  }
+  ESP_LOGI(I2S_TAG, "data path: %" PRIu32 " underruns, %" PRIu32
+           " bytes dropped", s_underruns, s_dropped);
+  for (uint8_t i = 0; i < s_dsp.count; i++) {
+    bt_dsp_stats_t st;
+    if (!bt_dsp_stats(&s_dsp, i, &st) || st.calls == 0) {
+      continue;
+    }
+    ESP_LOGI(I2S_TAG,
+             "stage %s: %" PRIu32 " chunks, %" PRIu32 " cycles avg, %" PRIu32
+             " peak",
+             s_dsp.stage[i].name, st.calls, (uint32_t)(st.cycles / st.calls),
+             st.peak);
+  }
+}
+
+/**
+ * stats
+ */
+void bt_i2s_stats(bt_i2s_stats_t *stats) {
+  stats->elapsed_us = esp_timer_get_time() - s_stats_us;
+  stats->wakeups = s_wakeups;
+  stats->chunks = s_chunks;
+  stats->busy_cycles = s_busy_cycles;
+  stats->underruns = s_underruns;
+  stats->dropped = s_dropped;
+  stats->packets = atomic_load(&s_latency.output.count);
+  stats->latency_max_us = atomic_load(&s_latency.output.max_us);
+}
+
+/**
+ * set EQ band
+ */
+bool bt_i2s_set_eq_band(uint8_t idx, const bt_eq_band_t *band) {
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_EQ
+  xSemaphoreTake(s_eq_lock, portMAX_DELAY);
+  bool ok = bt_eq_set_band(&s_eq, idx, band);
+  xSemaphoreGive(s_eq_lock);
+  return ok;
 #else
-  ESP_ERROR_CHECK(i2s_channel_disable(tx_chan));
-  ESP_ERROR_CHECK(i2s_del_channel(tx_chan));
+  return false;
 #endif
 }
 
 /**
- * I2S task start up
+ * set DSP bypass
  */
-void bt_i2s_task_start_up(void) {
-  ESP_LOGI(I2S_TAG,
-           "ringbuffer data empty! mode changed: RINGBUFFER_MODE_PREFETCHING");
-  ringbuffer_mode = RINGBUFFER_MODE_PREFETCHING;
-  if ((s_i2s_write_semaphore = xSemaphoreCreateBinary()) == NULL) {
+bool bt_i2s_set_dsp_bypass(bt_i2s_dsp_t stage, bool bypass) {
+  return bt_dsp_bypass(&s_dsp, stage, bypass);
+}
+
+/**
+ * DSP stats
+ */
+bool bt_i2s_dsp_stats(bt_i2s_dsp_t stage, bt_dsp_stats_t *stats) {
+  return bt_dsp_stats(&s_dsp, stage, stats);
+}
+
+/**
+ * engine init
+ */
+bool bt_i2s_engine_init(void) {
+  if ((s_i2s_write_semaphore = xSemaphoreCreateBinary()) == NULL ||
+      (s_i2s_parked_semaphore = xSemaphoreCreateBinary()) == NULL) {
     ESP_LOGE(I2S_TAG, "%s, Semaphore create failed", __func__);
-    return;
+    return false;
   }
-  if ((s_ringbuf_i2s = xRingbufferCreate(RINGBUF_HIGHEST_WATER_LEVEL,
-                                         RINGBUF_TYPE_BYTEBUF)) == NULL) {
+  if ((s_ringbuf_storage = malloc(RINGBUF_HIGHEST_WATER_LEVEL)) == NULL) {
     ESP_LOGE(I2S_TAG, "%s, ringbuffer create failed", __func__);
-    return;
+    return false;
   }
-  xTaskCreate(bt_i2s_task_handler, "BtI2STask", 2048, NULL,
-              configMAX_PRIORITIES - 3, &s_bt_i2s_task_handle);
+  bt_ringbuf_init(&s_ringbuf_i2s, s_ringbuf_storage,
+                  RINGBUF_HIGHEST_WATER_LEVEL);
+  bt_gain_init(&s_gain, BT_GAIN_VOLUME_MAX);
+  bt_out_cfg_t cfg;
+  bt_i2s_out_cfg(&cfg);
+  s_out->open(&cfg);
+  ESP_LOGI(I2S_TAG, "output: %s", s_out->name);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_EQ
+  if ((s_eq_lock = xSemaphoreCreateMutex()) == NULL) {
+    ESP_LOGE(I2S_TAG, "%s, EQ mutex create failed", __func__);
+    return false;
+  }
+  bt_eq_init(&s_eq, s_sample_rate);
+  const bt_eq_band_t bass = {BT_EQ_LOW_SHELF, 100.0f, 0.707f,
+                             CONFIG_EXAMPLE_A2DP_SINK_EQ_BASS_DB};
+  const bt_eq_band_t treble = {BT_EQ_HIGH_SHELF, 10000.0f, 0.707f,
+                               CONFIG_EXAMPLE_A2DP_SINK_EQ_TREBLE_DB};
+  if (CONFIG_EXAMPLE_A2DP_SINK_EQ_BASS_DB != 0) {
+    bt_eq_set_band(&s_eq, 0, &bass);
+  }
+  if (CONFIG_EXAMPLE_A2DP_SINK_EQ_TREBLE_DB != 0) {
+    bt_eq_set_band(&s_eq, 1, &treble);
+  }
+#endif
+  /* added in bt_i2s_dsp_t order, so that the stage ids are chain indices */
+  bt_dsp_init(&s_dsp, bt_i2s_dsp_clock);
+  bt_dsp_add(&s_dsp, "volume", bt_i2s_dsp_volume, NULL, &s_gain);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_EQ
+  bt_dsp_add(&s_dsp, "EQ", bt_i2s_dsp_eq, bt_i2s_dsp_eq_setup, &s_eq);
+#endif
+  bt_dsp_configure(&s_dsp, s_sample_rate, atomic_load(&s_ch_count));
+  atomic_store(&ringbuffer_mode, RINGBUFFER_MODE_PREFETCHING);
+  atomic_store(&s_state, BT_I2S_IDLE);
+  if (xTaskCreate(bt_i2s_task_handler, "BtI2STask", I2S_TASK_STACK_SIZE, NULL,
+                  configMAX_PRIORITIES - 3, &s_bt_i2s_task_handle) != pdPASS) {
+    ESP_LOGE(I2S_TAG, "%s, task create failed", __func__);
+    return false;
+  }
+  return true;
 }
 
 /**
- * I2S task shut down
+ * engine arm
  */
-void bt_i2s_task_shut_down(void) {
-  if (s_bt_i2s_task_handle) {
-    vTaskDelete(s_bt_i2s_task_handle);
-    s_bt_i2s_task_handle = NULL;
+void bt_i2s_engine_arm(void) {
+  if (atomic_load(&s_state) != BT_I2S_IDLE) {
+    return;
   }
-  if (s_ringbuf_i2s) {
-    vRingbufferDelete(s_ringbuf_i2s);
-    s_ringbuf_i2s = NULL;
+  bt_session_begin(&s_session, BT_SESSION_CONNECT,
+                   (uint32_t)esp_timer_get_time());
+  /* the consumer's state is only reset with the task out of the way; it
+   * leaves the render loop within one chunk of going idle
+   */
+  if (!bt_i2s_wait_parked()) {
+    return;
   }
-  if (s_i2s_write_semaphore) {
-    vSemaphoreDelete(s_i2s_write_semaphore);
-    s_i2s_write_semaphore = NULL;
+  ESP_LOGI(I2S_TAG,
+           "ringbuffer data empty! mode changed: RINGBUFFER_MODE_PREFETCHING");
+  atomic_store(&ringbuffer_mode, RINGBUFFER_MODE_PREFETCHING);
+  s_wakeups = 0;
+  s_chunks = 0;
+  s_busy_cycles = 0;
+  bt_dsp_stats_reset(&s_dsp);
+  s_underruns = 0;
+  s_stats_us = esp_timer_get_time();
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+  bt_drift_reset(&s_drift);
+#endif
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+  /* a new source has a clock of its own */
+  bt_trim_reset(&s_trim);
+  s_out->trim(0);
+#endif
+  /* the BT task may still be inside write_ringbuf() for the last
+   * connection, so the ringbuffer and the watermarks are left to it
+   */
+  atomic_store(&s_producer_reset, true);
+  s_out->enable(true);
+  atomic_store(&s_state, BT_I2S_ARMED);
+}
+
+/**
+ * engine idle
+ */
+void bt_i2s_engine_idle(void) {
+  if (atomic_load(&s_state) == BT_I2S_IDLE) {
+    return;
   }
+  atomic_store(&s_state, BT_I2S_IDLE);
+  atomic_store(&ringbuffer_mode, RINGBUFFER_MODE_PREFETCHING);
+  /* cut a render wait short and fail a pending DMA write, so that the task
+   * parks right away
+   */
+  xTaskNotifyGive(s_bt_i2s_task_handle);
+  s_out->enable(false);
 }
 
+/**
+ * engine state
+ */
+bt_i2s_state_t bt_i2s_engine_state(void) { return atomic_load(&s_state); }
+
 /**
  * write ringbuf
  */
 
 size_t write_ringbuf(const uint8_t *data, size_t size) {
   size_t item_size = 0;
-  BaseType_t done = pdFALSE;
+  size_t written = 0;
+  bool done = false;
+  uint16_t mode = atomic_load(&ringbuffer_mode);
+  uint32_t bps = atomic_load(&s_bytes_per_sec);
+  int64_t now_us = esp_timer_get_time();
 
-  if (ringbuffer_mode == RINGBUFFER_MODE_DROPPING) {
-    ESP_LOGW(I2S_TAG, "ringbuffer is full, drop this packet!");
-    vRingbufferGetInfo(s_ringbuf_i2s, NULL, NULL, NULL, NULL, &item_size);
-    if (item_size <= RINGBUF_PREFETCH_WATER_LEVEL) {
-      ESP_LOGI(I2S_TAG,
-               "ringbuffer data decreased! mode changed: "
-               "RINGBUFFER_MODE_PROCESSING");
-      ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
-    }
+  /* nothing to play to without a connection */
+  if (atomic_load(&s_state) == BT_I2S_IDLE) {
     return 0;
   }
+  if (atomic_exchange(&s_producer_reset, false)) {
+    bt_i2s_producer_reset();
+    mode = atomic_load(&ringbuffer_mode);
+  }
 
-  done = xRingbufferSend(s_ringbuf_i2s, (void *)data, size, (TickType_t)0);
+  if (bps != s_watermark_bps) {
+    bt_i2s_update_watermarks();
+  }
+  if (bt_jitter_packet(&s_jitter, now_us, bt_jitter_bytes_to_us(size, bps),
+                       s_capacity_ms)) {
+    bt_i2s_update_watermarks();
+    ESP_LOGI(I2S_TAG,
+             "jitter %" PRIu32 " us, watermarks changed: target %" PRIu32
+             " ms, drop above %" PRIu32 " ms",
+             s_jitter.jitter_us, s_jitter.target_ms, s_jitter.high_ms);
+  }
+
+  if (s_jitter.streaming) {
+    bt_latency_hist_add(&s_latency.jitter, s_jitter.dev_us);
+  }
+
+  item_size = bt_ringbuf_fill(&s_ringbuf_i2s);
+
+  if (mode == RINGBUFFER_MODE_DROPPING && item_size <= s_target_bytes) {
+    ESP_LOGI(I2S_TAG,
+             "ringbuffer data decreased! mode changed: "
+             "RINGBUFFER_MODE_PROCESSING");
+    atomic_store(&ringbuffer_mode, RINGBUFFER_MODE_PROCESSING);
+    mode = RINGBUFFER_MODE_PROCESSING;
+  }
 
-  if (!done) {
+  /* act once the fill runs past the drop threshold rather than waiting for
+   * the ringbuffer itself to overflow
+   */
+  if (mode == RINGBUFFER_MODE_PROCESSING && item_size + size > s_high_bytes) {
     ESP_LOGW(I2S_TAG,
              "ringbuffer overflowed, ready to decrease data! mode changed: "
              "RINGBUFFER_MODE_DROPPING");
-    ringbuffer_mode = RINGBUFFER_MODE_DROPPING;
+    atomic_store(&ringbuffer_mode, RINGBUFFER_MODE_DROPPING);
+    mode = RINGBUFFER_MODE_DROPPING;
   }
 
-  if (ringbuffer_mode == RINGBUFFER_MODE_PREFETCHING) {
-    vRingbufferGetInfo(s_ringbuf_i2s, NULL, NULL, NULL, NULL, &item_size);
-    if (item_size >= RINGBUF_PREFETCH_WATER_LEVEL) {
+  if (mode == RINGBUFFER_MODE_DROPPING) {
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OVERFLOW_DRAIN
+    /* fold a few frames out of every packet until back at the target */
+    written = bt_i2s_write_drained(data, size, item_size - s_target_bytes);
+    done = written > 0;
+#endif
+    if (!done) {
+      ESP_LOGW(I2S_TAG, "ringbuffer is full, drop this packet!");
+    }
+  } else {
+    done = bt_ringbuf_write(&s_ringbuf_i2s, data, size);
+    written = done ? size : 0;
+    if (!done) {
+      ESP_LOGW(I2S_TAG,
+               "ringbuffer overflowed, ready to decrease data! mode changed: "
+               "RINGBUFFER_MODE_DROPPING");
+      atomic_store(&ringbuffer_mode, RINGBUFFER_MODE_DROPPING);
+    }
+  }
+
+  s_bytes_in += written;
+  s_dropped += size - written;
+  if (written) {
+    bt_session_mark(&s_session, BT_SESSION_FIRST_PACKET, (uint32_t)now_us);
+    bt_latency_ingress(&s_latency, (uint32_t)now_us,
+                       bt_ringbuf_write_index(&s_ringbuf_i2s),
+                       bt_jitter_bytes_to_us(item_size, bps));
+  }
+  if (done && mode != RINGBUFFER_MODE_PREFETCHING && s_bt_i2s_task_handle) {
+    /* wake the I2S task only if it is waiting for data; pairs with the
+     * fence between raising the flag and looking at the fill again
+     */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_exchange(&s_data_wait, false)) {
+      xTaskNotifyGive(s_bt_i2s_task_handle);
+    }
+  }
+
+  /* a call that started before the engine was armed again must not wake
+   * the consumer on the old data
+   */
+  if (atomic_load(&ringbuffer_mode) == RINGBUFFER_MODE_PREFETCHING &&
+      !atomic_load(&s_producer_reset)) {
+    item_size = bt_ringbuf_fill(&s_ringbuf_i2s);
+    if (item_size >= s_prefetch_bytes) {
       ESP_LOGI(I2S_TAG,
                "ringbuffer data increased! mode changed: "
                "RINGBUFFER_MODE_PROCESSING");
-      ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
+      atomic_store(&ringbuffer_mode, RINGBUFFER_MODE_PROCESSING);
+      uint8_t armed = BT_I2S_ARMED;
+      atomic_compare_exchange_strong(&s_state, &armed, BT_I2S_STREAMING);
       if (pdFALSE == xSemaphoreGive(s_i2s_write_semaphore)) {
         ESP_LOGE(I2S_TAG, "semphore give failed");
       }
+      if (bt_jitter_resumed(&s_jitter, s_capacity_ms)) {
+        bt_i2s_update_watermarks();
+      }
     }
   }
 
   return done ? size : 0;
-}
\ No newline at end of file
+}
@@ -5,9 +5,26 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "bt_app_dsp.h"
+#include "bt_app_eq.h"
+
 /* log tag */
 #define I2S_TAG "I2S"
 
+/* audio engine state */
+typedef enum {
+  BT_I2S_IDLE,      /* no connection; output stopped, incoming data ignored */
+  BT_I2S_ARMED,     /* connected; output running, buffering before playback */
+  BT_I2S_STREAMING, /* playing from the ringbuffer */
+} bt_i2s_state_t;
+
+/* DSP stages of the output, in processing order */
+typedef enum {
+  BT_I2S_DSP_VOLUME, /* digital volume */
+  BT_I2S_DSP_EQ,     /* parametric EQ, when enabled */
+  BT_I2S_DSP_NUM,
+} bt_i2s_dsp_t;
+
 enum {
   RINGBUFFER_MODE_PROCESSING,  /* ringbuffer is buffering incoming audio data,
                                   I2S is working */
@@ -23,24 +40,118 @@ enum {
 void bt_i2s_config(int sample_rate, int ch_count);
 
 /**
- * @brief  enable i2s driver
+ * @brief  the source started a stream, for the time to first audio
+ */
+void bt_i2s_stream_started(void);
+
+/**
+ * @brief  set the digital output volume
+ *
+ * @param [in] volume  AVRCP absolute volume, 0..0x7f
+ */
+void bt_i2s_set_volume(uint8_t volume);
+
+/**
+ * @brief  current delay from ingress to the DAC, for A2DP delay reporting
+ *
+ * @return  ringbuffer fill plus I2S DMA queue in microseconds; before
+ *          playback starts, the fill it is expected to start from
+ */
+uint32_t bt_i2s_delay_us(void);
+
+/**
+ * @brief  source frames played out so far, for the playback clock
+ *
+ * @return  running count that wraps around; excludes concealed audio and
+ *          the frames still queued for DMA
+ */
+uint32_t bt_i2s_frames_played(void);
+
+/**
+ * @brief  sample rate of the current stream
+ */
+uint32_t bt_i2s_sample_rate(void);
+
+/**
+ * @brief  log the latency histograms collected since the connection started
+ */
+void bt_i2s_latency_dump(void);
+
+/* audio engine counters since it was armed */
+typedef struct {
+  int64_t elapsed_us;      /*!< time the counts cover */
+  uint32_t wakeups;        /*!< task wakeups, by DMA or data */
+  uint32_t chunks;         /*!< DMA buffers rendered */
+  uint64_t busy_cycles;    /*!< CPU cycles spent rendering */
+  uint32_t underruns;      /*!< times the ringbuffer ran dry */
+  uint32_t dropped;        /*!< source bytes discarded on overflow */
+  uint32_t packets;        /*!< packets tracked to the DAC */
+  uint32_t latency_max_us; /*!< longest of them, ingress to DAC */
+} bt_i2s_stats_t;
+
+/**
+ * @brief  engine counters since it was last armed; exact once the engine
+ *         is idle, approximate while it runs
+ *
+ * @param [out] stats  the counters
+ */
+void bt_i2s_stats(bt_i2s_stats_t *stats);
+
+/**
+ * @brief  change one band of the output EQ; from any task, from the next DMA
+ *         buffer
+ *
+ * @param [in] idx   band index, 0..BT_EQ_MAX_BANDS-1
+ * @param [in] band  new band settings
+ *
+ * @return  false if the index is out of range or the EQ is not enabled
+ */
+bool bt_i2s_set_eq_band(uint8_t idx, const bt_eq_band_t *band);
+
+/**
+ * @brief  skip an output DSP stage, or put it back; takes effect from the
+ *         next DMA buffer
+ *
+ * @param [in] stage   the stage
+ * @param [in] bypass  true to skip it
+ *
+ * @return  false if the stage is not built in
+ */
+bool bt_i2s_set_dsp_bypass(bt_i2s_dsp_t stage, bool bypass);
+
+/**
+ * @brief  cost of an output DSP stage since the connection started; from
+ *         any task, consistent while the stage runs
+ *
+ * @param [in]  stage  the stage
+ * @param [out] stats  its block count and CPU cycles
+ *
+ * @return  false if the stage is not built in
+ */
+bool bt_i2s_dsp_stats(bt_i2s_dsp_t stage, bt_dsp_stats_t *stats);
+
+/**
+ * @brief  create the audio engine: I2S channel, ringbuffer and task; once
+ *         at boot, it stays until reset
+ *
+ * @return  false if a resource could not be allocated
  */
-void bt_i2s_driver_install(void);
+bool bt_i2s_engine_init(void);
 
 /**
- * @brief  disable i2s driver
+ * @brief  start the output and buffer for a new connection (IDLE -> ARMED)
  */
-void bt_i2s_driver_uninstall(void);
+void bt_i2s_engine_arm(void);
 
 /**
- * @brief  start up the is task
+ * @brief  stop the output and ignore incoming data (any -> IDLE)
  */
-void bt_i2s_task_start_up(void);
+void bt_i2s_engine_idle(void);
 
 /**
- * @brief  shut down the I2S task
+ * @brief  current audio engine state
  */
-void bt_i2s_task_shut_down(void);
+bt_i2s_state_t bt_i2s_engine_state(void);
 
 /**
  * @brief  write data to ringbuffer
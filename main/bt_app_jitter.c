@@ -0,0 +1,170 @@
+#include "bt_app_jitter.h"
+
+#include <stdlib.h>
+
+/* safety margin on top of the measured lateness */
+#define JITTER_MARGIN_MS 10
+/* extra depth added per underrun, and its ceiling */
+#define JITTER_PENALTY_STEP_MS 20
+#define JITTER_PENALTY_MAX_MS 80
+/* one penalty step is forgiven after this long without an underrun */
+#define JITTER_PENALTY_DECAY_US (10 * 1000 * 1000)
+/* minimum distance between target and drop threshold */
+#define JITTER_HEADROOM_MS 20
+/* watermarks move in steps of this size to avoid constant churn */
+#define JITTER_QUANTUM_MS 5
+/* a gap longer than this is a pause in the stream, not jitter */
+#define JITTER_PAUSE_US (500 * 1000)
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* derive target and thresholds from the current estimates */
+static bool bt_jitter_update_levels(bt_jitter_t *j, uint32_t capacity_ms);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static bool bt_jitter_update_levels(bt_jitter_t *j, uint32_t capacity_ms) {
+  uint32_t target = JITTER_MARGIN_MS + j->penalty_ms +
+                    (j->peak_us + 2 * j->jitter_us + 999) / 1000;
+  uint32_t high;
+
+  target = (target + JITTER_QUANTUM_MS - 1) / JITTER_QUANTUM_MS *
+           JITTER_QUANTUM_MS;
+  if (target < j->min_ms) {
+    target = j->min_ms;
+  }
+  if (target > j->max_ms) {
+    target = j->max_ms;
+  }
+
+  high = target + JITTER_HEADROOM_MS;
+  if (high < target + target / 2) {
+    high = target + target / 2;
+  }
+  /* keep a packet's worth of room so the ring itself never overflows */
+  if (capacity_ms > 2 * JITTER_HEADROOM_MS &&
+      high > capacity_ms - JITTER_HEADROOM_MS) {
+    high = capacity_ms - JITTER_HEADROOM_MS;
+    if (target > high - JITTER_QUANTUM_MS) {
+      target = high - JITTER_QUANTUM_MS;
+    }
+  }
+
+  uint32_t prefetch = target;
+  if (j->starting) {
+    prefetch = (j->start_ms + JITTER_QUANTUM_MS - 1) / JITTER_QUANTUM_MS *
+               JITTER_QUANTUM_MS;
+    if (prefetch > target) {
+      prefetch = target;
+    }
+  } else if (j->glitch) {
+    prefetch = (target / 2 + JITTER_QUANTUM_MS - 1) / JITTER_QUANTUM_MS *
+               JITTER_QUANTUM_MS;
+    if (prefetch < JITTER_MARGIN_MS) {
+      prefetch = JITTER_MARGIN_MS;
+    }
+  }
+
+  if (target == j->target_ms && prefetch == j->prefetch_ms &&
+      high == j->high_ms) {
+    return false;
+  }
+  j->target_ms = target;
+  j->prefetch_ms = prefetch;
+  j->high_ms = high;
+  return true;
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_jitter_reset(bt_jitter_t *j, uint32_t min_ms, uint32_t max_ms,
+                     uint32_t start_ms, uint32_t capacity_ms) {
+  j->min_ms = min_ms;
+  j->max_ms = max_ms < min_ms ? min_ms : max_ms;
+  /* below the minimum the fill would take tens of seconds at the slow
+   * play rate to get anywhere safe, and runs dry on the way
+   */
+  j->start_ms = start_ms && start_ms < j->min_ms ? j->min_ms : start_ms;
+  j->last_arrival_us = 0;
+  j->last_duration_us = 0;
+  j->dev_us = 0;
+  j->streaming = false;
+  j->jitter_us = 0;
+  /* start in the middle of the range until real arrivals are measured */
+  j->peak_us = (j->min_ms + j->max_ms) / 2 * 1000;
+  j->penalty_ms = 0;
+  j->last_underrun_us = 0;
+  j->underruns_seen = atomic_load(&j->underruns);
+  j->glitch = false;
+  j->starting = start_ms != 0;
+  j->target_ms = 0;
+  j->high_ms = 0;
+  bt_jitter_update_levels(j, capacity_ms);
+}
+
+bool bt_jitter_packet(bt_jitter_t *j, int64_t now_us, uint32_t duration_us,
+                      uint32_t capacity_ms) {
+  int64_t gap = now_us - j->last_arrival_us;
+  bool streaming = j->last_arrival_us != 0 && gap < JITTER_PAUSE_US;
+
+  if (streaming) {
+    /* RFC 3550 style: deviation of the gap from the audio it covered */
+    uint32_t d = (uint32_t)llabs(gap - (int64_t)j->last_duration_us);
+
+    j->dev_us = d;
+    j->jitter_us += ((int32_t)(d - j->jitter_us)) / 16;
+    if (d > j->peak_us) {
+      j->peak_us = d;
+    } else {
+      /* forget a one-off spike over a few hundred packets */
+      j->peak_us -= j->peak_us >> 9;
+    }
+  }
+  j->last_arrival_us = now_us;
+  j->last_duration_us = duration_us;
+  j->streaming = streaming;
+  if (!streaming) {
+    /* after a pause build the full depth again, or start short of it */
+    j->glitch = false;
+    j->starting = j->start_ms != 0;
+  }
+
+  /* an underrun only counts against us if the source kept sending; running
+   * dry at a pause or stream stop is expected
+   */
+  uint32_t underruns = atomic_load(&j->underruns);
+  if (underruns != j->underruns_seen) {
+    if (streaming) {
+      j->penalty_ms += JITTER_PENALTY_STEP_MS;
+      if (j->penalty_ms > JITTER_PENALTY_MAX_MS) {
+        j->penalty_ms = JITTER_PENALTY_MAX_MS;
+      }
+      j->glitch = true;
+    }
+    j->underruns_seen = underruns;
+    j->last_underrun_us = now_us;
+  } else if (j->penalty_ms &&
+             now_us - j->last_underrun_us > JITTER_PENALTY_DECAY_US) {
+    j->penalty_ms -= JITTER_PENALTY_STEP_MS;
+    j->last_underrun_us = now_us;
+  }
+
+  return bt_jitter_update_levels(j, capacity_ms);
+}
+
+bool bt_jitter_resumed(bt_jitter_t *j, uint32_t capacity_ms) {
+  if (!j->glitch && !j->starting) {
+    return false;
+  }
+  j->glitch = false;
+  j->starting = false;
+  return bt_jitter_update_levels(j, capacity_ms);
+}
+
+void bt_jitter_underrun(bt_jitter_t *j) { atomic_fetch_add(&j->underruns, 1); }
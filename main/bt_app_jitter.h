@@ -0,0 +1,104 @@
+#ifndef __BT_APP_JITTER_H__
+#define __BT_APP_JITTER_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* log tag */
+#define BT_JITTER_TAG "JITTER"
+
+/**
+ * Adaptive jitter buffer watermarks.
+ *
+ * The producer feeds every packet arrival into the estimator, which tracks
+ * how late packets arrive relative to the audio they carry. The target fill
+ * level follows that lateness plus a penalty for recent underruns, and the
+ * prefetch/drop thresholds are derived from the target. All levels are kept
+ * in milliseconds so that they hold for any sample rate. After a short
+ * mid-stream glitch playback restarts at half the target, since the
+ * concealment hides the gap and a quick restart keeps it short. With a
+ * start level set, a new stream starts at that level instead and the
+ * consumer lets the fill grow to the target by playing slightly slow.
+ */
+typedef struct {
+  uint32_t min_ms;           /*!< lower bound of the target */
+  uint32_t max_ms;           /*!< upper bound of the target */
+  uint32_t start_ms;         /*!< prefetch of a new stream, 0 for target */
+  int64_t last_arrival_us;   /*!< arrival time of the previous packet */
+  uint32_t last_duration_us; /*!< audio duration of the previous packet */
+  uint32_t dev_us;           /*!< deviation of the last packet */
+  bool streaming;            /*!< last packet continued a stream */
+  uint32_t jitter_us;        /*!< smoothed inter-arrival deviation */
+  uint32_t peak_us;          /*!< slowly decaying worst-case deviation */
+  uint32_t penalty_ms;       /*!< extra depth added after underruns */
+  int64_t last_underrun_us;  /*!< time the last underrun was noticed */
+  uint32_t underruns_seen;   /*!< underruns accounted for so far */
+  bool glitch;               /*!< ran dry mid-stream, restart sooner */
+  bool starting;             /*!< new stream, start at start_ms */
+  atomic_uint underruns;     /*!< underruns reported by the consumer */
+  uint32_t target_ms;        /*!< fill level playback aims for */
+  uint32_t prefetch_ms;      /*!< fill needed before playback (re)starts */
+  uint32_t high_ms;          /*!< fill above which incoming data is shed */
+} bt_jitter_t;
+
+/**
+ * @brief  reset the estimator to its initial watermarks
+ *
+ * @param [in] min_ms       lower bound of the target fill level
+ * @param [in] max_ms       upper bound of the target fill level
+ * @param [in] start_ms     prefetch level of a new stream, at least
+ *                          min_ms; 0 to always prefetch the full target
+ * @param [in] capacity_ms  ringbuffer capacity at the current format
+ */
+void bt_jitter_reset(bt_jitter_t *j, uint32_t min_ms, uint32_t max_ms,
+                     uint32_t start_ms, uint32_t capacity_ms);
+
+/**
+ * @brief  account for a packet arrival (producer only)
+ *
+ * @param [in] now_us       arrival timestamp
+ * @param [in] duration_us  audio duration carried by the packet
+ * @param [in] capacity_ms  ringbuffer capacity at the current format
+ *
+ * @return  true if the watermarks changed
+ */
+bool bt_jitter_packet(bt_jitter_t *j, int64_t now_us, uint32_t duration_us,
+                      uint32_t capacity_ms);
+
+/**
+ * @brief  playback has restarted after prefetching (producer only)
+ *
+ * @param [in] capacity_ms  ringbuffer capacity at the current format
+ *
+ * @return  true if the watermarks changed
+ */
+bool bt_jitter_resumed(bt_jitter_t *j, uint32_t capacity_ms);
+
+/**
+ * @brief  report a ringbuffer underrun (consumer, any context)
+ */
+void bt_jitter_underrun(bt_jitter_t *j);
+
+/**
+ * @brief  convert a duration in milliseconds to bytes of PCM
+ *
+ * @param [in] ms             duration
+ * @param [in] bytes_per_sec  byte rate of the current stream
+ */
+static inline uint32_t bt_jitter_ms_to_bytes(uint32_t ms,
+                                             uint32_t bytes_per_sec) {
+  /* keep whole 16-bit stereo frames */
+  return (uint32_t)((uint64_t)ms * bytes_per_sec / 1000) & ~3u;
+}
+
+/**
+ * @brief  convert a number of bytes of PCM to microseconds
+ */
+static inline uint32_t bt_jitter_bytes_to_us(uint32_t bytes,
+                                             uint32_t bytes_per_sec) {
+  return bytes_per_sec ? (uint32_t)((uint64_t)bytes * 1000000 / bytes_per_sec)
+                       : 0;
+}
+
+#endif /* __BT_APP_JITTER_H__ */
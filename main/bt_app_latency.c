@@ -0,0 +1,127 @@
+#include "bt_app_latency.h"
+
+#include <esp_log.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* reset one histogram */
+static void bt_latency_hist_reset(bt_hist_t *h);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static void bt_latency_hist_reset(bt_hist_t *h) {
+  for (int i = 0; i < BT_LATENCY_BUCKETS; i++) {
+    atomic_store(&h->bucket[i], 0);
+  }
+  atomic_store(&h->count, 0);
+  atomic_store(&h->max_us, 0);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_latency_reset(bt_latency_t *lat) {
+  atomic_store(&lat->head, 0);
+  atomic_store(&lat->tail, 0);
+  atomic_store(&lat->stamps_lost, 0);
+  bt_latency_hist_reset(&lat->jitter);
+  bt_latency_hist_reset(&lat->fill);
+  bt_latency_hist_reset(&lat->residency);
+  bt_latency_hist_reset(&lat->output);
+}
+
+void bt_latency_hist_add(bt_hist_t *h, uint32_t us) {
+  int i = us ? 32 - __builtin_clz(us) : 0;
+
+  if (i >= BT_LATENCY_BUCKETS) {
+    i = BT_LATENCY_BUCKETS - 1;
+  }
+  atomic_fetch_add_explicit(&h->bucket[i], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+  /* single writer, so a plain compare is enough */
+  if (us > atomic_load_explicit(&h->max_us, memory_order_relaxed)) {
+    atomic_store_explicit(&h->max_us, us, memory_order_relaxed);
+  }
+}
+
+void bt_latency_ingress(bt_latency_t *lat, uint32_t now_us, size_t end,
+                        uint32_t fill_us) {
+  unsigned head = atomic_load_explicit(&lat->head, memory_order_relaxed);
+  unsigned tail = atomic_load_explicit(&lat->tail, memory_order_acquire);
+
+  bt_latency_hist_add(&lat->fill, fill_us);
+  if (head - tail >= BT_LATENCY_STAMPS) {
+    atomic_fetch_add_explicit(&lat->stamps_lost, 1, memory_order_relaxed);
+    return;
+  }
+  bt_latency_stamp_t *s = &lat->stamp[head % BT_LATENCY_STAMPS];
+  s->end = end;
+  s->in_us = now_us;
+  atomic_store_explicit(&lat->head, head + 1, memory_order_release);
+}
+
+void bt_latency_egress(bt_latency_t *lat, size_t consumed, uint32_t read_us,
+                       uint32_t dac_us) {
+  unsigned tail = atomic_load_explicit(&lat->tail, memory_order_relaxed);
+  unsigned head = atomic_load_explicit(&lat->head, memory_order_acquire);
+
+  while (tail != head) {
+    const bt_latency_stamp_t *s = &lat->stamp[tail % BT_LATENCY_STAMPS];
+    /* indices run freely, compare through the signed difference */
+    if ((ptrdiff_t)(consumed - s->end) < 0) {
+      break;
+    }
+    bt_latency_hist_add(&lat->residency, read_us - s->in_us);
+    bt_latency_hist_add(&lat->output, dac_us - s->in_us);
+    tail++;
+  }
+  atomic_store_explicit(&lat->tail, tail, memory_order_release);
+}
+
+void bt_latency_hist_dump(const char *name, const bt_hist_t *h) {
+  uint32_t counts[BT_LATENCY_BUCKETS];
+  uint32_t total = 0;
+  uint32_t p50 = 0, p99 = 0;
+  char line[BT_LATENCY_BUCKETS * 8 + 1];
+  int len = 0;
+
+  for (int i = 0; i < BT_LATENCY_BUCKETS; i++) {
+    counts[i] = atomic_load_explicit(&h->bucket[i], memory_order_relaxed);
+    total += counts[i];
+  }
+  /* percentiles as bucket upper bounds */
+  for (uint32_t i = 0, seen = 0; i < BT_LATENCY_BUCKETS; i++) {
+    seen += counts[i];
+    if (!p50 && seen * 2 >= total) {
+      p50 = 1u << i;
+    }
+    if (!p99 && (uint64_t)seen * 100 >= (uint64_t)total * 99) {
+      p99 = 1u << i;
+    }
+  }
+  for (int i = 0; i < BT_LATENCY_BUCKETS && len < (int)sizeof(line); i++) {
+    len += snprintf(line + len, sizeof(line) - len, " %" PRIu32, counts[i]);
+  }
+
+  ESP_LOGI(BT_LATENCY_TAG,
+           "%s: n %" PRIu32 ", p50 < %" PRIu32 " us, p99 < %" PRIu32
+           " us, max %u us",
+           name, total, p50, p99, atomic_load(&h->max_us));
+  ESP_LOGI(BT_LATENCY_TAG, "%s log2 us:%s", name, line);
+}
+
+void bt_latency_dump(const bt_latency_t *lat) {
+  bt_latency_hist_dump("arrival jitter", &lat->jitter);
+  bt_latency_hist_dump("enqueue fill", &lat->fill);
+  bt_latency_hist_dump("ringbuffer residency", &lat->residency);
+  bt_latency_hist_dump("output latency", &lat->output);
+  ESP_LOGI(BT_LATENCY_TAG, "untracked packets: %u",
+           atomic_load(&lat->stamps_lost));
+}
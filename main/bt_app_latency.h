@@ -0,0 +1,93 @@
+#ifndef __BT_APP_LATENCY_H__
+#define __BT_APP_LATENCY_H__
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* log tag */
+#define BT_LATENCY_TAG "LATENCY"
+
+/* bucket 0 holds 0 us, bucket i holds [2^(i-1), 2^i) us, the last is open */
+#define BT_LATENCY_BUCKETS 20
+/* packets in flight that can be tracked through the ringbuffer */
+#define BT_LATENCY_STAMPS 64
+
+/**
+ * Streaming log2 histogram. Each one has a single writer; any task may read
+ * it while it is being updated.
+ */
+typedef struct {
+  atomic_uint bucket[BT_LATENCY_BUCKETS];
+  atomic_uint count;
+  atomic_uint max_us;
+} bt_hist_t;
+
+/* a packet on its way through the ringbuffer */
+typedef struct {
+  size_t end;     /*!< ringbuffer write index after the packet */
+  uint32_t in_us; /*!< ingress time */
+} bt_latency_stamp_t;
+
+/**
+ * Per-stage latency of the playback pipeline.
+ *
+ * The producer stamps every packet with its ingress time and the ringbuffer
+ * position it ends at. The consumer retires stamps once the read index has
+ * passed them, which gives the time spent in the ringbuffer, and adds the
+ * depth of the DMA queue behind it to get the time to the DAC.
+ */
+typedef struct {
+  bt_latency_stamp_t stamp[BT_LATENCY_STAMPS];
+  atomic_uint head;          /*!< written by the producer */
+  atomic_uint tail;          /*!< written by the consumer */
+  atomic_uint stamps_lost;   /*!< packets not tracked, queue full */
+  bt_hist_t jitter;          /*!< arrival deviation from the audio clock */
+  bt_hist_t fill;            /*!< ringbuffer fill at enqueue, in time */
+  bt_hist_t residency;       /*!< ingress until read out of the ringbuffer */
+  bt_hist_t output;          /*!< ingress until played by the DAC */
+} bt_latency_t;
+
+/**
+ * @brief  clear all histograms and stamps; neither side may be active
+ */
+void bt_latency_reset(bt_latency_t *lat);
+
+/**
+ * @brief  add a sample to a histogram (its single writer only)
+ */
+void bt_latency_hist_add(bt_hist_t *h, uint32_t us);
+
+/**
+ * @brief  stamp a packet written to the ringbuffer (producer only)
+ *
+ * @param [in] now_us   ingress time
+ * @param [in] end      ringbuffer write index after the packet
+ * @param [in] fill_us  ringbuffer fill before the packet, in time
+ */
+void bt_latency_ingress(bt_latency_t *lat, uint32_t now_us, size_t end,
+                        uint32_t fill_us);
+
+/**
+ * @brief  retire the packets the consumer has read (consumer only)
+ *
+ * @param [in] consumed  ringbuffer read index
+ * @param [in] read_us   time the data was read out
+ * @param [in] dac_us    time the last data read will reach the DAC
+ */
+void bt_latency_egress(bt_latency_t *lat, size_t consumed, uint32_t read_us,
+                       uint32_t dac_us);
+
+/**
+ * @brief  log one histogram; not for the audio path
+ *
+ * @param [in] name  label for the log lines
+ */
+void bt_latency_hist_dump(const char *name, const bt_hist_t *h);
+
+/**
+ * @brief  log all histograms; not for the audio path
+ */
+void bt_latency_dump(const bt_latency_t *lat);
+
+#endif /* __BT_APP_LATENCY_H__ */
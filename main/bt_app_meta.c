@@ -0,0 +1,128 @@
+#include "bt_app_meta.h"
+
+#include <string.h>
+
+/* UIDs that do not identify a track: "selected" and "none selected" */
+#define META_UID_SELECTED 0
+#define META_UID_NONE UINT64_MAX
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* index of an attribute bit, or -1 */
+static int bt_meta_attr_index(uint8_t attr_id);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static int bt_meta_attr_index(uint8_t attr_id) {
+  if (attr_id == 0 || (attr_id & (attr_id - 1)) ||
+      attr_id >= 1u << BT_META_ATTR_NUM) {
+    return -1;
+  }
+  return __builtin_ctz(attr_id);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_meta_reset(bt_meta_t *m) {
+  _lock_acquire(&m->lock);
+  memset(m->track, 0, sizeof(m->track));
+  m->current = NULL;
+  m->clock = 0;
+  _lock_release(&m->lock);
+}
+
+bool bt_meta_track_changed(bt_meta_t *m, const uint8_t *uid, uint8_t want) {
+  uint64_t key = 0;
+  bt_meta_track_t *t = NULL;
+  bool hit = false;
+
+  if (uid) {
+    for (int i = 0; i < 8; i++) {
+      key = key << 8 | uid[i];
+    }
+  }
+  if (key == META_UID_NONE) {
+    key = META_UID_SELECTED;
+  }
+
+  _lock_acquire(&m->lock);
+  if (key != META_UID_SELECTED) {
+    for (int i = 0; i < BT_META_TRACKS; i++) {
+      if (m->track[i].last_used && m->track[i].uid == key) {
+        t = &m->track[i];
+        hit = (t->attr_mask & want) == want;
+        break;
+      }
+    }
+  }
+  if (t == NULL) {
+    /* reuse a free entry, or the least recently used one */
+    t = &m->track[0];
+    for (int i = 1; i < BT_META_TRACKS; i++) {
+      if (m->track[i].last_used < t->last_used) {
+        t = &m->track[i];
+      }
+    }
+    t->uid = key;
+    t->attr_mask = 0;
+    t->attr_stored = 0;
+    t->text_used = 0;
+  }
+  t->last_used = ++m->clock;
+  m->current = t;
+  _lock_release(&m->lock);
+
+  return hit;
+}
+
+void bt_meta_set_attr(bt_meta_t *m, uint8_t attr_id, const uint8_t *text,
+                      int len) {
+  int idx = bt_meta_attr_index(attr_id);
+
+  if (idx < 0 || len < 0) {
+    return;
+  }
+
+  _lock_acquire(&m->lock);
+  bt_meta_track_t *t = m->current;
+  if (t && !(t->attr_stored & attr_id) && t->text_used < BT_META_TEXT_BYTES) {
+    /* truncate to whatever room is left, and only count it as received if
+     * nothing had to go; a refetch of the track then tries again
+     */
+    int room = BT_META_TEXT_BYTES - t->text_used - 1;
+    bool whole = len <= room;
+    if (!whole) {
+      len = room;
+    }
+    memcpy(t->text + t->text_used, text, len);
+    t->text[t->text_used + len] = '\0';
+    t->attr_off[idx] = t->text_used;
+    t->text_used += len + 1;
+    t->attr_stored |= attr_id;
+    if (whole) {
+      t->attr_mask |= attr_id;
+    }
+  }
+  _lock_release(&m->lock);
+}
+
+const char *bt_meta_attr(const bt_meta_track_t *track, uint8_t attr_id) {
+  int idx = bt_meta_attr_index(attr_id);
+
+  if (track == NULL || idx < 0 || !(track->attr_stored & attr_id)) {
+    return "";
+  }
+  return track->text + track->attr_off[idx];
+}
+
+void bt_meta_read(bt_meta_t *m, bt_meta_read_cb_t cb, void *ctx) {
+  _lock_acquire(&m->lock);
+  cb(m->current, ctx);
+  _lock_release(&m->lock);
+}
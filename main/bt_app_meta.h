@@ -0,0 +1,89 @@
+#ifndef __BT_APP_META_H__
+#define __BT_APP_META_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/lock.h>
+
+/* recent tracks kept */
+#define BT_META_TRACKS 4
+/* text bytes per track, all attributes together */
+#define BT_META_TEXT_BYTES 256
+/* AVRCP media attributes, title (0x1) to playing time (0x40) */
+#define BT_META_ATTR_NUM 7
+
+/* one track's attributes */
+typedef struct {
+  uint64_t uid;        /*!< AVRCP track UID, 0 if not cacheable */
+  uint32_t last_used;  /*!< LRU stamp, 0 for a free entry */
+  uint8_t attr_mask;   /*!< ESP_AVRC_MD_ATTR_* bits received in full */
+  uint8_t attr_stored; /*!< bits with text stored, possibly truncated */
+  uint16_t attr_off[BT_META_ATTR_NUM]; /*!< text offset per attribute */
+  uint16_t text_used;
+  char text[BT_META_TEXT_BYTES]; /*!< NUL terminated attribute strings */
+} bt_meta_track_t;
+
+/**
+ * Track metadata cache.
+ *
+ * Attributes of the current track are stored in a fixed text area of its
+ * entry. Entries are keyed by AVRCP track UID, so going back to one of the
+ * last few tracks needs no new metadata request. Sources without browsing
+ * report UID 0 for every track; such tracks are never looked up. Written by
+ * the app task, read by anyone through bt_meta_read().
+ */
+typedef struct {
+  bt_meta_track_t track[BT_META_TRACKS];
+  bt_meta_track_t *current; /*!< NULL before the first track */
+  uint32_t clock;           /*!< LRU time source */
+  _lock_t lock;
+} bt_meta_t;
+
+/**
+ * @brief  called with the current track while the cache is locked
+ *
+ * @param [in] track  current track, NULL if none; valid during the call only
+ * @param [in] ctx    caller context
+ */
+typedef void (*bt_meta_read_cb_t)(const bt_meta_track_t *track, void *ctx);
+
+/**
+ * @brief  forget all tracks, e.g. for a new peer
+ */
+void bt_meta_reset(bt_meta_t *m);
+
+/**
+ * @brief  switch to a new track
+ *
+ * @param [in] uid   8-byte big-endian track UID, NULL if unknown
+ * @param [in] want  ESP_AVRC_MD_ATTR_* bits the caller needs
+ *
+ * @return  true if the track was cached with all wanted attributes, false
+ *          if they have to be requested
+ */
+bool bt_meta_track_changed(bt_meta_t *m, const uint8_t *uid, uint8_t want);
+
+/**
+ * @brief  store an attribute of the current track
+ *
+ * Text that does not fit is kept truncated for display, but the attribute
+ * does not count as received, so the track is not a cache hit.
+ *
+ * @param [in] attr_id  one ESP_AVRC_MD_ATTR_* bit
+ * @param [in] text     attribute text, not necessarily terminated
+ * @param [in] len      text length in byte, negative if the text was lost
+ */
+void bt_meta_set_attr(bt_meta_t *m, uint8_t attr_id, const uint8_t *text,
+                      int len);
+
+/**
+ * @brief  attribute text of a track, possibly truncated; "" if not received
+ */
+const char *bt_meta_attr(const bt_meta_track_t *track, uint8_t attr_id);
+
+/**
+ * @brief  look at the current track without copying it
+ */
+void bt_meta_read(bt_meta_t *m, bt_meta_read_cb_t cb, void *ctx);
+
+#endif /* __BT_APP_META_H__ */
@@ -0,0 +1,72 @@
+#ifndef __BT_APP_OUT_H__
+#define __BT_APP_OUT_H__
+
+#include <sdkconfig.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* log tag */
+#define BT_OUT_TAG "OUT"
+
+/**
+ * @brief  the output has played a DMA buffer and it is free for refilling;
+ *         called in ISR context
+ *
+ * @param [in] buf  the buffer, NULL if the backend has none to offer
+ *
+ * @return  true if a higher priority task was woken
+ */
+typedef bool (*bt_out_sent_cb_t)(void *buf);
+
+/* output format and DMA geometry */
+typedef struct {
+  uint32_t sample_rate;    /*!< frames per second */
+  uint8_t ch;              /*!< channels of the stream, 1 or 2 */
+  uint8_t sample_bytes;    /*!< size of a rendered sample, 2 or 4 */
+  size_t desc_num;         /*!< DMA buffers */
+  size_t desc_frames;      /*!< frames per DMA buffer */
+  bt_out_sent_cb_t on_sent;
+} bt_out_cfg_t;
+
+/**
+ * Audio output backend.
+ *
+ * The audio engine renders interleaved PCM, 16-bit or left-justified
+ * 32-bit, one DMA buffer at a time and hands each span to the backend,
+ * which converts it if the hardware wants another format and queues it.
+ * The backend reports each buffer played through the on_sent callback,
+ * which is what paces the engine. Calls other than on_sent come from the
+ * engine's tasks, one at a time.
+ */
+typedef struct {
+  const char *name;
+  /* create the output, stopped */
+  void (*open)(const bt_out_cfg_t *cfg);
+  /* change the format or geometry while stopped */
+  void (*configure)(const bt_out_cfg_t *cfg);
+  /* start or stop the clocks; a stopped output plays nothing */
+  void (*enable)(bool enable);
+  /* queue one DMA buffer's worth of frames; may reuse the span as scratch */
+  void (*write)(void *span, size_t frames, uint8_t ch);
+  /* run the output clock off nominal by ppm, NULL if it can't */
+  void (*trim)(int32_t ppm);
+  /* release the output */
+  void (*close)(void);
+} bt_out_t;
+
+#if defined(CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC)
+extern const bt_out_t bt_out_dac;
+#define BT_OUT_BACKEND bt_out_dac
+#elif defined(CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_PDM)
+extern const bt_out_t bt_out_pdm;
+#define BT_OUT_BACKEND bt_out_pdm
+#elif defined(CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_NULL)
+extern const bt_out_t bt_out_null;
+#define BT_OUT_BACKEND bt_out_null
+#else
+extern const bt_out_t bt_out_i2s;
+#define BT_OUT_BACKEND bt_out_i2s
+#endif
+
+#endif /* __BT_APP_OUT_H__ */
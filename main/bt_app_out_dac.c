@@ -0,0 +1,140 @@
+#include "bt_app_out.h"
+
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
+
+#include <driver/dac_continuous.h>
+#include <esp_attr.h>
+#include <esp_err.h>
+#include <string.h>
+
+#include "bt_app_dither.h"
+
+/* longest a write may block; a buffer is free whenever one is written */
+#define DAC_WRITE_TIMEOUT_MS 100
+/* unsigned 8-bit midscale */
+#define DAC_SILENCE 0x80
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+static dac_continuous_handle_t s_dac = NULL;
+static bt_out_sent_cb_t s_on_sent = NULL;
+static bt_dither_t s_dither; /* 16 to 8 bit reduction */
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+/* DMA buffer converted, in ISR context */
+static bool bt_out_dac_sent(dac_continuous_handle_t handle,
+                            const dac_event_data_t *event, void *user_data);
+/* create the channels for a format and geometry */
+static void bt_out_dac_new_channels(const bt_out_cfg_t *cfg);
+static void bt_out_dac_open(const bt_out_cfg_t *cfg);
+static void bt_out_dac_configure(const bt_out_cfg_t *cfg);
+static void bt_out_dac_enable(bool enable);
+static void bt_out_dac_write(void *span, size_t frames, uint8_t ch);
+static void bt_out_dac_close(void);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+/**
+ * DMA sent
+ */
+static bool IRAM_ATTR bt_out_dac_sent(dac_continuous_handle_t handle,
+                                      const dac_event_data_t *event,
+                                      void *user_data) {
+  /* unlike I2S, the DMA would loop this buffer if nothing new comes; clear
+   * it so that a starved output goes quiet
+   */
+  memset(event->buf, DAC_SILENCE, event->buf_size);
+  return s_on_sent(event->buf);
+}
+
+/**
+ * new channels
+ */
+static void bt_out_dac_new_channels(const bt_out_cfg_t *cfg) {
+  /* stereo alternates between the two DACs; mono drives both the same */
+  dac_continuous_config_t dac_cfg = {
+      .chan_mask = DAC_CHANNEL_MASK_ALL,
+      .desc_num = cfg->desc_num,
+      .buf_size = cfg->desc_frames * cfg->ch,
+      .freq_hz = cfg->sample_rate,
+      .offset = 0,
+      .clk_src = DAC_DIGI_CLK_SRC_DEFAULT,
+      .chan_mode =
+          cfg->ch == 2 ? DAC_CHANNEL_MODE_ALTER : DAC_CHANNEL_MODE_SIMUL,
+  };
+  const dac_event_callbacks_t cbs = {.on_convert_done = bt_out_dac_sent};
+
+  ESP_ERROR_CHECK(dac_continuous_new_channels(&dac_cfg, &s_dac));
+  ESP_ERROR_CHECK(dac_continuous_register_event_callback(s_dac, &cbs, NULL));
+}
+
+/**
+ * open
+ */
+static void bt_out_dac_open(const bt_out_cfg_t *cfg) {
+  s_on_sent = cfg->on_sent;
+  bt_dither_reset(&s_dither);
+  bt_out_dac_new_channels(cfg);
+}
+
+/**
+ * configure
+ */
+static void bt_out_dac_configure(const bt_out_cfg_t *cfg) {
+  /* the continuous DAC driver has no reconfiguration; start over */
+  dac_continuous_del_channels(s_dac);
+  bt_dither_reset(&s_dither);
+  bt_out_dac_new_channels(cfg);
+}
+
+/**
+ * enable
+ */
+static void bt_out_dac_enable(bool enable) {
+  if (enable) {
+    dac_continuous_enable(s_dac);
+  } else {
+    dac_continuous_disable(s_dac);
+  }
+}
+
+/**
+ * write
+ */
+static void bt_out_dac_write(void *span, size_t frames, uint8_t ch) {
+  size_t loaded = 0;
+
+  /* narrow in place: the 8-bit samples fit in the first half of the span */
+  bt_dither_to_u8(&s_dither, (const int16_t *)span, (uint8_t *)span, frames,
+                  ch);
+  dac_continuous_write(s_dac, (uint8_t *)span, frames * ch, &loaded,
+                       DAC_WRITE_TIMEOUT_MS);
+}
+
+/**
+ * close
+ */
+static void bt_out_dac_close(void) {
+  dac_continuous_del_channels(s_dac);
+  s_dac = NULL;
+}
+
+/********************************
+ * EXTERNAL VARIABLE DEFINITIONS
+ *******************************/
+
+const bt_out_t bt_out_dac = {
+    .name = "internal DAC",
+    .open = bt_out_dac_open,
+    .configure = bt_out_dac_configure,
+    .enable = bt_out_dac_enable,
+    .write = bt_out_dac_write,
+    .close = bt_out_dac_close,
+};
+
+#endif /* CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC */
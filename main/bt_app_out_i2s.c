@@ -0,0 +1,299 @@
+#include "bt_app_out.h"
+
+#if defined(CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_EXTERNAL_I2S) || \
+    defined(CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_PDM)
+
+#include <driver/i2s_pdm.h>
+#include <driver/i2s_std.h>
+#include <esp_attr.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <string.h>
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+#include "clk_ctrl_os.h"
+#endif
+
+/* longest a write may block; a descriptor is free whenever one is written */
+#define I2S_WRITE_TIMEOUT_MS 100
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+static i2s_chan_handle_t s_chan = NULL;
+static bt_out_sent_cb_t s_on_sent = NULL;
+static size_t s_desc_num = 0; /* DMA geometry and format of the channel */
+static size_t s_desc_frames = 0;
+static uint8_t s_sample_bytes = 0;
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+static uint32_t s_apll_hz;     /* APLL frequency the driver chose */
+static uint32_t s_apll_hz_set; /* and as trimmed */
+static int32_t s_apll_ppm;     /* trim asked for */
+static bool s_apll_fixed;      /* shared with another peripheral: no trim */
+#endif
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+/* DMA descriptor sent, in ISR context */
+static bool bt_out_i2s_sent(i2s_chan_handle_t handle, i2s_event_data_t *event,
+                            void *user_ctx);
+/* create the channel for a format and geometry */
+static void bt_out_i2s_new_channel(const bt_out_cfg_t *cfg);
+/* set the clocks and slots of the existing channel */
+static void bt_out_i2s_reconfig(uint32_t rate, uint8_t ch);
+/* driver data width for a sample size */
+static i2s_data_bit_width_t bt_out_i2s_bits(uint8_t sample_bytes);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+/* note the APLL frequency the driver chose for a clock configuration */
+static void bt_out_i2s_apll_setup(const i2s_std_clk_config_t *clk_cfg);
+static void bt_out_i2s_trim(int32_t ppm);
+#endif
+static void bt_out_i2s_open(const bt_out_cfg_t *cfg);
+static void bt_out_i2s_configure(const bt_out_cfg_t *cfg);
+static void bt_out_i2s_enable(bool enable);
+static void bt_out_i2s_write(void *span, size_t frames, uint8_t ch);
+static void bt_out_i2s_close(void);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+/**
+ * DMA sent
+ */
+static bool IRAM_ATTR bt_out_i2s_sent(i2s_chan_handle_t handle,
+                                      i2s_event_data_t *event,
+                                      void *user_ctx) {
+  /* the driver passes the address of the descriptor's buffer pointer; the
+   * buffer plays again after the others. It is cleared here rather than by
+   * the driver, which would do so only after this returns and so race the
+   * engine refilling it
+   */
+  uint8_t *buf = *(uint8_t **)event->data;
+
+  memset(buf, 0, event->size);
+  return s_on_sent(buf);
+}
+
+/**
+ * bits
+ */
+static i2s_data_bit_width_t bt_out_i2s_bits(uint8_t sample_bytes) {
+  return sample_bytes == 4 ? I2S_DATA_BIT_WIDTH_32BIT
+                           : I2S_DATA_BIT_WIDTH_16BIT;
+}
+
+/**
+ * new channel
+ */
+static void bt_out_i2s_new_channel(const bt_out_cfg_t *cfg) {
+  i2s_chan_config_t chan_cfg =
+      I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+  /* a sent buffer is cleared in on_sent, before the engine sees it */
+  chan_cfg.auto_clear = false;
+  chan_cfg.dma_desc_num = cfg->desc_num;
+  chan_cfg.dma_frame_num = cfg->desc_frames;
+  ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &s_chan, NULL));
+  s_desc_num = cfg->desc_num;
+  s_desc_frames = cfg->desc_frames;
+  s_sample_bytes = cfg->sample_bytes;
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_PDM
+  i2s_pdm_tx_config_t pdm_cfg = {
+      .clk_cfg = I2S_PDM_TX_CLK_DEFAULT_CONFIG(cfg->sample_rate),
+      .slot_cfg = I2S_PDM_TX_SLOT_DEFAULT_CONFIG(
+          bt_out_i2s_bits(cfg->sample_bytes), cfg->ch),
+      .gpio_cfg =
+          {
+              .clk = CONFIG_EXAMPLE_I2S_BCK_PIN,
+              .dout = CONFIG_EXAMPLE_I2S_DATA_PIN,
+              .invert_flags =
+                  {
+                      .clk_inv = false,
+                  },
+          },
+  };
+  ESP_ERROR_CHECK(i2s_channel_init_pdm_tx_mode(s_chan, &pdm_cfg));
+#else
+  i2s_std_config_t std_cfg = {
+      .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(cfg->sample_rate),
+      .slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(
+          bt_out_i2s_bits(cfg->sample_bytes), cfg->ch),
+      .gpio_cfg =
+          {
+              .mclk = I2S_GPIO_UNUSED,
+              .bclk = CONFIG_EXAMPLE_I2S_BCK_PIN,
+              .ws = CONFIG_EXAMPLE_I2S_LRCK_PIN,
+              .dout = CONFIG_EXAMPLE_I2S_DATA_PIN,
+              .din = I2S_GPIO_UNUSED,
+              .invert_flags =
+                  {
+                      .mclk_inv = false,
+                      .bclk_inv = false,
+                      .ws_inv = false,
+                  },
+          },
+  };
+  std_cfg.slot_cfg.bit_shift = true;  // required for PCM5102 I2S format
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+  std_cfg.clk_cfg.clk_src = I2S_CLK_SRC_APLL;
+#endif
+  ESP_ERROR_CHECK(i2s_channel_init_std_mode(s_chan, &std_cfg));
+#endif
+  const i2s_event_callbacks_t cbs = {.on_sent = bt_out_i2s_sent};
+  ESP_ERROR_CHECK(i2s_channel_register_event_callback(s_chan, &cbs, NULL));
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+  bt_out_i2s_apll_setup(&std_cfg.clk_cfg);
+#endif
+}
+
+/**
+ * reconfig
+ */
+static void bt_out_i2s_reconfig(uint32_t rate, uint8_t ch) {
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_PDM
+  i2s_pdm_tx_clk_config_t clk_cfg = I2S_PDM_TX_CLK_DEFAULT_CONFIG(rate);
+  i2s_pdm_tx_slot_config_t slot_cfg =
+      I2S_PDM_TX_SLOT_DEFAULT_CONFIG(bt_out_i2s_bits(s_sample_bytes), ch);
+  i2s_channel_reconfig_pdm_tx_clock(s_chan, &clk_cfg);
+  i2s_channel_reconfig_pdm_tx_slot(s_chan, &slot_cfg);
+#else
+  i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(rate);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+  clk_cfg.clk_src = I2S_CLK_SRC_APLL;
+#endif
+  i2s_std_slot_config_t slot_cfg =
+      I2S_STD_MSB_SLOT_DEFAULT_CONFIG(bt_out_i2s_bits(s_sample_bytes), ch);
+  slot_cfg.bit_shift = true;  // required for PCM5102 I2S format
+  i2s_channel_reconfig_std_clock(s_chan, &clk_cfg);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+  bt_out_i2s_apll_setup(&clk_cfg);
+#endif
+  i2s_channel_reconfig_std_slot(s_chan, &slot_cfg);
+#endif
+}
+
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+/**
+ * APLL setup
+ */
+static void bt_out_i2s_apll_setup(const i2s_std_clk_config_t *clk_cfg) {
+  /* the driver runs the APLL at the smallest multiple of MCLK above the
+   * APLL's lowest frequency, but at least twice MCLK, and divides it down
+   * from there; the trim has to start from that same frequency
+   */
+  uint32_t mclk = clk_cfg->sample_rate_hz * clk_cfg->mclk_multiple;
+  uint32_t div = CONFIG_SOC_APLL_MIN_HZ / mclk + 1;
+  if (div < 2) {
+    div = 2;
+  }
+  s_apll_hz = mclk * div;
+  s_apll_hz_set = s_apll_hz;
+  s_apll_fixed = false;
+  /* keep the trim already learned; the source's clock hasn't moved */
+  bt_out_i2s_trim(s_apll_ppm);
+}
+
+/**
+ * APLL trim
+ */
+static void bt_out_i2s_trim(int32_t ppm) {
+  uint32_t real;
+
+  /* the APLL's fractional multiplier moves it in steps of one or two ppm */
+  uint32_t hz = s_apll_hz + (int32_t)((int64_t)s_apll_hz * ppm / 1000000);
+
+  s_apll_ppm = ppm;
+  if (s_apll_fixed || hz == s_apll_hz_set) {
+    return;
+  }
+  esp_err_t err = periph_rtc_apll_freq_set(hz, &real);
+  if (err != ESP_OK) {
+    /* another peripheral holds the APLL and it won't move under it */
+    ESP_LOGW(BT_OUT_TAG, "APLL trim off: %s", esp_err_to_name(err));
+    s_apll_fixed = true;
+    return;
+  }
+  s_apll_hz_set = hz;
+}
+#endif
+
+/**
+ * open
+ */
+static void bt_out_i2s_open(const bt_out_cfg_t *cfg) {
+  s_on_sent = cfg->on_sent;
+  bt_out_i2s_new_channel(cfg);
+}
+
+/**
+ * configure
+ */
+static void bt_out_i2s_configure(const bt_out_cfg_t *cfg) {
+  if (cfg->desc_num != s_desc_num || cfg->desc_frames != s_desc_frames ||
+      cfg->sample_bytes != s_sample_bytes) {
+    /* the DMA buffers are allocated with the channel */
+    i2s_del_channel(s_chan);
+    bt_out_i2s_new_channel(cfg);
+    return;
+  }
+  bt_out_i2s_reconfig(cfg->sample_rate, cfg->ch);
+}
+
+/**
+ * enable
+ */
+static void bt_out_i2s_enable(bool enable) {
+  if (enable) {
+    i2s_channel_enable(s_chan);
+  } else {
+    i2s_channel_disable(s_chan);
+  }
+}
+
+/**
+ * write
+ */
+static void bt_out_i2s_write(void *span, size_t frames, uint8_t ch) {
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ZERO_COPY
+  /* the engine rendered straight into the DMA buffer */
+  (void)span;
+#else
+  size_t bytes_written = 0;
+  /* a descriptor is free, so this copies and returns at once */
+  i2s_channel_write(s_chan, span, frames * ch * s_sample_bytes,
+                    &bytes_written, I2S_WRITE_TIMEOUT_MS);
+#endif
+}
+
+/**
+ * close
+ */
+static void bt_out_i2s_close(void) {
+  i2s_del_channel(s_chan);
+  s_chan = NULL;
+  s_desc_num = 0;
+  s_desc_frames = 0;
+}
+
+/********************************
+ * EXTERNAL VARIABLE DEFINITIONS
+ *******************************/
+
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_PDM
+const bt_out_t bt_out_pdm = {
+    .name = "PDM",
+#else
+const bt_out_t bt_out_i2s = {
+    .name = "I2S",
+#endif
+    .open = bt_out_i2s_open,
+    .configure = bt_out_i2s_configure,
+    .enable = bt_out_i2s_enable,
+    .write = bt_out_i2s_write,
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_APLL
+    .trim = bt_out_i2s_trim,
+#endif
+    .close = bt_out_i2s_close,
+};
+
+#endif /* CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_EXTERNAL_I2S || ..._PDM */
@@ -0,0 +1,101 @@
+#include "bt_app_out.h"
+
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_NULL
+
+#include <esp_err.h>
+#include <esp_timer.h>
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+static esp_timer_handle_t s_timer = NULL; /* stands in for the DMA */
+static bt_out_sent_cb_t s_on_sent = NULL;
+static uint64_t s_period_us = 0;          /* play time of one buffer */
+static bool s_enabled = false;
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+/* one buffer's worth of time has passed */
+static void bt_out_null_tick(void *arg);
+static void bt_out_null_open(const bt_out_cfg_t *cfg);
+static void bt_out_null_configure(const bt_out_cfg_t *cfg);
+static void bt_out_null_enable(bool enable);
+static void bt_out_null_write(void *span, size_t frames, uint8_t ch);
+static void bt_out_null_close(void);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+/**
+ * tick
+ */
+static void bt_out_null_tick(void *arg) {
+  /* from the timer task rather than an ISR; the engine only notifies */
+  s_on_sent(NULL);
+}
+
+/**
+ * open
+ */
+static void bt_out_null_open(const bt_out_cfg_t *cfg) {
+  const esp_timer_create_args_t args = {
+      .callback = bt_out_null_tick,
+      .name = "out_null",
+  };
+
+  s_on_sent = cfg->on_sent;
+  ESP_ERROR_CHECK(esp_timer_create(&args, &s_timer));
+  bt_out_null_configure(cfg);
+}
+
+/**
+ * configure
+ */
+static void bt_out_null_configure(const bt_out_cfg_t *cfg) {
+  s_period_us = (uint64_t)cfg->desc_frames * 1000000 / cfg->sample_rate;
+}
+
+/**
+ * enable
+ */
+static void bt_out_null_enable(bool enable) {
+  if (enable && !s_enabled) {
+    esp_timer_start_periodic(s_timer, s_period_us);
+  } else if (!enable && s_enabled) {
+    esp_timer_stop(s_timer);
+  }
+  s_enabled = enable;
+}
+
+/**
+ * write
+ */
+static void bt_out_null_write(void *span, size_t frames, uint8_t ch) {
+  /* discard; the engine's stats show what the rendering cost */
+}
+
+/**
+ * close
+ */
+static void bt_out_null_close(void) {
+  bt_out_null_enable(false);
+  esp_timer_delete(s_timer);
+  s_timer = NULL;
+}
+
+/********************************
+ * EXTERNAL VARIABLE DEFINITIONS
+ *******************************/
+
+const bt_out_t bt_out_null = {
+    .name = "null",
+    .open = bt_out_null_open,
+    .configure = bt_out_null_configure,
+    .enable = bt_out_null_enable,
+    .write = bt_out_null_write,
+    .close = bt_out_null_close,
+};
+
+#endif /* CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_NULL */
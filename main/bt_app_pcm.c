@@ -0,0 +1,30 @@
+#include "bt_app_pcm.h"
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_pcm_widen(int32_t *buf, size_t samples) {
+  const int16_t *in = (const int16_t *)buf;
+
+  /* each wide sample covers two narrow ones from the same or a later
+   * index, so working backwards never overwrites one still to be read
+   */
+  for (size_t i = samples; i-- > 0;) {
+    buf[i] = (int32_t)in[i] * (1 << BT_PCM_WIDE_SHIFT);
+  }
+}
+
+void bt_pcm_to_slot32(int32_t *buf, size_t samples) {
+  const int shift = 31 - (15 + BT_PCM_WIDE_SHIFT);
+
+  for (size_t i = 0; i < samples; i++) {
+    int32_t s = buf[i];
+    if (s > BT_PCM_WIDE_MAX) {
+      s = BT_PCM_WIDE_MAX;
+    } else if (s < -BT_PCM_WIDE_MAX - 1) {
+      s = -BT_PCM_WIDE_MAX - 1;
+    }
+    buf[i] = (int32_t)((uint32_t)s << shift);
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef __BT_APP_PCM_H__
+#define __BT_APP_PCM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 16-bit samples sit this many bits up in the 32-bit processing format */
+#define BT_PCM_WIDE_SHIFT 8
+/* full scale of the processing format; the bits above are headroom */
+#define BT_PCM_WIDE_MAX ((1 << (15 + BT_PCM_WIDE_SHIFT)) - 1)
+
+/**
+ * 32-bit processing format.
+ *
+ * Samples are 24-bit fractions in 32-bit words, so that a gain or filter
+ * keeps the bits it shifts down, and a boost has 8 bits of headroom until
+ * the final conversion to the output slot. 24 bits is the resolution of
+ * the DACs this drives, so that conversion only saturates and needs no
+ * dither.
+ */
+
+/**
+ * @brief  widen 16-bit samples to the processing format, in place
+ *
+ * @param [in,out] buf      16-bit samples packed at the start, the same
+ *                          number of 32-bit samples on return
+ * @param [in]     samples  number of samples (frames times channels)
+ */
+void bt_pcm_widen(int32_t *buf, size_t samples);
+
+/**
+ * @brief  convert processed samples to left-justified 32-bit output slots,
+ *         in place, saturating what went past full scale
+ *
+ * @param [in,out] buf      samples
+ * @param [in]     samples  number of samples (frames times channels)
+ */
+void bt_pcm_to_slot32(int32_t *buf, size_t samples);
+
+#endif /* __BT_APP_PCM_H__ */
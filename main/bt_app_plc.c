@@ -0,0 +1,110 @@
+#include "bt_app_plc.h"
+
+#include <string.h>
+
+/* concealment fades out over this long */
+#define PLC_FADE_MS 30
+/* returning audio is crossfaded in over this long */
+#define PLC_XFADE_MS 5
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* concealment sample `n` frames into a gap */
+static int32_t bt_plc_sample(const bt_plc_t *plc, uint32_t n, uint8_t c);
+/* append output frames to the history */
+static void bt_plc_record(bt_plc_t *plc, const int16_t *buf, size_t frames);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static int32_t bt_plc_sample(const bt_plc_t *plc, uint32_t n, uint8_t c) {
+  const uint32_t h = plc->hist_frames;
+  const int16_t(*hist)[BT_PLC_MAX_CH] =
+      plc->hist + (BT_PLC_HIST_FRAMES - h);
+  int32_t s;
+
+  if (n >= plc->fade || h == 0) {
+    return 0;
+  }
+  if (h == 1) {
+    s = hist[0][c];
+  } else {
+    /* reflect back and forth over the history, starting next to the last
+     * real sample so that the join has no step
+     */
+    uint32_t period = 2 * (h - 1);
+    uint32_t k = (n + 1) % period;
+    s = hist[k < h ? h - 1 - k : k - (h - 1)][c];
+  }
+  return s * (int32_t)(plc->fade - n) / (int32_t)plc->fade;
+}
+
+static void bt_plc_record(bt_plc_t *plc, const int16_t *buf, size_t frames) {
+  const size_t frame_bytes = plc->ch * sizeof(int16_t);
+
+  if (frames >= BT_PLC_HIST_FRAMES) {
+    buf += (frames - BT_PLC_HIST_FRAMES) * plc->ch;
+    frames = BT_PLC_HIST_FRAMES;
+  } else {
+    memmove(plc->hist, plc->hist + frames,
+            (BT_PLC_HIST_FRAMES - frames) * sizeof(plc->hist[0]));
+  }
+  int16_t(*dst)[BT_PLC_MAX_CH] = plc->hist + (BT_PLC_HIST_FRAMES - frames);
+  if (frame_bytes == sizeof(plc->hist[0])) {
+    memcpy(dst, buf, frames * frame_bytes);
+  } else {
+    for (size_t i = 0; i < frames; i++) {
+      dst[i][0] = buf[i * plc->ch];
+    }
+  }
+
+  plc->hist_frames += frames;
+  if (plc->hist_frames > BT_PLC_HIST_FRAMES) {
+    plc->hist_frames = BT_PLC_HIST_FRAMES;
+  }
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_plc_reset(bt_plc_t *plc, uint8_t ch, uint32_t sample_rate) {
+  memset(plc, 0, sizeof(*plc));
+  plc->ch = ch > BT_PLC_MAX_CH ? BT_PLC_MAX_CH : ch;
+  plc->sample_rate = sample_rate;
+  plc->fade = sample_rate * PLC_FADE_MS / 1000;
+  plc->xfade = sample_rate * PLC_XFADE_MS / 1000;
+  plc->xfade_pos = plc->xfade;
+}
+
+void bt_plc_good(bt_plc_t *plc, int16_t *buf, size_t frames) {
+  if (plc->gap) {
+    plc->resume_gap = plc->gap;
+    plc->xfade_pos = 0;
+    plc->gap = 0;
+  }
+
+  for (size_t i = 0; i < frames && plc->xfade_pos < plc->xfade; i++) {
+    const int32_t w = (int32_t)(plc->xfade_pos * 32768 / plc->xfade);
+    for (uint8_t c = 0; c < plc->ch; c++) {
+      int32_t old = bt_plc_sample(plc, plc->resume_gap + plc->xfade_pos, c);
+      int16_t *p = &buf[i * plc->ch + c];
+      *p = (int16_t)((*p * w + old * (32768 - w)) >> 15);
+    }
+    plc->xfade_pos++;
+  }
+
+  bt_plc_record(plc, buf, frames);
+}
+
+void bt_plc_conceal(bt_plc_t *plc, int16_t *out, size_t frames) {
+  for (size_t i = 0; i < frames; i++) {
+    for (uint8_t c = 0; c < plc->ch; c++) {
+      out[i * plc->ch + c] = (int16_t)bt_plc_sample(plc, plc->gap, c);
+    }
+    plc->gap++;
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef __BT_APP_PLC_H__
+#define __BT_APP_PLC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* frames of past output kept for extrapolation */
+#define BT_PLC_HIST_FRAMES 256
+/* channels handled */
+#define BT_PLC_MAX_CH 2
+
+/**
+ * Packet loss concealment for ringbuffer underflows.
+ *
+ * While audio flows the last frames are kept. When the ringbuffer runs dry
+ * the output continues as a mirror image of that history, which joins the
+ * real signal without a step, and fades to silence over `fade` frames. When
+ * data returns it is crossfaded in against the continuing concealment.
+ */
+typedef struct {
+  int16_t hist[BT_PLC_HIST_FRAMES][BT_PLC_MAX_CH]; /*!< oldest first */
+  uint32_t hist_frames; /*!< valid frames at the end of hist */
+  uint32_t gap;         /*!< frames concealed in the current gap */
+  uint32_t resume_gap;  /*!< concealment position the crossfade runs from */
+  uint32_t xfade_pos;   /*!< crossfade progress, == xfade when done */
+  uint32_t fade;        /*!< fade out length in frames */
+  uint32_t xfade;       /*!< crossfade length in frames */
+  uint32_t sample_rate;
+  uint8_t ch;
+} bt_plc_t;
+
+/**
+ * @brief  forget history and size the fades for a format
+ */
+void bt_plc_reset(bt_plc_t *plc, uint8_t ch, uint32_t sample_rate);
+
+/**
+ * @brief  pass real audio through, crossfading in after a gap
+ *
+ * @param [in,out] buf     interleaved samples
+ * @param [in]     frames  number of frames
+ */
+void bt_plc_good(bt_plc_t *plc, int16_t *buf, size_t frames);
+
+/**
+ * @brief  produce concealment audio for a gap
+ *
+ * @param [out] out     interleaved samples
+ * @param [in]  frames  number of frames
+ */
+void bt_plc_conceal(bt_plc_t *plc, int16_t *out, size_t frames);
+
+/**
+ * @brief  true while a gap is being concealed
+ */
+static inline bool bt_plc_concealing(const bt_plc_t *plc) {
+  return plc->gap > 0;
+}
+
+/**
+ * @brief  true once the concealment has faded out completely
+ */
+static inline bool bt_plc_faded(const bt_plc_t *plc) {
+  return plc->gap >= plc->fade;
+}
+
+#endif /* __BT_APP_PLC_H__ */
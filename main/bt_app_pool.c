@@ -0,0 +1,128 @@
+#include "bt_app_pool.h"
+
+/* arena allocation header: length of the block including the header, and
+ * the top bit once it has been freed
+ */
+#define ARENA_FREED 0x80000000u
+#define ARENA_HDR sizeof(uint32_t)
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* raise a high-water mark to at least `value` */
+static void bt_pool_raise(atomic_uint *mark, uint32_t value);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static void bt_pool_raise(atomic_uint *mark, uint32_t value) {
+  unsigned cur = atomic_load_explicit(mark, memory_order_relaxed);
+  while (value > cur && !atomic_compare_exchange_weak_explicit(
+                            mark, &cur, value, memory_order_relaxed,
+                            memory_order_relaxed)) {
+  }
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_pool_init(bt_pool_t *pool, void *storage, size_t block_size,
+                  uint32_t count) {
+  if (count > BT_POOL_MAX_BLOCKS) {
+    count = BT_POOL_MAX_BLOCKS;
+  }
+  pool->storage = (uint8_t *)storage;
+  pool->block_size = block_size;
+  pool->count = count;
+  atomic_store(&pool->free_mask,
+               count == 32 ? 0xffffffffu : (1u << count) - 1);
+  atomic_store(&pool->high_water, 0);
+  atomic_store(&pool->exhausted, 0);
+}
+
+void *bt_pool_alloc(bt_pool_t *pool) {
+  unsigned mask = atomic_load_explicit(&pool->free_mask, memory_order_relaxed);
+  unsigned bit;
+
+  do {
+    if (mask == 0) {
+      atomic_fetch_add_explicit(&pool->exhausted, 1, memory_order_relaxed);
+      return NULL;
+    }
+    bit = mask & -mask;
+  } while (!atomic_compare_exchange_weak_explicit(&pool->free_mask, &mask,
+                                                  mask & ~bit,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed));
+
+  bt_pool_raise(&pool->high_water,
+                pool->count - __builtin_popcount(mask & ~bit));
+  return pool->storage + __builtin_ctz(bit) * pool->block_size;
+}
+
+void bt_pool_free(bt_pool_t *pool, void *block) {
+  size_t idx = ((uint8_t *)block - pool->storage) / pool->block_size;
+  atomic_fetch_or_explicit(&pool->free_mask, 1u << idx, memory_order_release);
+}
+
+void bt_arena_init(bt_arena_t *arena, void *storage, uint32_t size) {
+  arena->buf = (uint8_t *)storage;
+  arena->size = size;
+  atomic_store(&arena->head, 0);
+  atomic_store(&arena->tail, 0);
+  atomic_store(&arena->high_water, 0);
+  atomic_store(&arena->exhausted, 0);
+}
+
+void *bt_arena_alloc(bt_arena_t *arena, size_t len) {
+  unsigned head = atomic_load_explicit(&arena->head, memory_order_relaxed);
+  unsigned tail = atomic_load_explicit(&arena->tail, memory_order_acquire);
+  uint32_t need = (ARENA_HDR + len + 3) & ~3u;
+  uint32_t offset = head & (arena->size - 1);
+  uint32_t pad = 0;
+
+  /* allocations never wrap; skip the end of the ring if it is too short */
+  if (offset + need > arena->size) {
+    pad = arena->size - offset;
+  }
+  if (need > arena->size || head - tail + pad + need > arena->size) {
+    atomic_fetch_add_explicit(&arena->exhausted, 1, memory_order_relaxed);
+    return NULL;
+  }
+  if (pad) {
+    *(uint32_t *)(arena->buf + offset) = pad | ARENA_FREED;
+    offset = 0;
+  }
+  *(uint32_t *)(arena->buf + offset) = need;
+
+  head += pad + need;
+  bt_pool_raise(&arena->high_water, head - tail);
+  atomic_store_explicit(&arena->head, head, memory_order_release);
+  return arena->buf + offset + ARENA_HDR;
+}
+
+void bt_arena_free(bt_arena_t *arena, void *p) {
+  uint32_t *hdr = (uint32_t *)((uint8_t *)p - ARENA_HDR);
+
+  *hdr |= ARENA_FREED;
+
+  /* reclaim every freed block at the old end; compare-and-swap so that
+   * concurrent frees never move the tail twice over the same block
+   */
+  unsigned tail = atomic_load_explicit(&arena->tail, memory_order_acquire);
+  while (tail != atomic_load_explicit(&arena->head, memory_order_acquire)) {
+    uint32_t h = *(uint32_t *)(arena->buf + (tail & (arena->size - 1)));
+    if (!(h & ARENA_FREED)) {
+      break;
+    }
+    unsigned next = tail + (h & ~ARENA_FREED);
+    if (atomic_compare_exchange_weak_explicit(&arena->tail, &tail, next,
+                                              memory_order_release,
+                                              memory_order_acquire)) {
+      tail = next;
+    }
+  }
+}
@@ -0,0 +1,104 @@
+#ifndef __BT_APP_POOL_H__
+#define __BT_APP_POOL_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* most blocks a pool can hold, one bit each in the free mask */
+#define BT_POOL_MAX_BLOCKS 32
+
+/**
+ * Fixed-size block pool.
+ *
+ * Free blocks are tracked in a single bitmap which is claimed and released
+ * with compare-and-swap, so any task or callback context may allocate or
+ * free without a lock.
+ */
+typedef struct {
+  uint8_t *storage;       /*!< count * block_size bytes */
+  size_t block_size;      /*!< bytes per block */
+  uint32_t count;         /*!< number of blocks */
+  atomic_uint free_mask;  /*!< bit set for every free block */
+  atomic_uint high_water; /*!< most blocks ever in use at once */
+  atomic_uint exhausted;  /*!< allocations that found no free block */
+} bt_pool_t;
+
+/**
+ * @brief  initialise a pool over caller-provided storage
+ *
+ * @param [in] storage     count * block_size bytes, suitably aligned
+ * @param [in] block_size  bytes per block
+ * @param [in] count       number of blocks, at most BT_POOL_MAX_BLOCKS
+ */
+void bt_pool_init(bt_pool_t *pool, void *storage, size_t block_size,
+                  uint32_t count);
+
+/**
+ * @brief  take a block
+ *
+ * @return  the block, or NULL if all are in use
+ */
+void *bt_pool_alloc(bt_pool_t *pool);
+
+/**
+ * @brief  return a block taken with bt_pool_alloc()
+ */
+void bt_pool_free(bt_pool_t *pool, void *block);
+
+/**
+ * @brief  true if `p` points into the pool's storage
+ */
+static inline bool bt_pool_owns(const bt_pool_t *pool, const void *p) {
+  const uint8_t *b = (const uint8_t *)p;
+  return b >= pool->storage &&
+         b < pool->storage + pool->count * pool->block_size;
+}
+
+/**
+ * Variable-size arena for short-lived strings.
+ *
+ * Allocations are carved from a ring in order, each behind a small header.
+ * Space is reclaimed from the oldest end once its allocations are freed, so
+ * frees in any order are allowed but reuse follows allocation order. One
+ * context allocates; any context may free.
+ */
+typedef struct {
+  uint8_t *buf;           /*!< ring storage */
+  uint32_t size;          /*!< capacity in bytes, a power of two */
+  atomic_uint head;       /*!< next allocation, written by the allocator */
+  atomic_uint tail;       /*!< oldest live allocation, moved by frees */
+  atomic_uint high_water; /*!< most bytes ever in use at once */
+  atomic_uint exhausted;  /*!< allocations that did not fit */
+} bt_arena_t;
+
+/**
+ * @brief  initialise an arena over caller-provided storage
+ *
+ * @param [in] storage  `size` bytes, 4-byte aligned
+ * @param [in] size     capacity in bytes, a power of two of at least 4
+ */
+void bt_arena_init(bt_arena_t *arena, void *storage, uint32_t size);
+
+/**
+ * @brief  carve `len` bytes out of the arena (allocating context only)
+ *
+ * @return  the allocation, or NULL if it does not fit
+ */
+void *bt_arena_alloc(bt_arena_t *arena, size_t len);
+
+/**
+ * @brief  release an allocation
+ */
+void bt_arena_free(bt_arena_t *arena, void *p);
+
+/**
+ * @brief  true if `p` points into the arena's storage
+ */
+static inline bool bt_arena_owns(const bt_arena_t *arena, const void *p) {
+  const uint8_t *b = (const uint8_t *)p;
+  return b >= arena->buf && b < arena->buf + arena->size;
+}
+
+#endif /* __BT_APP_POOL_H__ */
@@ -0,0 +1,100 @@
+#include "bt_app_pos.h"
+
+#include <stdlib.h>
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* position at `frame`, lock held */
+static uint32_t bt_pos_value(const bt_pos_t *p, uint32_t frame);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static uint32_t bt_pos_value(const bt_pos_t *p, uint32_t frame) {
+  if (p->anchor_ms == BT_POS_UNKNOWN) {
+    return BT_POS_UNKNOWN;
+  }
+  if (!p->playing || p->sample_rate == 0) {
+    return p->anchor_ms;
+  }
+  /* the anchor may lie ahead of `frame` until the audio sent at the time
+   * of the report reaches the DAC; the difference survives a wrap of the
+   * frame count
+   */
+  int64_t elapsed_ms =
+      (int64_t)(int32_t)(frame - p->anchor_frame) * 1000 / p->sample_rate;
+  if (elapsed_ms < -(int64_t)p->anchor_ms) {
+    return 0;
+  }
+  return (uint32_t)(p->anchor_ms + elapsed_ms);
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_pos_reset(bt_pos_t *p) {
+  _lock_acquire(&p->lock);
+  p->anchor_ms = BT_POS_UNKNOWN;
+  p->anchor_frame = 0;
+  p->sample_rate = 0;
+  p->playing = false;
+  p->resyncs = 0;
+  _lock_release(&p->lock);
+}
+
+void bt_pos_anchor(bt_pos_t *p, uint32_t pos_ms, uint32_t frame,
+                   uint32_t rate) {
+  _lock_acquire(&p->lock);
+  p->anchor_ms = pos_ms;
+  p->anchor_frame = frame;
+  p->sample_rate = rate;
+  _lock_release(&p->lock);
+}
+
+void bt_pos_set_playing(bt_pos_t *p, bool playing, uint32_t frame) {
+  _lock_acquire(&p->lock);
+  if (playing != p->playing) {
+    /* fold the time played so far into the anchor */
+    p->anchor_ms = bt_pos_value(p, frame);
+    p->anchor_frame = frame;
+    p->playing = playing;
+  }
+  _lock_release(&p->lock);
+}
+
+bool bt_pos_check(bt_pos_t *p, uint32_t pos_ms, uint32_t frame, uint32_t rate,
+                  int32_t *err_ms) {
+  int32_t err = 0;
+  bool agreed = true;
+
+  _lock_acquire(&p->lock);
+  uint32_t local = bt_pos_value(p, frame);
+  if (local != BT_POS_UNKNOWN && pos_ms != BT_POS_UNKNOWN &&
+      rate == p->sample_rate) {
+    err = (int32_t)(local - pos_ms);
+  }
+  if (local == BT_POS_UNKNOWN || pos_ms == BT_POS_UNKNOWN ||
+      rate != p->sample_rate || abs(err) > BT_POS_RESYNC_MS) {
+    if (local != BT_POS_UNKNOWN) {
+      p->resyncs++;
+    }
+    p->anchor_ms = pos_ms;
+    p->anchor_frame = frame;
+    p->sample_rate = rate;
+    agreed = false;
+  }
+  _lock_release(&p->lock);
+  *err_ms = err;
+  return agreed;
+}
+
+uint32_t bt_pos_now(bt_pos_t *p, uint32_t frame) {
+  _lock_acquire(&p->lock);
+  uint32_t pos = bt_pos_value(p, frame);
+  _lock_release(&p->lock);
+  return pos;
+}
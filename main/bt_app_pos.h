@@ -0,0 +1,80 @@
+#ifndef __BT_APP_POS_H__
+#define __BT_APP_POS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/lock.h>
+
+/* position unknown, as reported by AVRCP for "no track selected" */
+#define BT_POS_UNKNOWN UINT32_MAX
+/* local and reported position may differ this much before re-anchoring */
+#define BT_POS_RESYNC_MS 200
+
+/**
+ * Local playback clock.
+ *
+ * The position is the last position the source reported (the anchor) plus
+ * the audio played since then, counted in source frames by the I2S task.
+ * That keeps it accurate to the frame between AVRCP reports. The anchor
+ * frame is where the audio sent at the time of the report will be heard,
+ * so the clock follows the DAC rather than the radio. While paused
+ * the clock holds still even if the source keeps streaming silence. When a
+ * new report is too far off the local value, e.g. after a seek or a stall,
+ * the clock jumps to the report. Written by the app task, read by anyone.
+ */
+typedef struct {
+  uint32_t anchor_ms;     /*!< reported position, BT_POS_UNKNOWN if none */
+  uint32_t anchor_frame;  /*!< frame count at which it is heard */
+  uint32_t sample_rate;   /*!< rate the frames are counted at */
+  bool playing;           /*!< clock runs with the rendered frames */
+  uint32_t resyncs;       /*!< re-anchors forced by a mismatch */
+  _lock_t lock;
+} bt_pos_t;
+
+/**
+ * @brief  forget the position, e.g. for a new peer
+ */
+void bt_pos_reset(bt_pos_t *p);
+
+/**
+ * @brief  set the position unconditionally, e.g. at the start of a track
+ *
+ * @param [in] pos_ms  position in the track, BT_POS_UNKNOWN if unknown
+ * @param [in] frame   frame count at which it is heard
+ * @param [in] rate    sample rate of the stream
+ */
+void bt_pos_anchor(bt_pos_t *p, uint32_t pos_ms, uint32_t frame,
+                   uint32_t rate);
+
+/**
+ * @brief  start or stop the clock on a play status change
+ *
+ * @param [in] playing  source reports playing
+ * @param [in] frame    frame count at which the change is heard
+ */
+void bt_pos_set_playing(bt_pos_t *p, bool playing, uint32_t frame);
+
+/**
+ * @brief  check a position reported by the source against the local clock
+ *
+ * @param [in]  pos_ms  reported position
+ * @param [in]  frame   frame count at which it is heard
+ * @param [in]  rate    sample rate of the stream
+ * @param [out] err_ms  local minus reported position, 0 if either is unknown
+ *
+ * @return  true if the clock agreed with the report, false if it had to be
+ *          re-anchored to it
+ */
+bool bt_pos_check(bt_pos_t *p, uint32_t pos_ms, uint32_t frame, uint32_t rate,
+                  int32_t *err_ms);
+
+/**
+ * @brief  current position
+ *
+ * @param [in] frame  frames played so far
+ *
+ * @return  position in ms, BT_POS_UNKNOWN if no anchor yet
+ */
+uint32_t bt_pos_now(bt_pos_t *p, uint32_t frame);
+
+#endif /* __BT_APP_POS_H__ */
@@ -0,0 +1,134 @@
+#include "bt_app_rc_tl.h"
+
+#include <esp_log.h>
+#include <string.h>
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* release a label and report the outcome */
+static void bt_rc_tl_finish(bt_rc_tl_t *t, uint8_t tl, bool ok);
+/* label of the oldest matching command, or -1 */
+static int bt_rc_tl_find(const bt_rc_tl_t *t, bt_rc_cmd_t kind, uint32_t arg);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static void bt_rc_tl_finish(bt_rc_tl_t *t, uint8_t tl, bool ok) {
+  bt_rc_pending_t p = t->pending[tl];
+
+  /* free the label first so that the callback can issue the next command */
+  t->pending[tl].used = false;
+  if (p.done) {
+    p.done(tl, p.arg, ok);
+  }
+}
+
+static int bt_rc_tl_find(const bt_rc_tl_t *t, bt_rc_cmd_t kind, uint32_t arg) {
+  /* labels are handed out round robin from `next`, so the oldest one is the
+   * first found walking forward from there
+   */
+  for (int i = 0; i < BT_RC_TL_NUM; i++) {
+    int tl = (t->next + i) % BT_RC_TL_NUM;
+    const bt_rc_pending_t *p = &t->pending[tl];
+    if (p->used && p->kind == kind &&
+        (arg == BT_RC_TL_ANY_ARG || p->arg == arg)) {
+      return tl;
+    }
+  }
+  return -1;
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_rc_tl_reset(bt_rc_tl_t *t) { memset(t, 0, sizeof(*t)); }
+
+int bt_rc_tl_issue(bt_rc_tl_t *t, int64_t now_us, bt_rc_cmd_t kind,
+                   uint32_t arg, uint32_t timeout_ms, uint8_t retries,
+                   bt_rc_send_t send, bt_rc_done_t done) {
+  for (int i = 0; i < BT_RC_TL_NUM; i++) {
+    int tl = (t->next + i) % BT_RC_TL_NUM;
+    bt_rc_pending_t *p = &t->pending[tl];
+    if (p->used) {
+      continue;
+    }
+    p->used = true;
+    p->kind = kind;
+    p->arg = arg;
+    p->timeout_ms = timeout_ms;
+    p->deadline_us = now_us + (int64_t)timeout_ms * 1000;
+    p->retries = retries;
+    p->send = send;
+    p->done = done;
+    t->next = (tl + 1) % BT_RC_TL_NUM;
+    send(tl, arg);
+    return tl;
+  }
+  ESP_LOGW(BT_RC_TL_TAG, "no free transaction label for command %d", kind);
+  return -1;
+}
+
+bool bt_rc_tl_complete_label(bt_rc_tl_t *t, uint8_t tl) {
+  if (tl >= BT_RC_TL_NUM || !t->pending[tl].used) {
+    return false;
+  }
+  bt_rc_tl_finish(t, tl, true);
+  return true;
+}
+
+bool bt_rc_tl_complete(bt_rc_tl_t *t, bt_rc_cmd_t kind, uint32_t arg) {
+  int tl = bt_rc_tl_find(t, kind, arg);
+
+  if (tl < 0) {
+    return false;
+  }
+  bt_rc_tl_finish(t, tl, true);
+  return true;
+}
+
+void bt_rc_tl_cancel(bt_rc_tl_t *t, bt_rc_cmd_t kind, uint32_t arg) {
+  int tl;
+
+  while ((tl = bt_rc_tl_find(t, kind, arg)) >= 0) {
+    t->pending[tl].used = false;
+  }
+}
+
+void bt_rc_tl_poll(bt_rc_tl_t *t, int64_t now_us) {
+  for (int tl = 0; tl < BT_RC_TL_NUM; tl++) {
+    bt_rc_pending_t *p = &t->pending[tl];
+    if (!p->used || p->timeout_ms == 0 || now_us < p->deadline_us) {
+      continue;
+    }
+    if (p->retries) {
+      ESP_LOGW(BT_RC_TL_TAG, "command %d on label %d timed out, resending",
+               p->kind, tl);
+      p->retries--;
+      p->deadline_us = now_us + (int64_t)p->timeout_ms * 1000;
+      p->send(tl, p->arg);
+    } else {
+      ESP_LOGW(BT_RC_TL_TAG, "command %d on label %d timed out", p->kind, tl);
+      bt_rc_tl_finish(t, tl, false);
+    }
+  }
+}
+
+bool bt_rc_tl_next_deadline(const bt_rc_tl_t *t, int64_t *deadline_us) {
+  bool any = false;
+
+  for (int tl = 0; tl < BT_RC_TL_NUM; tl++) {
+    const bt_rc_pending_t *p = &t->pending[tl];
+    if (!p->used || p->timeout_ms == 0) {
+      continue;
+    }
+    if (!any || p->deadline_us < *deadline_us) {
+      *deadline_us = p->deadline_us;
+    }
+    any = true;
+  }
+  return any;
+}
@@ -0,0 +1,115 @@
+#ifndef __BT_APP_RC_TL_H__
+#define __BT_APP_RC_TL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* log tag */
+#define BT_RC_TL_TAG "RC_TL"
+
+/* AVRCP transaction labels are 4 bits */
+#define BT_RC_TL_NUM 16
+/* matches any argument in bt_rc_tl_complete and bt_rc_tl_cancel */
+#define BT_RC_TL_ANY_ARG UINT32_MAX
+
+/* kinds of outstanding controller command */
+typedef enum {
+  BT_RC_CMD_PASSTHROUGH, /* arg: key code | key state << 8 */
+  BT_RC_CMD_GET_CAPS,    /* arg: unused */
+  BT_RC_CMD_METADATA,    /* arg: attribute mask */
+  BT_RC_CMD_NOTIFY,      /* arg: event id */
+  BT_RC_CMD_PLAY_STATUS, /* arg: unused */
+} bt_rc_cmd_t;
+
+/**
+ * @brief  send (or resend) a command with the given label
+ */
+typedef void (*bt_rc_send_t)(uint8_t tl, uint32_t arg);
+
+/**
+ * @brief  called once a command is answered or has finally timed out
+ */
+typedef void (*bt_rc_done_t)(uint8_t tl, uint32_t arg, bool ok);
+
+/* one outstanding command */
+typedef struct {
+  bool used;
+  bt_rc_cmd_t kind;
+  uint32_t arg;
+  uint32_t timeout_ms;  /*!< 0 waits forever */
+  int64_t deadline_us;  /*!< time of the next retry or give up */
+  uint8_t retries;      /*!< resends left */
+  bt_rc_send_t send;
+  bt_rc_done_t done;
+} bt_rc_pending_t;
+
+/**
+ * Transaction label allocator with a table of pending commands.
+ *
+ * Every controller command takes a free label for as long as it is
+ * outstanding, so commands of different kinds can be in flight together.
+ * Only passthrough responses carry their label back through the IDF API;
+ * other responses complete the oldest pending command of their kind and
+ * argument. Commands that time out are resent with the same label until
+ * their retries run out. All calls must come from one task.
+ */
+typedef struct {
+  bt_rc_pending_t pending[BT_RC_TL_NUM];
+  uint8_t next; /*!< where the search for a free label starts */
+} bt_rc_tl_t;
+
+/**
+ * @brief  forget every outstanding command, without callbacks
+ */
+void bt_rc_tl_reset(bt_rc_tl_t *t);
+
+/**
+ * @brief  take a label and send a command with it
+ *
+ * @param [in] kind        command kind, for matching the response
+ * @param [in] arg         command argument, passed to `send` and `done`
+ * @param [in] timeout_ms  time to wait for each attempt, 0 for no timeout
+ * @param [in] retries     resends after the first attempt
+ * @param [in] send        sends the command
+ * @param [in] done        completion callback, may be NULL
+ *
+ * @return  the label, or -1 if all labels are in use
+ */
+int bt_rc_tl_issue(bt_rc_tl_t *t, int64_t now_us, bt_rc_cmd_t kind,
+                   uint32_t arg, uint32_t timeout_ms, uint8_t retries,
+                   bt_rc_send_t send, bt_rc_done_t done);
+
+/**
+ * @brief  complete the command holding a label
+ *
+ * @return  true if the label was outstanding
+ */
+bool bt_rc_tl_complete_label(bt_rc_tl_t *t, uint8_t tl);
+
+/**
+ * @brief  complete the oldest command of a kind and argument
+ *
+ * @return  true if a command was outstanding
+ */
+bool bt_rc_tl_complete(bt_rc_tl_t *t, bt_rc_cmd_t kind, uint32_t arg);
+
+/**
+ * @brief  drop outstanding commands of a kind and argument, without callbacks
+ */
+void bt_rc_tl_cancel(bt_rc_tl_t *t, bt_rc_cmd_t kind, uint32_t arg);
+
+/**
+ * @brief  resend or give up on commands past their deadline
+ */
+void bt_rc_tl_poll(bt_rc_tl_t *t, int64_t now_us);
+
+/**
+ * @brief  earliest deadline of the outstanding commands that time out
+ *
+ * @param [out] deadline_us  when bt_rc_tl_poll next has work
+ *
+ * @return  false if no such command is outstanding
+ */
+bool bt_rc_tl_next_deadline(const bt_rc_tl_t *t, int64_t *deadline_us);
+
+#endif /* __BT_APP_RC_TL_H__ */
@@ -0,0 +1,127 @@
+#include "bt_app_ringbuf.h"
+
+#include <string.h>
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+bool bt_ringbuf_init(bt_ringbuf_t *rb, uint8_t *storage, size_t size) {
+  if (rb == NULL || storage == NULL || size == 0 || (size & (size - 1))) {
+    return false;
+  }
+  rb->buf = storage;
+  rb->size = size;
+  rb->mask = size - 1;
+  bt_ringbuf_reset(rb);
+  return true;
+}
+
+void bt_ringbuf_reset(bt_ringbuf_t *rb) {
+  atomic_store_explicit(&rb->head, 0, memory_order_relaxed);
+  atomic_store_explicit(&rb->tail, 0, memory_order_relaxed);
+  rb->head_cache = 0;
+  rb->tail_cache = 0;
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+size_t bt_ringbuf_fill(const bt_ringbuf_t *rb) {
+  /* load tail first so that a concurrent read can never make fill negative */
+  size_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+  size_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+  size_t fill = head - tail;
+  return fill > rb->size ? rb->size : fill;
+}
+
+size_t bt_ringbuf_space(const bt_ringbuf_t *rb) {
+  return rb->size - bt_ringbuf_fill(rb);
+}
+
+uint8_t *bt_ringbuf_write_acquire(bt_ringbuf_t *rb, size_t *len) {
+  size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+  size_t space = rb->size - (head - rb->tail_cache);
+
+  if (space == 0) {
+    /* only touch the consumer's line when the cached view says full */
+    rb->tail_cache = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    space = rb->size - (head - rb->tail_cache);
+  }
+
+  size_t offset = head & rb->mask;
+  size_t contiguous = rb->size - offset;
+  *len = space < contiguous ? space : contiguous;
+  return rb->buf + offset;
+}
+
+void bt_ringbuf_write_commit(bt_ringbuf_t *rb, size_t len) {
+  size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+  atomic_store_explicit(&rb->head, head + len, memory_order_release);
+}
+
+const uint8_t *bt_ringbuf_read_acquire(bt_ringbuf_t *rb, size_t *len) {
+  size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+  size_t fill = rb->head_cache - tail;
+
+  if (fill == 0) {
+    rb->head_cache = atomic_load_explicit(&rb->head, memory_order_acquire);
+    fill = rb->head_cache - tail;
+  }
+
+  size_t offset = tail & rb->mask;
+  size_t contiguous = rb->size - offset;
+  *len = fill < contiguous ? fill : contiguous;
+  return rb->buf + offset;
+}
+
+void bt_ringbuf_read_commit(bt_ringbuf_t *rb, size_t len) {
+  size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+  atomic_store_explicit(&rb->tail, tail + len, memory_order_release);
+}
+
+bool bt_ringbuf_write(bt_ringbuf_t *rb, const void *data, size_t len) {
+  const uint8_t *src = (const uint8_t *)data;
+  size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+
+  if (rb->size - (head - rb->tail_cache) < len) {
+    rb->tail_cache = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    if (rb->size - (head - rb->tail_cache) < len) {
+      return false;
+    }
+  }
+
+  /* at most two spans: up to the end of storage, then from the start */
+  size_t offset = head & rb->mask;
+  size_t first = rb->size - offset;
+  if (first > len) {
+    first = len;
+  }
+  memcpy(rb->buf + offset, src, first);
+  memcpy(rb->buf, src + first, len - first);
+
+  atomic_store_explicit(&rb->head, head + len, memory_order_release);
+  return true;
+}
+
+size_t bt_ringbuf_read(bt_ringbuf_t *rb, void *dst, size_t len) {
+  uint8_t *out = (uint8_t *)dst;
+  size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+
+  if (rb->head_cache - tail < len) {
+    rb->head_cache = atomic_load_explicit(&rb->head, memory_order_acquire);
+  }
+  size_t fill = rb->head_cache - tail;
+  if (len > fill) {
+    len = fill;
+  }
+
+  size_t offset = tail & rb->mask;
+  size_t first = rb->size - offset;
+  if (first > len) {
+    first = len;
+  }
+  memcpy(out, rb->buf + offset, first);
+  memcpy(out + first, rb->buf, len - first);
+
+  atomic_store_explicit(&rb->tail, tail + len, memory_order_release);
+  return len;
+}
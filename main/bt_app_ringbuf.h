@@ -0,0 +1,115 @@
+#ifndef __BT_APP_RINGBUF_H__
+#define __BT_APP_RINGBUF_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* producer and consumer indices live on separate lines */
+#define BT_RINGBUF_CACHE_LINE 32
+
+/**
+ * Single-producer/single-consumer byte ring.
+ *
+ * `head` is only written by the producer and `tail` only by the consumer, so
+ * neither side ever takes a lock. Indices run freely and are masked on
+ * access, which lets the whole power-of-two capacity be used.
+ */
+typedef struct {
+  /* consumer side */
+  _Alignas(BT_RINGBUF_CACHE_LINE) atomic_size_t tail;
+  size_t head_cache; /*!< consumer's last view of head */
+  /* producer side */
+  _Alignas(BT_RINGBUF_CACHE_LINE) atomic_size_t head;
+  size_t tail_cache; /*!< producer's last view of tail */
+  /* read-only after init */
+  _Alignas(BT_RINGBUF_CACHE_LINE) uint8_t *buf;
+  size_t size;
+  size_t mask;
+} bt_ringbuf_t;
+
+/**
+ * @brief  initialise a ring over caller-provided storage
+ *
+ * @param [out] rb       ring to initialise
+ * @param [in]  storage  backing memory of `size` bytes
+ * @param [in]  size     capacity in bytes, must be a power of two
+ *
+ * @return  true on success, false if size is not a power of two
+ */
+bool bt_ringbuf_init(bt_ringbuf_t *rb, uint8_t *storage, size_t size);
+
+/**
+ * @brief  discard all content; neither side may be active
+ */
+void bt_ringbuf_reset(bt_ringbuf_t *rb);
+
+/**
+ * @brief  number of bytes available to the consumer
+ */
+size_t bt_ringbuf_fill(const bt_ringbuf_t *rb);
+
+/**
+ * @brief  number of bytes available to the producer
+ */
+size_t bt_ringbuf_space(const bt_ringbuf_t *rb);
+
+/**
+ * @brief  total bytes ever written; runs freely and wraps
+ */
+static inline size_t bt_ringbuf_write_index(const bt_ringbuf_t *rb) {
+  return atomic_load_explicit(&rb->head, memory_order_acquire);
+}
+
+/**
+ * @brief  total bytes ever read; runs freely and wraps
+ */
+static inline size_t bt_ringbuf_read_index(const bt_ringbuf_t *rb) {
+  return atomic_load_explicit(&rb->tail, memory_order_acquire);
+}
+
+/**
+ * @brief  get the largest contiguous writable span (producer only)
+ *
+ * @param [out] len  length of the span in byte, 0 if the ring is full
+ *
+ * @return  pointer to the span
+ */
+uint8_t *bt_ringbuf_write_acquire(bt_ringbuf_t *rb, size_t *len);
+
+/**
+ * @brief  publish `len` bytes written into the acquired span (producer only)
+ */
+void bt_ringbuf_write_commit(bt_ringbuf_t *rb, size_t len);
+
+/**
+ * @brief  get the largest contiguous readable span (consumer only)
+ *
+ * @param [out] len  length of the span in byte, 0 if the ring is empty
+ *
+ * @return  pointer to the span
+ */
+const uint8_t *bt_ringbuf_read_acquire(bt_ringbuf_t *rb, size_t *len);
+
+/**
+ * @brief  release `len` bytes of the acquired span (consumer only)
+ */
+void bt_ringbuf_read_commit(bt_ringbuf_t *rb, size_t len);
+
+/**
+ * @brief  copy a whole item into the ring (producer only)
+ *
+ * @return  true if all `len` bytes were written, false if there was not enough
+ *          space, in which case nothing is written
+ */
+bool bt_ringbuf_write(bt_ringbuf_t *rb, const void *data, size_t len);
+
+/**
+ * @brief  copy up to `len` bytes out of the ring (consumer only)
+ *
+ * @return  number of bytes copied
+ */
+size_t bt_ringbuf_read(bt_ringbuf_t *rb, void *dst, size_t len);
+
+#endif /* __BT_APP_RINGBUF_H__ */
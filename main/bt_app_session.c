@@ -0,0 +1,57 @@
+#include "bt_app_session.h"
+
+#include <esp_log.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+/* milestone names for the report */
+static const char *s_session_evt_str[BT_SESSION_NUM] = {
+    "connect", "configured", "started", "first packet", "first audio"};
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_session_begin(bt_session_t *s, bt_session_evt_t evt, uint32_t now_us) {
+  for (int i = evt + 1; i < BT_SESSION_NUM; i++) {
+    atomic_store(&s->at_us[i], 0);
+  }
+  /* 0 means "not reached"; a real stamp of 0 is off by a microsecond */
+  atomic_store(&s->at_us[evt], now_us ? now_us : 1);
+}
+
+bool bt_session_mark(bt_session_t *s, bt_session_evt_t evt, uint32_t now_us) {
+  uint32_t unset = 0;
+  return atomic_compare_exchange_strong(&s->at_us[evt], &unset,
+                                        now_us ? now_us : 1);
+}
+
+void bt_session_report(bt_session_t *s) {
+  char line[160];
+  int len = 0;
+  uint32_t first = 0;
+  uint32_t prev = 0;
+
+  for (int i = 0; i < BT_SESSION_NUM; i++) {
+    uint32_t at = atomic_load(&s->at_us[i]);
+    if (at == 0) {
+      continue;
+    }
+    if (first == 0) {
+      len += snprintf(line + len, sizeof(line) - len, "%s",
+                      s_session_evt_str[i]);
+      first = at;
+    } else if (len < (int)sizeof(line)) {
+      len += snprintf(line + len, sizeof(line) - len, " -> %s +%" PRIu32 " ms",
+                      s_session_evt_str[i], (at - prev) / 1000);
+    }
+    prev = at;
+  }
+  if (first) {
+    ESP_LOGI(BT_SESSION_TAG, "%s, total %" PRIu32 " ms", line,
+             (prev - first) / 1000);
+  }
+
+  atomic_store(&s->at_us[BT_SESSION_CONNECT], 0);
+  atomic_store(&s->at_us[BT_SESSION_CONFIGURED], 0);
+}
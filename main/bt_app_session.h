@@ -0,0 +1,55 @@
+#ifndef __BT_APP_SESSION_H__
+#define __BT_APP_SESSION_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* log tag */
+#define BT_SESSION_TAG "SESSION"
+
+/* milestones from connection to the first sample, in order */
+typedef enum {
+  BT_SESSION_CONNECT,      /*!< A2DP connection coming up */
+  BT_SESSION_CONFIGURED,   /*!< codec configured */
+  BT_SESSION_STARTED,      /*!< source started the stream */
+  BT_SESSION_FIRST_PACKET, /*!< first audio packet buffered */
+  BT_SESSION_FIRST_AUDIO,  /*!< first sample handed to the output */
+  BT_SESSION_NUM,
+} bt_session_evt_t;
+
+/**
+ * Time to first audio.
+ *
+ * Each milestone holds the time it was reached, 0 if not yet. Reaching one
+ * clears the later ones, so every stream start is timed on its own. Once
+ * the first sample goes out, the milestones since the previous report are
+ * logged. Any task may mark a milestone.
+ */
+typedef struct {
+  _Atomic uint32_t at_us[BT_SESSION_NUM]; /*!< time of each milestone */
+} bt_session_t;
+
+/**
+ * @brief  record a milestone and clear the ones after it
+ *
+ * @param [in] now_us  current time
+ */
+void bt_session_begin(bt_session_t *s, bt_session_evt_t evt, uint32_t now_us);
+
+/**
+ * @brief  record a milestone unless it was already reached
+ *
+ * @param [in] now_us  current time
+ *
+ * @return  true if this call recorded it
+ */
+bool bt_session_mark(bt_session_t *s, bt_session_evt_t evt, uint32_t now_us);
+
+/**
+ * @brief  log the time between the milestones reached, and forget all but
+ *         the stream start so that the next report covers the next stream
+ */
+void bt_session_report(bt_session_t *s);
+
+#endif /* __BT_APP_SESSION_H__ */
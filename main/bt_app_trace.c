@@ -0,0 +1,108 @@
+#include "bt_app_trace.h"
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_TRACE
+
+/* records per line of the dump */
+#define TRACE_PER_LINE 8
+/* below everything that carries audio; the dump takes seconds of UART */
+#define TRACE_TASK_PRIO 1
+#define TRACE_TASK_STACK_SIZE 3072
+
+/* a wrapping record count indexes the ring without a jump */
+_Static_assert((CONFIG_EXAMPLE_A2DP_SINK_TRACE_ENTRIES &
+                (CONFIG_EXAMPLE_A2DP_SINK_TRACE_ENTRIES - 1)) == 0,
+               "trace entries must be a power of two");
+
+/*******************************
+ * STATIC VARIABLE DEFINITIONS
+ ******************************/
+
+static bt_trace_rec_t s_trace[CONFIG_EXAMPLE_A2DP_SINK_TRACE_ENTRIES];
+static _Atomic uint32_t s_trace_seq = 0; /* records ever claimed */
+/* set from a dump's request until it is printed */
+static _Atomic bool s_trace_paused = false;
+static TaskHandle_t s_trace_task_handle = NULL;
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* print the ring and start it over */
+static void bt_trace_print(void);
+static void bt_trace_task_handler(void *arg);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static void bt_trace_print(void) {
+  uint32_t seq = atomic_load(&s_trace_seq);
+  uint32_t count = seq < CONFIG_EXAMPLE_A2DP_SINK_TRACE_ENTRIES
+                       ? seq
+                       : CONFIG_EXAMPLE_A2DP_SINK_TRACE_ENTRIES;
+
+  printf("#TRACE %d %u %" PRIu32 "\n", BT_TRACE_VERSION,
+         (unsigned)sizeof(bt_trace_rec_t), count);
+  for (uint32_t i = 0; i < count; i++) {
+    const bt_trace_rec_t *rec =
+        &s_trace[(seq - count + i) % CONFIG_EXAMPLE_A2DP_SINK_TRACE_ENTRIES];
+    printf("%08" PRIx32 "%02x%02x%04x%c", rec->t_us, rec->type, rec->arg,
+           rec->val,
+           (i % TRACE_PER_LINE == TRACE_PER_LINE - 1 || i == count - 1)
+               ? '\n'
+               : ' ');
+  }
+  printf("#END\n");
+  fflush(stdout);
+  atomic_store(&s_trace_seq, 0);
+  atomic_store(&s_trace_paused, false);
+}
+
+static void bt_trace_task_handler(void *arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    bt_trace_print();
+  }
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+bool bt_trace_init(void) {
+  return xTaskCreate(bt_trace_task_handler, "BtTraceTask",
+                     TRACE_TASK_STACK_SIZE, NULL, TRACE_TASK_PRIO,
+                     &s_trace_task_handle) == pdPASS;
+}
+
+void bt_trace_record(bt_trace_type_t type, uint8_t arg, uint16_t val) {
+  if (atomic_load(&s_trace_paused)) {
+    return;
+  }
+  /* claim a slot first, so that concurrent writers never share one */
+  uint32_t seq = atomic_fetch_add(&s_trace_seq, 1);
+  bt_trace_rec_t *rec =
+      &s_trace[seq % CONFIG_EXAMPLE_A2DP_SINK_TRACE_ENTRIES];
+  rec->t_us = (uint32_t)esp_timer_get_time();
+  rec->type = type;
+  rec->arg = arg;
+  rec->val = val;
+}
+
+void bt_trace_dump(void) {
+  /* the pause holds the records until the task has printed them */
+  if (s_trace_task_handle == NULL || atomic_exchange(&s_trace_paused, true)) {
+    return;
+  }
+  xTaskNotifyGive(s_trace_task_handle);
+}
+
+#endif /* CONFIG_EXAMPLE_A2DP_SINK_TRACE */
@@ -0,0 +1,65 @@
+#ifndef __BT_APP_TRACE_H__
+#define __BT_APP_TRACE_H__
+
+#include <sdkconfig.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* format of the dump, bumped when a record changes meaning */
+#define BT_TRACE_VERSION 1
+
+/* what a record holds; `arg` and `val` as noted */
+typedef enum {
+  BT_TRACE_PACKET = 1, /*!< audio packet from the source; val: bytes */
+  BT_TRACE_RENDER,     /*!< output chunk refilled; arg: BT_TRACE_RENDER_*,
+                            val: frames taken from the ringbuffer */
+  BT_TRACE_A2D_CONN,   /*!< A2DP connection state; arg: the new state */
+  BT_TRACE_A2D_AUDIO,  /*!< A2DP audio state; arg: the new state */
+  BT_TRACE_A2D_CFG,    /*!< codec configured; arg: channels, val: rate */
+  BT_TRACE_RC_PLAY,    /*!< AVRCP play status; arg: the new status */
+  BT_TRACE_RC_TRACK,   /*!< AVRCP track change */
+} bt_trace_type_t;
+
+/* BT_TRACE_RENDER flags */
+#define BT_TRACE_RENDER_CONCEALED 0x01 /* short read filled by PLC */
+#define BT_TRACE_RENDER_UNDERFLOW 0x02 /* nothing to play, back to prefetch */
+
+/**
+ * One event, 8 bytes. The time is the low 32 bits of esp_timer, which
+ * wraps after 71 minutes; a replay only needs the differences.
+ */
+typedef struct {
+  uint32_t t_us;
+  uint8_t type;
+  uint8_t arg;
+  uint16_t val;
+} bt_trace_rec_t;
+
+/**
+ * @brief  start the task that prints dumps; false if it can't be created
+ */
+bool bt_trace_init(void);
+
+/**
+ * @brief  record an event; safe from any task, not from an ISR
+ */
+void bt_trace_record(bt_trace_type_t type, uint8_t arg, uint16_t val);
+
+/**
+ * @brief  print the recorded events to the console and start over
+ *
+ * Returns at once; a low-priority task prints "#TRACE <version> <record
+ * size> <count>", then the records oldest first, eight to a line, each as
+ * the hex of t_us, type, arg and val, and finally "#END". Events arriving
+ * until it is done are not recorded, and a dump asked for meanwhile is
+ * dropped.
+ */
+void bt_trace_dump(void);
+
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_TRACE
+#define BT_TRACE(type, arg, val) bt_trace_record((type), (arg), (val))
+#else
+#define BT_TRACE(type, arg, val) ((void)0)
+#endif
+
+#endif /* __BT_APP_TRACE_H__ */
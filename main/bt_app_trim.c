@@ -0,0 +1,77 @@
+#include "bt_app_trim.h"
+
+#include <string.h>
+
+/* controller step period */
+#define TRIM_PERIOD_US (100 * 1000)
+/**
+ * Gains. A trim of 1 ppm moves the fill by 1 us per second, so with
+ * TRIM_KP ppm per ms of error the fill settles with a 20 s time constant;
+ * TRIM_KI places the second pole there as well (critical damping).
+ */
+#define TRIM_KP_PPM_PER_MS 50
+/* integral step per period: 1/1000 ppm per TRIM_KI_DIV us of error */
+#define TRIM_KI_DIV 16
+
+/*******************************
+ * STATIC FUNCTION DECLARATIONS
+ ******************************/
+
+/* limit to +-BT_TRIM_LIMIT_PPM, scaled */
+static int32_t bt_trim_clamp(int32_t v, int32_t scale);
+
+/*******************************
+ * STATIC FUNCTION DEFINITIONS
+ ******************************/
+
+static int32_t bt_trim_clamp(int32_t v, int32_t scale) {
+  if (v > BT_TRIM_LIMIT_PPM * scale) {
+    return BT_TRIM_LIMIT_PPM * scale;
+  }
+  if (v < -BT_TRIM_LIMIT_PPM * scale) {
+    return -BT_TRIM_LIMIT_PPM * scale;
+  }
+  return v;
+}
+
+/********************************
+ * EXTERNAL FUNCTION DEFINITIONS
+ *******************************/
+
+void bt_trim_reset(bt_trim_t *t) { memset(t, 0, sizeof(*t)); }
+
+void bt_trim_fill_up(bt_trim_t *t) {
+  t->filling = true;
+  t->fill_err_us = 0;
+  t->next_us = 0;
+}
+
+bool bt_trim_update(bt_trim_t *t, int64_t now_us, int32_t fill_err_us) {
+  /* fill level saws up and down with every packet, so smooth it heavily */
+  t->fill_err_us += (fill_err_us - t->fill_err_us) / 64;
+
+  if (t->next_us == 0) {
+    t->next_us = now_us;
+  }
+  if (now_us < t->next_us) {
+    return false;
+  }
+  t->next_us += TRIM_PERIOD_US;
+
+  int32_t ppm;
+  if (t->filling && fill_err_us < 0) {
+    /* hold the integral; the deficit is ours, not the source's */
+    ppm = t->integ_mppm / 1000 - BT_TRIM_LIMIT_PPM;
+  } else {
+    t->filling = false;
+    t->integ_mppm = bt_trim_clamp(
+        t->integ_mppm + t->fill_err_us / TRIM_KI_DIV, 1000);
+    ppm = t->fill_err_us * TRIM_KP_PPM_PER_MS / 1000 + t->integ_mppm / 1000;
+  }
+  ppm = bt_trim_clamp(ppm, 1);
+  if (ppm == t->ppm) {
+    return false;
+  }
+  t->ppm = ppm;
+  return true;
+}
@@ -0,0 +1,48 @@
+#ifndef __BT_APP_TRIM_H__
+#define __BT_APP_TRIM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* largest trim ever applied, in ppm */
+#define BT_TRIM_LIMIT_PPM 2000
+
+/**
+ * Output clock trim controller.
+ *
+ * Steers the output sample clock so that the ringbuffer fill holds at its
+ * target, which makes the output follow the source's media clock without
+ * touching the samples. A PI controller runs on the filtered fill error:
+ * the integral learns the clock offset, the proportional term pulls the
+ * fill back after jitter. Like the drift estimator, a start below the
+ * target is grown at the full negative trim with the integral held.
+ */
+typedef struct {
+  int64_t next_us;     /*!< time of the next controller step */
+  int32_t fill_err_us; /*!< smoothed fill error */
+  int32_t integ_mppm;  /*!< integral term, in 1/1000 ppm */
+  int32_t ppm;         /*!< trim to apply, positive speeds the output up */
+  bool filling;        /*!< growing towards the target */
+} bt_trim_t;
+
+/**
+ * @brief  forget the learned offset, e.g. for a new source
+ */
+void bt_trim_reset(bt_trim_t *t);
+
+/**
+ * @brief  playback (re)started, possibly below the target fill
+ */
+void bt_trim_fill_up(bt_trim_t *t);
+
+/**
+ * @brief  feed the fill error (consumer only)
+ *
+ * @param [in] now_us       current time
+ * @param [in] fill_err_us  fill level minus target, in microseconds
+ *
+ * @return  true if ppm changed
+ */
+bool bt_trim_update(bt_trim_t *t, int64_t now_us, int32_t fill_err_us);
+
+#endif /* __BT_APP_TRIM_H__ */
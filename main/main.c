@@ -13,7 +13,9 @@
 #include "bt_app_av.h"
 #include "bt_app_core.h"
 #include "bt_app_display.h"
+#include "bt_app_i2s.h"
 #include "bt_app_stack.h"
+#include "bt_app_trace.h"
 #include "esp_bt.h"
 #include "esp_bt_main.h"
 #include "esp_log.h"
@@ -64,8 +66,19 @@ void app_main(void) {
 
   bt_stack_init();
 
+  /* the audio engine lives for good; connections only arm and idle it */
+  if (!bt_i2s_engine_init()) {
+    return;
+  }
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_TRACE
+  if (!bt_trace_init()) {
+    ESP_LOGE(BT_AV_TAG, "%s trace task creation failed", __func__);
+  }
+#endif
+
   ui_status_task_startup();
   bt_app_task_start_up();
   /* bluetooth device name, connection mode and profile set up */
-  bt_app_work_dispatch(bt_av_hdl_stack_evt, BT_APP_EVT_STACK_UP, NULL, 0, NULL);
+  bt_app_work_dispatch(bt_av_hdl_stack_evt, BT_APP_EVT_STACK_UP, NULL, 0, NULL,
+                       BT_APP_LANE_HIGH);
 }
\ No newline at end of file